@@ -1,8 +1,12 @@
 #include "PortalCharacter.h"
+#include "PortalCharacterMovementComponent.h"
+#include "PortalManagerSubsystem.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
 
-APortalCharacter::APortalCharacter()
+APortalCharacter::APortalCharacter(const FObjectInitializer& ObjectInitializer)
+	:Super{ ObjectInitializer.SetDefaultSubobjectClass<UPortalCharacterMovementComponent>(ACharacter::CharacterMovementComponentName) }
 {
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -28,6 +32,22 @@ void APortalCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCom
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
 }
 
+void APortalCharacter::ServerPortalCrossing_Implementation(const FPortalCrossingMessage& message)
+{
+	if (UPortalManagerSubsystem* portalManager{ GetWorld()->GetSubsystem<UPortalManagerSubsystem>() })
+	{
+		portalManager->ReceiveCrossing(this, message);
+	}
+}
+
+void APortalCharacter::ClientRejectPortalCrossing_Implementation(uint16 portalId)
+{
+	if (UPortalManagerSubsystem* portalManager{ GetWorld()->GetSubsystem<UPortalManagerSubsystem>() })
+	{
+		portalManager->OnCrossingRejected(portalId);
+	}
+}
+
 UENUM(BlueprintType)
 enum class ModName: uint8
 {
@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "PortalCrossingMessage.h"
 #include "PortalCharacter.generated.h"
 
 UCLASS()
@@ -19,7 +20,15 @@ public:
 
 public:	
 
-	APortalCharacter();
+	APortalCharacter(const FObjectInitializer& ObjectInitializer);
+
+	//Client to server: this character crossed a portal and its client already teleported it, see UPortalManagerSubsystem::PredictCrossing()
+	UFUNCTION(Server, Reliable)
+	void ServerPortalCrossing(const FPortalCrossingMessage& message);
+
+	//Server to client: the crossing failed validation, character movement corrects the client back to where the server kept the character
+	UFUNCTION(Client, Reliable)
+	void ClientRejectPortalCrossing(uint16 portalId);
 
 	virtual void Tick(float DeltaTime) override;
 
@@ -0,0 +1,15 @@
+#include "PortalCharacterMovementComponent.h"
+#include "PortalManagerSubsystem.h"
+
+#include "Engine/World.h"
+
+void UPortalCharacterMovementComponent::OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity,
+	UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode)
+{
+	Super::OnClientCorrectionReceived(ClientData, TimeStamp, NewLocation, NewVelocity, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode);
+
+	if (UPortalManagerSubsystem* portalManager{ GetWorld() ? GetWorld()->GetSubsystem<UPortalManagerSubsystem>() : nullptr })
+	{
+		portalManager->OnMovementCorrection();
+	}
+}
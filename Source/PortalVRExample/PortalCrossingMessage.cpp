@@ -0,0 +1,30 @@
+#include "PortalCrossingMessage.h"
+
+#include "Engine/NetSerialization.h"
+#include "UObject/CoreNet.h"
+
+bool FPortalCrossingMessage::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << portalId;
+	bOutSuccess = SerializePackedVector<10, 24>(characterLocation, Ar);
+	characterRotation.SerializeCompressedShort(Ar);
+	bOutSuccess &= SerializePackedVector<10, 24>(prevCameraLocation, Ar);
+	bOutSuccess &= SerializePackedVector<10, 24>(cameraLocation, Ar);
+	return true;
+}
+
+int32 FPortalCrossingMessage::Quantize()
+{
+	bool bSuccess{ true };
+	FNetBitWriter writer{ nullptr, 256 };
+	NetSerialize(writer, nullptr, bSuccess);
+
+	FNetBitReader reader{ nullptr, writer.GetData(), writer.GetNumBits() };
+	NetSerialize(reader, nullptr, bSuccess);
+	return static_cast<int32>(writer.GetNumBits());
+}
+
+FTransform FPortalCrossingMessage::GetCharacterTransform(const FTransform& portalTransform) const
+{
+	return FTransform{ portalTransform.TransformRotation(characterRotation.Quaternion()), portalTransform.TransformPosition(characterLocation) };
+}
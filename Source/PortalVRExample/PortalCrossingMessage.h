@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PortalCrossingMessage.generated.h"
+
+/*
+ * A portal crossing a client predicted, sent to the server to validate and repeat it (see UPortalManagerSubsystem::PredictCrossing()).
+ * Everything is relative to the entrance portal, so the vectors are small and pack into a few bits each, instead of the character's full world transform.
+ * The character's transform is from before the teleport, the server takes it through the portal the same way the client did
+ */
+USTRUCT()
+struct FPortalCrossingMessage
+{
+	GENERATED_BODY()
+
+	//Network ID of the entrance portal, see UPortalManagerSubsystem::RegisterPortal()
+	uint16 portalId{ 0 };
+
+	//Character root before the teleport, in the portal's local space
+	FVector characterLocation{ ForceInitToZero };
+	FRotator characterRotation{ ForceInitToZero };
+
+	//Camera segment the client's crossing test found crossing the portal, in the portal's local space
+	FVector prevCameraLocation{ ForceInitToZero };
+	FVector cameraLocation{ ForceInitToZero };
+
+	//Locations to 0.1 cm with as few bits as their size needs, rotation as 16 bits per non zero axis
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	//Rounds the message to what the server receives, so the client teleports from exactly the transform the server rebuilds. Returns the message's size in bits
+	int32 Quantize();
+
+	//Character's world transform before the teleport, rebuilt from the portal's transform
+	FTransform GetCharacterTransform(const FTransform& portalTransform) const;
+};
+
+template <>
+struct TStructOpsTypeTraits<FPortalCrossingMessage> : public TStructOpsTypeTraitsBase2<FPortalCrossingMessage>
+{
+	enum { WithNetSerializer = true };
+};
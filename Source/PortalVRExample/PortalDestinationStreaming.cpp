@@ -0,0 +1,142 @@
+#include "PortalDestinationStreaming.h"
+#include "PortalVR.h"
+
+#include "Engine/LevelBounds.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalStreaming, Log, All);
+
+static TAutoConsoleVariable<float> CVarPortalStreamingReleaseDelay(
+	TEXT("r.Portal.Streaming.ReleaseDelay"),
+	5.0f,
+	TEXT("Seconds no portal has to need a destination level the portal manager loaded before it is unloaded again."),
+	ECVF_Default);
+
+void UPortalDestinationStreaming::RequestDestination(const APortalVR* portal, float worldTime, bool bLoad)
+{
+	for (const TSoftObjectPtr<UWorld>& destinationLevel : portal->GetDestinationLevels())
+	{
+		const FName packageName{ *destinationLevel.GetLongPackageName() };
+		if (packageName.IsNone())
+		{
+			continue;
+		}
+
+		FPortalStreamingRequest* request{ requests.Find(packageName) };
+		if (!request || !request->streamingLevel)
+		{
+			if (!bLoad)
+			{
+				continue;
+			}
+
+			ULevelStreaming* streamingLevel{ FindStreamingLevel(packageName) };
+			if (!streamingLevel)
+			{
+				continue;
+			}
+
+			request = &requests.Add(packageName);
+			request->streamingLevel = streamingLevel;
+		}
+
+		//Captures only see visible levels, a level that is loaded but hidden is shown too
+		ULevelStreaming* streamingLevel{ request->streamingLevel };
+		if (bLoad && !request->bOwned && (!streamingLevel->ShouldBeLoaded() || !streamingLevel->ShouldBeVisible()))
+		{
+			UE_LOG(LogPortalStreaming, Verbose, TEXT("Streaming in %s for %s"), *packageName.ToString(), *portal->GetName());
+			streamingLevel->SetShouldBeLoaded(true);
+			streamingLevel->SetShouldBeVisible(true);
+			request->bOwned = true;
+		}
+		request->lastNeededTime = worldTime;
+	}
+}
+
+void UPortalDestinationStreaming::ReleaseUnneeded(float worldTime, const TArray<FVector>& cameraLocations)
+{
+	const float releaseDelay{ CVarPortalStreamingReleaseDelay.GetValueOnGameThread() };
+	for (auto requestIterator = requests.CreateIterator(); requestIterator; ++requestIterator)
+	{
+		FPortalStreamingRequest& request{ requestIterator.Value() };
+		if (!request.streamingLevel)
+		{
+			requestIterator.RemoveCurrent();
+			continue;
+		}
+		if (!request.bOwned)
+		{
+			continue;
+		}
+
+		//Computed once the level is in, iterating its actors every frame would cost more than the streaming decision is worth
+		if (!request.bBoundsValid && request.streamingLevel->IsLevelVisible())
+		{
+			request.bounds = ALevelBounds::CalculateLevelBounds(request.streamingLevel->GetLoadedLevel());
+			request.bBoundsValid = true;
+		}
+
+		//A player walked away from both portals but is still in the level, it is where they are and not an unreachable destination
+		const FBox& bounds{ request.bounds };
+		if (request.bBoundsValid && bounds.IsValid && cameraLocations.ContainsByPredicate([&bounds](const FVector& cameraLocation) { return bounds.IsInside(cameraLocation); }))
+		{
+			request.lastNeededTime = worldTime;
+			continue;
+		}
+
+		if (worldTime - request.lastNeededTime > releaseDelay)
+		{
+			UE_LOG(LogPortalStreaming, Verbose, TEXT("Streaming out %s, no portal needed it for %.1f seconds"), *requestIterator.Key().ToString(), releaseDelay);
+			request.streamingLevel->SetShouldBeVisible(false);
+			request.streamingLevel->SetShouldBeLoaded(false);
+			requestIterator.RemoveCurrent();
+		}
+	}
+}
+
+bool UPortalDestinationStreaming::IsDestinationReady(const APortalVR* portal) const
+{
+	for (const TSoftObjectPtr<UWorld>& destinationLevel : portal->GetDestinationLevels())
+	{
+		const FName packageName{ *destinationLevel.GetLongPackageName() };
+		if (packageName.IsNone() || missingLevels.Contains(packageName))
+		{
+			continue;
+		}
+
+		//Levels no portal requested yet may have been streamed in by the game
+		const FPortalStreamingRequest* request{ requests.Find(packageName) };
+		const ULevelStreaming* streamingLevel{ request ? request->streamingLevel : UGameplayStatics::GetStreamingLevel(this, packageName) };
+		if (streamingLevel && !streamingLevel->IsLevelVisible())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int32 UPortalDestinationStreaming::GetOwnedLevelCount() const
+{
+	int32 ownedLevels{ 0 };
+	for (const TPair<FName, FPortalStreamingRequest>& request : requests)
+	{
+		ownedLevels += request.Value.bOwned ? 1 : 0;
+	}
+	return ownedLevels;
+}
+
+ULevelStreaming* UPortalDestinationStreaming::FindStreamingLevel(const FName& packageName)
+{
+	//Matches the PIE prefixed package names as well
+	ULevelStreaming* streamingLevel{ UGameplayStatics::GetStreamingLevel(this, packageName) };
+	if (!streamingLevel && !missingLevels.Contains(packageName))
+	{
+		missingLevels.Add(packageName);
+		UE_LOG(LogPortalStreaming, Warning, TEXT("%s is a portal destination level but not a streaming level of %s, add it to the world's levels"),
+			*packageName.ToString(), *GetWorld()->GetMapName());
+	}
+	return streamingLevel;
+}
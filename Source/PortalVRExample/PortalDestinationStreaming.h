@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PortalDestinationStreaming.generated.h"
+
+//A streaming level the portal manager made load for a portal's destination
+USTRUCT()
+struct FPortalStreamingRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class ULevelStreaming* streamingLevel{ nullptr };
+
+	//Whether the portal manager loaded the level, levels something else already had loaded and visible are never unloaded by it
+	bool bOwned{ false };
+
+	//World time a portal last needed the level
+	float lastNeededTime{ 0.0f };
+
+	//Bounds of the level's actors once it is loaded, the level isn't released while the player camera is inside them
+	FBox bounds{ ForceInit };
+	bool bBoundsValid{ false };
+};
+
+/*
+ * Loads the streaming levels of portal destinations before the player reaches the portal, owned by the portal manager.
+ * The manager decides from the player's distance to and approach speed towards each portal which destinations are needed, this loads and shows their levels
+ * and unloads the ones it loaded once no portal needed them for "r.Portal.Streaming.ReleaseDelay" seconds
+ */
+UCLASS()
+class PORTALVREXAMPLE_API UPortalDestinationStreaming : public UObject
+{
+	GENERATED_BODY()
+
+private:
+
+	//Every destination level a portal asked for, by package name
+	UPROPERTY()
+	TMap<FName, FPortalStreamingRequest> requests;
+
+	//Destination levels that aren't streaming levels of the world, only warned about once
+	TSet<FName> missingLevels;
+
+public:
+
+	/*
+	 * Marks the portal's destination levels as needed now. With bLoad the levels that aren't loaded and visible yet start streaming in,
+	 * without it only levels that were already requested are kept from being released
+	 */
+	void RequestDestination(const class APortalVR* portal, float worldTime, bool bLoad);
+
+	//Unloads the levels this loaded that no portal needed for "r.Portal.Streaming.ReleaseDelay" seconds, unless a local player's camera is inside one
+	void ReleaseUnneeded(float worldTime, const TArray<FVector>& cameraLocations);
+
+	//Whether every destination level of the portal is loaded and visible, true for portals without destination levels
+	bool IsDestinationReady(const class APortalVR* portal) const;
+
+	//Number of levels this loaded that are still loaded or loading
+	int32 GetOwnedLevelCount() const;
+
+private:
+
+	//The world's streaming level of a destination level, nullptr if the world doesn't have it
+	class ULevelStreaming* FindStreamingLevel(const FName& packageName);
+};
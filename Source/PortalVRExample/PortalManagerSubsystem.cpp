@@ -0,0 +1,1493 @@
+#include "PortalManagerSubsystem.h"
+#include "PortalCharacter.h"
+#include "PortalCrossingMessage.h"
+#include "PortalDestinationStreaming.h"
+#include "PortalPoseDelta.h"
+#include "PortalRenderTargetPool.h"
+#include "PortalStats.h"
+#include "PortalVR.h"
+#include "PortalVisibilityData.h"
+
+#include "Async/ParallelFor.h"
+#include "Camera/CameraComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "Engine/Engine.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "IXRTrackingSystem.h"
+#include "Misc/PackageName.h"
+#include "RenderCore.h"
+#include "RHI.h"
+#include "UnrealClient.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalManager, Log, All);
+
+static TAutoConsoleVariable<int32> CVarPortalAdaptiveResolution(
+	TEXT("r.Portal.AdaptiveResolution"),
+	1,
+	TEXT("Whether portal capture resolution adapts to screen coverage and frame time.\n")
+	TEXT(" 0: portals always capture at their full resolution\n")
+	TEXT(" 1: portals pick a resolution bucket from their screen coverage within the captured pixel budget (default)"),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPortalMaxCapturedPixels(
+	TEXT("r.Portal.MaxCapturedPixels"),
+	8 * 1024 * 1024,
+	TEXT("Maximum number of pixels all portal scene captures together may render per frame."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPortalTargetFrameTime(
+	TEXT("r.Portal.TargetFrameTimeMs"),
+	11.1f,
+	TEXT("Frame time (ms) the portal resolution controller tries to stay under, the captured pixel budget shrinks while frames are slower than this."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPortalResolutionHysteresis(
+	TEXT("r.Portal.ResolutionHysteresisFrames"),
+	30,
+	TEXT("Number of consecutive frames a portal has to prefer a different resolution bucket before its render targets are resized."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPortalParallelPrepare(
+	TEXT("r.Portal.ParallelPrepare"),
+	1,
+	TEXT("Whether the per portal crossing tests and capture preparation run in parallel.\n")
+	TEXT(" 0: every portal is prepared one after the other on the game thread\n")
+	TEXT(" 1: portals are prepared with ParallelFor, only the scene capture submissions stay on the game thread (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPortalMaxCapturePasses(
+	TEXT("r.Portal.MaxCapturePassesPerFrame"),
+	8,
+	TEXT("Maximum number of portal scene capture passes submitted per frame (a per eye portal takes two, a nested capture one), portals over the budget keep their previous capture for another frame.\n")
+	TEXT(" 0: unlimited"),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPortalMaxRefreshInterval(
+	TEXT("r.Portal.MaxRefreshInterval"),
+	1,
+	TEXT("Maximum number of frames a small or distant portal may go between captures, its previous capture is reprojected in between.\n")
+	TEXT("Only applies to portals whose material implements the reprojection (the eyes' ReprojectionU/V/W parameters), the others are captured every frame.\n")
+	TEXT(" 1: every visible portal is captured every frame (default)"),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPortalRefreshMotionDistance(
+	TEXT("r.Portal.RefreshMotionDistance"),
+	10.0f,
+	TEXT("Distance (cm) a portal's capture camera can move away from where it was last captured before the portal is refreshed regardless of its refresh interval."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalRefreshMotionAngle(
+	TEXT("r.Portal.RefreshMotionAngle"),
+	5.0f,
+	TEXT("Angle (degrees) a portal's capture camera can turn away from how it was last captured before the portal is refreshed regardless of its refresh interval."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPortalRecursionMaxDepth(
+	TEXT("r.Portal.RecursionMaxDepth"),
+	2,
+	TEXT("How many levels of portals seen through portals are captured (at most 3), the deepest level shows the previous texture of the level above.\n")
+	TEXT(" 0: portals seen in other portals' captures show their own capture for the player's view"),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPortalMaxRecursiveCaptures(
+	TEXT("r.Portal.MaxRecursiveCapturesPerFrame"),
+	4,
+	TEXT("Maximum number of nested portal captures (portals seen through portals) per frame, portals over the budget show their previous nested capture.\n")
+	TEXT("Nested captures also take their pass and pixels from \"r.Portal.MaxCapturePassesPerFrame\" and the captured pixel budget, after the portals' own captures were scheduled."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPortalPVS(
+	TEXT("r.Portal.PVS"),
+	1,
+	TEXT("Whether the baked portal visibility (see the PortalVisibilityBake commandlet) culls portals before any other test.\n")
+	TEXT(" 0: baked visibility is ignored, to compare against the culling without it\n")
+	TEXT(" 1: portals that can't be seen from the camera's region or through the portal they would be captured in are culled (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPortalLateLatch(
+	TEXT("r.Portal.LateLatch"),
+	1,
+	TEXT("Whether the first player's portal captures are moved to the headset's newest pose on the render thread, along with the main view's late update.\n")
+	TEXT(" 0: captures are rendered from the pose the camera component had on the game thread\n")
+	TEXT(" 1: captures of portals whose material doesn't reproject them are late latched (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPortalStreaming(
+	TEXT("r.Portal.Streaming"),
+	1,
+	TEXT("Whether the streaming levels of portal destinations are loaded ahead of the player reaching the portal.\n")
+	TEXT(" 0: destination levels are left to the game's own level streaming, levels loaded by the portals are still released"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalStreamingPreloadSeconds(
+	TEXT("r.Portal.Streaming.PreloadSeconds"),
+	3.0f,
+	TEXT("A portal's destination levels start streaming in once the player would reach the portal within this many seconds at their current approach speed."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalStreamingPreloadDistance(
+	TEXT("r.Portal.Streaming.PreloadDistance"),
+	1500.0f,
+	TEXT("A portal's destination levels start streaming in once the player is this close (cm) to the portal, however fast they move."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalStreamingReleaseDistance(
+	TEXT("r.Portal.Streaming.ReleaseDistance"),
+	4000.0f,
+	TEXT("Destination levels are kept while the player is this close (cm) to either portal of the pair, further away they are released after \"r.Portal.Streaming.ReleaseDelay\"."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalWarmupSeconds(
+	TEXT("r.Portal.WarmupSeconds"),
+	1.0f,
+	TEXT("The exit portal's capture is warmed up at low resolution once the player would reach the entrance within this many seconds.\n")
+	TEXT(" 0: only the warm up distance is used"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalWarmupDistance(
+	TEXT("r.Portal.WarmupDistance"),
+	500.0f,
+	TEXT("The exit portal's capture is warmed up at low resolution once the player is this close (cm) to the entrance.\n")
+	TEXT(" 0: the exit portal is first captured when the player teleports"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalNetMaxCrossingError(
+	TEXT("r.Portal.Net.MaxCrossingError"),
+	100.0f,
+	TEXT("Distance (cm) between where a client says its character was when it crossed a portal and where the server has it, beyond which the server rejects the crossing."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalNetCorrectionWindow(
+	TEXT("r.Portal.Net.CorrectionWindow"),
+	1.0f,
+	TEXT("Seconds after a predicted portal crossing in which a character movement correction is counted as caused by the crossing, see \"Portal.Net.Stats\"."),
+	ECVF_Default);
+
+//Furthest (cm) a client's camera may be from its character's root when crossing, the headset moves freely within the play area around the root
+static constexpr float MaxCrossingCameraReach{ 300.0f };
+
+//Frames after a teleport measured for the entry hitch: the teleport's own frame, and the frames rendering the exit side for the first time on the render thread and GPU
+static constexpr int32 EntryHitchFrames{ 3 };
+
+//Full, three quarter, half and quarter resolution
+const float UPortalManagerSubsystem::ResolutionBucketScales[]{ 1.0f, 0.75f, 0.5f, 0.25f };
+const int32 UPortalManagerSubsystem::NumResolutionBuckets{ UE_ARRAY_COUNT(UPortalManagerSubsystem::ResolutionBucketScales) };
+
+//Minimum fraction of the screen a portal has to cover to prefer the bucket at the same index
+static const float ResolutionBucketCoverage[]{ 0.25f, 0.1f, 0.03f, 0.0f };
+
+//Minimum fraction of the screen a portal has to cover to be refreshed every (index + 1) frames
+static const float RefreshIntervalCoverage[]{ 0.1f, 0.03f, 0.01f, 0.0f };
+
+void FPortalManagerTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (TickGroup == TG_PostPhysics)
+	{
+		manager->PostPhysicsTick(DeltaTime);
+	}
+	else
+	{
+		manager->PostUpdateTick(DeltaTime);
+	}
+}
+
+FString FPortalManagerTickFunction::DiagnosticMessage()
+{
+	return TickGroup == TG_PostPhysics ? TEXT("UPortalManagerSubsystem[PostPhysicsTick]") : TEXT("UPortalManagerSubsystem[PostUpdateTick]");
+}
+
+UPortalManagerSubsystem::UPortalManagerSubsystem()
+	:bViewerCopiesDirty{ false }, bLateLatchCaptures{ false }, lastPredictedCrossingTime{ -DBL_MAX }, visibilityData{ nullptr }, renderTargetPool{ nullptr }, destinationStreaming{ nullptr }, capturePixelBudget{ 0 }, capturePixelsReserved{ 0 }, capturePassesReserved{ 0 },
+	smoothedFrameTimeMs{ 0.0f }, budgetScale{ 1.0f }, recursiveCapturesThisFrame{ 0 }, entryFramesLeft{ 0 }, entryMaxFrameMs{ 0.0f }, bEntryDestinationReady{ true },
+	bEntryWarmedUp{ true }, lastPostPhysicsTime{ 0.0 }, lastTraversalSeconds{ 0.0 }, lastTraversalCandidateCount{ 0 }, lastTraversalCount{ 0 }
+{
+	postPhysicsTick.bCanEverTick = true;
+	postPhysicsTick.TickGroup = TG_PostPhysics;
+	postUpdateTick.bCanEverTick = true;
+	postUpdateTick.TickGroup = TG_PostUpdateWork;
+
+	viewers.AddDefaulted();
+}
+
+void UPortalManagerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	renderTargetPool = NewObject<UPortalRenderTargetPool>(this);
+	destinationStreaming = NewObject<UPortalDestinationStreaming>(this);
+}
+
+void UPortalManagerSubsystem::Deinitialize()
+{
+	postPhysicsTick.UnRegisterTickFunction();
+	postUpdateTick.UnRegisterTickFunction();
+	renderTargetPool->ReleaseAll();
+	poseDeltaExtension.Reset();
+
+	Super::Deinitialize();
+}
+
+void UPortalManagerSubsystem::RegisterPortal(APortalVR* portal)
+{
+	//Copies render the level portal's view for another split screen player and share everything else with it
+	if (APortalVR* source{ portal->viewerSource })
+	{
+		viewers[portal->viewerIndex].portalCopies.AddUnique(portal);
+		portal->visibilityIndex = source->visibilityIndex;
+		portal->refreshPhase = source->refreshPhase + portal->viewerIndex;
+		portal->netId = source->netId;
+		return;
+	}
+
+	InitializePlayerAndTicks();
+	registeredPortals.AddUnique(portal);
+	bViewerCopiesDirty = true;
+
+	//Portals find their bit in the baked visibility by actor name, which stays the same in PIE and cooked builds
+	portal->visibilityIndex = visibilityData ? visibilityData->portalNames.IndexOfByKey(portal->GetFName()) : INDEX_NONE;
+
+	//Staggers the portals' refresh slots so portals sharing a refresh interval don't all become due on the same frame
+	portal->refreshPhase = registeredPortals.Num();
+
+	//Level placed portals have the same path on the server and every client once the PIE prefix is removed, 16 bits of its hash are enough for the handful of portals in a world
+	portal->netId = static_cast<uint16>(FCrc::StrCrc32(*UWorld::RemovePIEPrefix(portal->GetPathName())) & 0xFFFF);
+	APortalVR*& netPortal{ netPortals.FindOrAdd(portal->netId) };
+	if (netPortal && netPortal != portal)
+	{
+		UE_LOG(LogPortalManager, Warning, TEXT("%s and %s have the same network ID, crossings of %s can't be replicated. Rename one of them"),
+			*portal->GetName(), *netPortal->GetName(), *portal->GetName());
+		return;
+	}
+	netPortal = portal;
+}
+
+void UPortalManagerSubsystem::InitializePlayerAndTicks()
+{
+	if (postPhysicsTick.IsTickFunctionRegistered())
+	{
+		return;
+	}
+
+	UpdateLocalViewers();
+
+	//Baked next to the map by the PortalVisibilityBake commandlet, maps without it simply skip the visibility test
+	const FString visibilityPackageName{ UPortalVisibilityData::GetPackageNameForMap(GetWorld()->GetOutermost()->GetName()) };
+	const FString visibilityObjectPath{ visibilityPackageName + TEXT(".") + FPackageName::GetLongPackageAssetName(visibilityPackageName) };
+	visibilityData = LoadObject<UPortalVisibilityData>(nullptr, *visibilityObjectPath, nullptr, LOAD_NoWarn | LOAD_Quiet);
+
+	postPhysicsTick.manager = this;
+	postPhysicsTick.RegisterTickFunction(GetWorld()->PersistentLevel);
+	postUpdateTick.manager = this;
+	postUpdateTick.RegisterTickFunction(GetWorld()->PersistentLevel);
+
+	//Only needed with a headset, the extension late latches the captures and measures how far their pose is from the main view's late updated pose
+	if (GEngine->XRSystem.IsValid())
+	{
+		poseDeltaExtension = FSceneViewExtensions::NewExtension<FPortalPoseDeltaExtension>();
+	}
+}
+
+//The local player's part of the viewport, split screen divides the viewport between the players
+static FIntPoint GetLocalPlayerViewportSize(const ULocalPlayer* localPlayer)
+{
+	if (!localPlayer || !localPlayer->ViewportClient || !localPlayer->ViewportClient->Viewport)
+	{
+		return FIntPoint::ZeroValue;
+	}
+
+	//The split screen layout is only set once the viewport was first drawn with the player
+	const FIntPoint viewportSize{ localPlayer->ViewportClient->Viewport->GetSizeXY() };
+	const FVector2D size{ localPlayer->Size.IsNearlyZero() ? FVector2D::UnitVector : localPlayer->Size };
+	return FIntPoint{ FMath::RoundToInt(viewportSize.X * size.X), FMath::RoundToInt(viewportSize.Y * size.Y) };
+}
+
+void UPortalManagerSubsystem::UpdateLocalViewers()
+{
+	//GetFirstPlayerController() would return a remote player's controller on a server without local players, the game's local players are the split screen players in order
+	const TArray<ULocalPlayer*>& localPlayers{ GEngine->GetGamePlayers(GetWorld()) };
+	const int32 numViewers{ FMath::Max(localPlayers.Num(), 1) };
+
+	//Players leaving split screen take their portal copies with them, destroying a copy unregisters it
+	while (viewers.Num() > numViewers)
+	{
+		for (APortalVR* copy : TArray<APortalVR*>{ viewers.Last().portalCopies })
+		{
+			copy->Destroy();
+		}
+		viewers.Pop();
+		bViewerCopiesDirty = true;
+	}
+	if (viewers.Num() < numViewers)
+	{
+		viewers.SetNum(numViewers);
+		bViewerCopiesDirty = true;
+	}
+
+	for (int32 viewerIndex = 0; viewerIndex < numViewers; ++viewerIndex)
+	{
+		FPortalViewer& viewer{ viewers[viewerIndex] };
+		ULocalPlayer* localPlayer{ localPlayers.IsValidIndex(viewerIndex) ? localPlayers[viewerIndex] : nullptr };
+		APlayerController* localController{ localPlayer ? localPlayer->GetPlayerController(GetWorld()) : nullptr };
+		APortalCharacter* localCharacter{ localController ? Cast<APortalCharacter>(localController->GetPawn()) : nullptr };
+		const FIntPoint viewportSize{ GetLocalPlayerViewportSize(localPlayer) };
+		if (localController == viewer.controller && localCharacter == viewer.character && viewportSize == viewer.viewportSize)
+		{
+			continue;
+		}
+
+		if (localController != viewer.controller || localCharacter != viewer.character)
+		{
+			UE_LOG(LogPortalManager, Log, TEXT("Portals of player %d now render for %s"), viewerIndex, localCharacter ? *localCharacter->GetName() : TEXT("nobody"));
+		}
+
+		//A new controller doesn't hide the other players' portals yet
+		bViewerCopiesDirty |= localController != viewer.controller;
+
+		const bool bResized{ viewportSize != viewer.viewportSize };
+		viewer.controller = localController;
+		viewer.localPlayer = localPlayer;
+		viewer.character = localCharacter;
+		viewer.viewportSize = viewportSize;
+
+		for (APortalVR* portal : GetViewerPortals(viewerIndex))
+		{
+			portal->OnViewerChanged();
+
+			//Leased again at the new size on the next capture
+			if (bResized)
+			{
+				renderTargetPool->ReleaseRenderTargets(portal);
+			}
+		}
+	}
+
+	if (bViewerCopiesDirty)
+	{
+		bViewerCopiesDirty = false;
+		UpdateViewerCopies();
+		HideOtherViewersPortals();
+	}
+}
+
+APortalVR* UPortalManagerSubsystem::FindViewerPortal(APortalVR* portal, int32 viewerIndex) const
+{
+	if (viewerIndex == 0)
+	{
+		return portal;
+	}
+
+	APortalVR* const* copy{ viewers[viewerIndex].portalCopies.FindByPredicate([portal](const APortalVR* viewerPortal) { return viewerPortal->viewerSource == portal; }) };
+	return copy ? *copy : nullptr;
+}
+
+void UPortalManagerSubsystem::UpdateViewerCopies()
+{
+	for (int32 viewerIndex = 1; viewerIndex < viewers.Num(); ++viewerIndex)
+	{
+		/*
+		 * A copy takes everything from its level portal (Template), but it has to be connected to the exit portal's copy before it begins play, so all missing copies are spawned first,
+		 * then connected, and only then finish spawning. Portals whose exit portal isn't registered yet get their copy once it is
+		 */
+		TArray<APortalVR*> spawnedCopies;
+		for (APortalVR* portal : registeredPortals)
+		{
+			if (!portal->portalTarget || !registeredPortals.Contains(portal->portalTarget) || FindViewerPortal(portal, viewerIndex))
+			{
+				continue;
+			}
+
+			FActorSpawnParameters spawnParameters;
+			spawnParameters.Template = portal;
+			spawnParameters.OverrideLevel = portal->GetLevel();
+			spawnParameters.Name = MakeUniqueObjectName(portal->GetLevel(), portal->GetClass(), *FString::Printf(TEXT("%s_Player%d"), *portal->GetName(), viewerIndex));
+			spawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			spawnParameters.ObjectFlags |= RF_Transient;
+			spawnParameters.bDeferConstruction = true;
+			APortalVR* copy{ GetWorld()->SpawnActor<APortalVR>(portal->GetClass(), portal->GetActorTransform(), spawnParameters) };
+			if (!copy)
+			{
+				UE_LOG(LogPortalManager, Warning, TEXT("Couldn't spawn the copy of %s for player %d, it won't see the portal"), *portal->GetName(), viewerIndex);
+				continue;
+			}
+
+			//Only exists on this machine, every machine spawns copies for its own split screen players
+			copy->SetReplicates(false);
+			copy->viewerIndex = viewerIndex;
+			copy->viewerSource = portal;
+			spawnedCopies.Add(copy);
+		}
+
+		//The exit portal's copy may have been spawned just now, it only registers once it begins play
+		for (APortalVR* copy : spawnedCopies)
+		{
+			const APortalVR* exitPortal{ copy->viewerSource->portalTarget };
+			APortalVR* const* exitCopy{ spawnedCopies.FindByPredicate([exitPortal](const APortalVR* spawnedCopy) { return spawnedCopy->viewerSource == exitPortal; }) };
+			copy->portalTarget = exitCopy ? *exitCopy : FindViewerPortal(copy->viewerSource->portalTarget, viewerIndex);
+		}
+
+		for (APortalVR* copy : spawnedCopies)
+		{
+			copy->FinishSpawning(copy->viewerSource->GetActorTransform());
+		}
+	}
+}
+
+void UPortalManagerSubsystem::HideOtherViewersPortals()
+{
+	/*
+	 * Every player only sees the portals rendering for them, in their own view and in the captures of their portals.
+	 * Only portals are hidden and unhidden here, whatever else the game hides stays hidden
+	 */
+	for (int32 viewerIndex = 0; viewerIndex < viewers.Num(); ++viewerIndex)
+	{
+		TArray<AActor*> otherPortals;
+		for (int32 otherIndex = 0; otherIndex < viewers.Num(); ++otherIndex)
+		{
+			if (otherIndex != viewerIndex)
+			{
+				otherPortals.Append(GetViewerPortals(otherIndex));
+			}
+		}
+
+		auto hideOtherPortals = [&otherPortals](TArray<AActor*>& hiddenActors)
+		{
+			hiddenActors.RemoveAll([](const AActor* actor) { return !actor || actor->IsA<APortalVR>(); });
+			hiddenActors.Append(otherPortals);
+		};
+
+		if (APlayerController* controller{ viewers[viewerIndex].controller })
+		{
+			hideOtherPortals(controller->HiddenActors);
+		}
+		for (APortalVR* portal : GetViewerPortals(viewerIndex))
+		{
+			for (USceneCaptureComponent2D* capture : { portal->portalLeftCapture, portal->portalRightCapture })
+			{
+				if (capture)
+				{
+					hideOtherPortals(capture->HiddenActors);
+				}
+			}
+		}
+	}
+}
+
+void UPortalManagerSubsystem::UpdateViewFrame(int32 viewerIndex)
+{
+	FPortalViewer& viewer{ viewers[viewerIndex] };
+	FPortalViewFrame& viewFrame{ viewer.viewFrame };
+	FViewport* viewport{ viewer.localPlayer->ViewportClient->Viewport };
+	viewer.localPlayer->GetProjectionData(viewport, EStereoscopicPass::eSSP_LEFT_EYE, viewFrame.leftEye);
+	viewer.localPlayer->GetProjectionData(viewport, EStereoscopicPass::eSSP_RIGHT_EYE, viewFrame.rightEye);
+
+	//Only the first player can wear the headset, pose traces and the late latch are about its view
+	viewFrame.cameraTransform = viewer.character->Camera->GetComponentTransform();
+	if (viewerIndex == 0)
+	{
+		bLateLatchCaptures = false;
+		if (replayedView.IsSet())
+		{
+			ApplyReplayedView();
+		}
+		else
+		{
+			ReportCapturePose();
+		}
+	}
+	viewFrame.cameraLocation = viewFrame.cameraTransform.GetLocation();
+
+	viewFrame.leftViewProjection = viewFrame.leftEye.ComputeViewProjectionMatrix();
+	viewFrame.rightViewProjection = viewFrame.rightEye.ComputeViewProjectionMatrix();
+	GetViewFrustumBounds(viewFrame.leftFrustum, viewFrame.leftViewProjection, false);
+	GetViewFrustumBounds(viewFrame.rightFrustum, viewFrame.rightViewProjection, false);
+	viewFrame.visibilityCell = visibilityData ? visibilityData->GetCellIndex(viewFrame.cameraLocation) : INDEX_NONE;
+}
+
+void UPortalManagerSubsystem::ReportCapturePose()
+{
+	UCameraComponent* camera{ viewers[0].character->Camera };
+	if (!poseDeltaExtension.IsValid() || !camera->bLockToHmd)
+	{
+		return;
+	}
+
+	//The camera component's relative transform is the headset pose the camera manager applied, in the same tracking space as the late updated pose
+	poseDeltaExtension->SetCapturePose(camera->GetRelativeTransform(), camera->GetAttachParent() ? camera->GetAttachParent()->GetComponentTransform() : FTransform::Identity);
+	bLateLatchCaptures = CVarPortalLateLatch.GetValueOnGameThread() != 0;
+}
+
+void UPortalManagerSubsystem::ApplyReplayedView()
+{
+	FPortalViewFrame& viewFrame{ viewers[0].viewFrame };
+	UCameraComponent* camera{ viewers[0].character->Camera };
+	const FTransform parentTransform{ camera->GetAttachParent() ? camera->GetAttachParent()->GetComponentTransform() : FTransform::Identity };
+	viewFrame.cameraTransform = replayedView->cameraRelativeTransform * parentTransform;
+
+	const FMatrix viewRotationMatrix{ FPortalMath::MakeViewRotationMatrix(viewFrame.cameraTransform.Rotator()) };
+	viewFrame.leftEye.ViewOrigin = viewFrame.cameraTransform.TransformPosition(replayedView->leftEyeOffset);
+	viewFrame.leftEye.ViewRotationMatrix = viewRotationMatrix;
+	viewFrame.leftEye.ProjectionMatrix = replayedView->leftProjection;
+	viewFrame.rightEye.ViewOrigin = viewFrame.cameraTransform.TransformPosition(replayedView->rightEyeOffset);
+	viewFrame.rightEye.ViewRotationMatrix = viewRotationMatrix;
+	viewFrame.rightEye.ProjectionMatrix = replayedView->rightProjection;
+}
+
+void UPortalManagerSubsystem::PostPhysicsTick(float DeltaTime)
+{
+	PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalPostPhysicsTick, PostPhysicsTick);
+
+	UpdateLocalViewers();
+	preCharacterTrackingDelegate.Broadcast();
+
+	lastFrameCost = FPortalFrameCost{};
+	MeasureEntryHitch();
+	for (int32 viewerIndex = 0; viewerIndex < viewers.Num(); ++viewerIndex)
+	{
+		if (viewers[viewerIndex].character)
+		{
+			UpdateCharacterTracking(viewerIndex);
+		}
+	}
+	UpdateTraversals();
+}
+
+void UPortalManagerSubsystem::PostUpdateTick(float DeltaTime)
+{
+	PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalPostUpdateTick, PostUpdateTick);
+
+	//Dedicated servers have nobody to capture for, clients only once their pawn replicated
+	TArray<int32> viewerIndices;
+	for (int32 viewerIndex = 0; viewerIndex < viewers.Num(); ++viewerIndex)
+	{
+		const FPortalViewer& viewer{ viewers[viewerIndex] };
+		if (viewer.character && viewer.localPlayer && viewer.localPlayer->ViewportClient)
+		{
+			viewerIndices.Add(viewerIndex);
+		}
+	}
+	if (viewerIndices.Num() == 0)
+	{
+		return;
+	}
+
+	for (int32 viewerIndex : viewerIndices)
+	{
+		UpdateViewFrame(viewerIndex);
+	}
+	UpdateCaptures(viewerIndices);
+	UpdateDestinationStreaming(viewerIndices);
+
+	UpdateFrameBudget();
+
+	if (CVarPortalAdaptiveResolution.GetValueOnGameThread())
+	{
+		AllocateCaptureResolutions();
+	}
+
+	lastFrameCost.nestedCaptures = recursiveCapturesThisFrame;
+	ReportFrameCounts();
+
+	//Every portal reserves its pixels, passes and nested captures again next frame
+	capturePixelsReserved = 0;
+	capturePassesReserved = 0;
+	recursiveCapturesThisFrame = 0;
+
+	renderTargetPool->ReleaseIdleRenderTargets();
+}
+
+void UPortalManagerSubsystem::DumpPortalCosts(FOutputDevice& output) const
+{
+	TArray<const APortalVR*> portals;
+	for (int32 viewerIndex = 0; viewerIndex < viewers.Num(); ++viewerIndex)
+	{
+		portals.Append(GetViewerPortals(viewerIndex));
+	}
+	portals.Sort([](const APortalVR& a, const APortalVR& b)
+	{
+		return a.portalViewSeconds + a.portalSubmitSeconds > b.portalViewSeconds + b.portalSubmitSeconds;
+	});
+
+	static const TCHAR* const TierNames[]{ TEXT("Near"), TEXT("Mid"), TEXT("Far") };
+	output.Logf(TEXT("Portal costs of the last frame, %d portals, %.1f MB of render targets"), portals.Num(), renderTargetPool->GetCurrentBytes() / (1024.0 * 1024.0));
+	output.Logf(TEXT("%-32s %-5s %-8s %8s %9s %6s %6s %9s %8s %10s %8s"),
+		TEXT("Portal"), TEXT("Tier"), TEXT("State"), TEXT("Coverage"), TEXT("Distance"), TEXT("Bucket"), TEXT("Passes"), TEXT("RT KB"), TEXT("View ms"), TEXT("Submit ms"), TEXT("Age"));
+	for (const APortalVR* portal : portals)
+	{
+		const bool bCaptured{ portal->bCapturePrepared && portal->framesSinceCapture == 0 };
+		const TCHAR* state{ !portal->bCapturePrepared ? TEXT("Culled") : bCaptured ? TEXT("Captured") : !portal->bCaptureScheduled ? TEXT("Reused") : TEXT("Skipped") };
+		output.Logf(TEXT("%-32s %-5s %-8s %7.2f%% %9.0f %6d %6d %9lld %8.3f %10.3f %8d"),
+			*portal->GetName(), TierNames[static_cast<int32>(portal->lodTier)], state, portal->screenCoverage * 100.0f, portal->cameraDistance, portal->resolutionBucket,
+			portal->GetCapturePassCount(), renderTargetPool->GetLeasedBytes(portal) / 1024, portal->portalViewSeconds * 1000.0, portal->portalSubmitSeconds * 1000.0, portal->framesSinceCapture);
+	}
+}
+
+void UPortalManagerSubsystem::ReportFrameCounts() const
+{
+	//Split screen players' copies are prepared and culled like the level's portals
+	int32 viewerPortals{ 0 };
+	for (int32 viewerIndex = 0; viewerIndex < viewers.Num(); ++viewerIndex)
+	{
+		viewerPortals += GetViewerPortals(viewerIndex).Num();
+	}
+	const int32 culledPortals{ viewerPortals - lastFrameCost.activePortals };
+	SET_DWORD_STAT(STAT_PortalsRegistered, registeredPortals.Num());
+	SET_DWORD_STAT(STAT_PortalsActive, lastFrameCost.activePortals);
+	SET_DWORD_STAT(STAT_PortalsCulled, culledPortals);
+
+	CSV_CUSTOM_STAT(Portal, PortalsRegistered, registeredPortals.Num(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Portal, PortalsActive, lastFrameCost.activePortals, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Portal, PortalsCulled, culledPortals, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Portal, CapturePasses, lastFrameCost.capturePasses, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Portal, CapturePassesSkipped, lastFrameCost.skippedPasses, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Portal, NestedCaptures, lastFrameCost.nestedCaptures, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Portal, Teleports, lastFrameCost.teleports, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Portal, RenderTargetMB, static_cast<float>(renderTargetPool->GetCurrentBytes() / (1024.0 * 1024.0)), ECsvCustomStatOp::Set);
+}
+
+void UPortalManagerSubsystem::UpdateCharacterTracking(int32 viewerIndex)
+{
+	PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalCharacterTracking, UpdateCharacterTracking);
+	const double startTime{ FPlatformTime::Seconds() };
+	double teleportSeconds{ 0.0 };
+	const FPortalViewer& viewer{ viewers[viewerIndex] };
+	APortalCharacter* playerCharacter{ viewer.character };
+	const TArray<APortalVR*>& portals{ GetViewerPortals(viewerIndex) };
+	const FVector cameraLocation{ playerCharacter->Camera->GetComponentLocation() };
+	ParallelFor(portals.Num(), [&portals, &cameraLocation](int32 index)
+	{
+		portals[index]->UpdateCharacterTracking(cameraLocation);
+	}, !CVarPortalParallelPrepare.GetValueOnGameThread());
+
+	//The player can only go through one portal per frame, once teleported the camera is somewhere else entirely
+	for (APortalVR* portal : portals)
+	{
+		if (portal->bCameraCrossed)
+		{
+			const double teleportStartTime{ FPlatformTime::Seconds() };
+			BeginEntryHitch(portal);
+			if (playerCharacter->HasAuthority())
+			{
+				portal->TeleportCharacter(playerCharacter, playerCharacter->GetActorTransform());
+			}
+			else
+			{
+				PredictCrossing(viewer, portal);
+			}
+			teleportSeconds = FPlatformTime::Seconds() - teleportStartTime;
+			++lastFrameCost.teleports;
+			break;
+		}
+	}
+
+	//Next frame's segments start where the camera is now, after a teleport that is the exit portal's side
+	const FVector newCameraLocation{ playerCharacter->Camera->GetComponentLocation() };
+	for (APortalVR* portal : portals)
+	{
+		portal->prevCameraLocation = newCameraLocation;
+		portal->bCameraCrossed = false;
+	}
+
+	//Summed over the split screen players
+	lastFrameCost.teleportSeconds += teleportSeconds;
+	lastFrameCost.characterTrackingSeconds += FPlatformTime::Seconds() - startTime - teleportSeconds;
+}
+
+void UPortalManagerSubsystem::PredictCrossing(const FPortalViewer& viewer, APortalVR* portal)
+{
+	APortalCharacter* playerCharacter{ viewer.character };
+	const FTransform portalTransform{ portal->GetActorTransform() };
+	FPortalCrossingMessage message;
+	//A split screen player's copy has its level portal's network ID and transform, the server validates the crossing against the level portal
+	message.portalId = portal->netId;
+	message.characterLocation = portalTransform.InverseTransformPosition(playerCharacter->GetActorLocation());
+	message.characterRotation = portalTransform.InverseTransformRotation(playerCharacter->GetActorQuat()).Rotator();
+	message.prevCameraLocation = portalTransform.InverseTransformPosition(portal->prevCameraLocation);
+	message.cameraLocation = portalTransform.InverseTransformPosition(playerCharacter->Camera->GetComponentLocation());
+	const int32 messageBits{ message.Quantize() };
+
+	//Moves made on the entrance side reach the server before the crossing does, the moves after it are made from the exit side
+	playerCharacter->GetCharacterMovement()->FlushServerMoves();
+	portal->TeleportCharacter(playerCharacter, message.GetCharacterTransform(portalTransform));
+	playerCharacter->ServerPortalCrossing(message);
+
+	lastPredictedCrossingTime = FPlatformTime::Seconds();
+	++netStats.predictedCrossings;
+	netStats.totalCrossingBits += messageBits;
+	netStats.maxCrossingBits = FMath::Max(netStats.maxCrossingBits, messageBits);
+	INC_DWORD_STAT(STAT_PortalNetPredictedCrossings);
+	SET_DWORD_STAT(STAT_PortalNetCrossingBits, messageBits);
+}
+
+APortalVR* UPortalManagerSubsystem::FindPortalByNetId(uint16 netId) const
+{
+	APortalVR* const* portal{ netPortals.Find(netId) };
+	return portal ? *portal : nullptr;
+}
+
+void UPortalManagerSubsystem::ReceiveCrossing(APortalCharacter* character, const FPortalCrossingMessage& message)
+{
+	APortalVR* portal{ FindPortalByNetId(message.portalId) };
+	bool bValid{ portal && portal->portalTarget };
+	if (bValid)
+	{
+		//The same crossing test the client ran, on the segment it sent. The root has to be where the server has the character and the camera within reach of it, so a client can't cross from elsewhere
+		const FTransform portalTransform{ portal->GetActorTransform() };
+		const FTransform characterTransform{ message.GetCharacterTransform(portalTransform) };
+		const FVector cameraLocation{ portalTransform.TransformPosition(message.cameraLocation) };
+		bValid = FPortalMath::SegmentCrossesPortal(portal->GetPortalRect(), portalTransform.TransformPosition(message.prevCameraLocation), cameraLocation)
+			&& FVector::Dist(characterTransform.GetLocation(), character->GetActorLocation()) <= CVarPortalNetMaxCrossingError.GetValueOnGameThread()
+			&& FVector::Dist(cameraLocation, characterTransform.GetLocation()) <= MaxCrossingCameraReach;
+		if (bValid)
+		{
+			portal->TeleportCharacter(character, characterTransform);
+			++netStats.acceptedRemoteCrossings;
+			return;
+		}
+	}
+
+	UE_LOG(LogPortalManager, Warning, TEXT("Rejected the crossing of %s through %s"), *character->GetName(), portal ? *portal->GetName() : *FString::Printf(TEXT("unknown portal %u"), message.portalId));
+	++netStats.rejectedRemoteCrossings;
+	character->ClientRejectPortalCrossing(message.portalId);
+}
+
+void UPortalManagerSubsystem::OnCrossingRejected(uint16 portalId)
+{
+	const APortalVR* portal{ FindPortalByNetId(portalId) };
+	UE_LOG(LogPortalManager, Warning, TEXT("The server rejected the crossing through %s"), portal ? *portal->GetName() : *FString::Printf(TEXT("unknown portal %u"), portalId));
+	++netStats.rejectedCrossings;
+	INC_DWORD_STAT(STAT_PortalNetRejectedCrossings);
+}
+
+void UPortalManagerSubsystem::OnMovementCorrection()
+{
+	++netStats.corrections;
+	if (FPlatformTime::Seconds() - lastPredictedCrossingTime <= CVarPortalNetCorrectionWindow.GetValueOnGameThread())
+	{
+		++netStats.crossingCorrections;
+		INC_DWORD_STAT(STAT_PortalNetCrossingCorrections);
+	}
+}
+
+void UPortalManagerSubsystem::DumpNetStats(FOutputDevice& output) const
+{
+	const float averageBits{ netStats.predictedCrossings > 0 ? static_cast<float>(netStats.totalCrossingBits) / netStats.predictedCrossings : 0.0f };
+	output.Logf(TEXT("Portal crossings of %s (%s)"), *GetWorld()->GetName(), GetWorld()->GetNetMode() == NM_Client ? TEXT("client") : TEXT("server"));
+	output.Logf(TEXT("Predicted %d, rejected by the server %d, average %.1f bytes (%.0f bits), largest %d bits"),
+		netStats.predictedCrossings, netStats.rejectedCrossings, averageBits / 8.0f, averageBits, netStats.maxCrossingBits);
+	output.Logf(TEXT("Movement corrections %d, within %.1f s of a crossing %d"), netStats.corrections, CVarPortalNetCorrectionWindow.GetValueOnGameThread(), netStats.crossingCorrections);
+	output.Logf(TEXT("Remote player crossings validated %d, rejected %d"), netStats.acceptedRemoteCrossings, netStats.rejectedRemoteCrossings);
+}
+
+void UPortalManagerSubsystem::UpdateCaptures(const TArray<int32>& viewerIndices)
+{
+	{
+		PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalPrepareCaptures, PrepareCaptures);
+		for (int32 viewerIndex : viewerIndices)
+		{
+			const TArray<APortalVR*>& portals{ GetViewerPortals(viewerIndex) };
+			const FPortalViewFrame& viewFrame{ viewers[viewerIndex].viewFrame };
+			ParallelFor(portals.Num(), [&portals, &viewFrame](int32 index)
+			{
+				portals[index]->PrepareCapture(viewFrame, false);
+			}, !CVarPortalParallelPrepare.GetValueOnGameThread());
+		}
+	}
+
+	//Split screen players share the capture passes, the portals' own captures of every player are scheduled before any nested capture is submitted
+	const int32 maxPasses{ CVarPortalMaxCapturePasses.GetValueOnGameThread() };
+	const int32 maxViewerPasses{ maxPasses > 0 ? FMath::Max(maxPasses / viewerIndices.Num(), 1) : 0 };
+	for (int32 viewerIndex : viewerIndices)
+	{
+		for (const APortalVR* portal : GetViewerPortals(viewerIndex))
+		{
+			lastFrameCost.portalViewSeconds += portal->portalViewSeconds;
+		}
+
+		ScheduleCaptures(viewerIndex, maxViewerPasses, GFrameCounter);
+	}
+
+	//Budget reservations, render target leases, component updates and the captures themselves all touch engine state that is only safe on the game thread
+	PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalSubmitCaptures, SubmitCaptures);
+	const double startTime{ FPlatformTime::Seconds() };
+	for (int32 viewerIndex : viewerIndices)
+	{
+		for (APortalVR* portal : GetViewerPortals(viewerIndex))
+		{
+			SubmitPortalCapture(portal, false);
+
+			//Culled portals and due portals that didn't get a capture are skipped, portals that weren't due reuse their previous capture
+			const bool bCaptured{ portal->bCapturePrepared && portal->framesSinceCapture == 0 };
+			const bool bReused{ portal->bCapturePrepared && !portal->bCaptureScheduled };
+			lastFrameCost.activePortals += portal->bCapturePrepared ? 1 : 0;
+			lastFrameCost.capturePasses += bCaptured ? portal->GetCapturePassCount() : 0;
+			lastFrameCost.skippedPasses += !bCaptured && !bReused ? portal->GetCapturePassCount() : 0;
+		}
+	}
+	lastFrameCost.submitSeconds = FPlatformTime::Seconds() - startTime;
+}
+
+void UPortalManagerSubsystem::UpdateDestinationStreaming(const TArray<int32>& viewerIndices)
+{
+	const float worldTime{ GetWorld()->GetTimeSeconds() };
+	const bool bStreaming{ CVarPortalStreaming.GetValueOnGameThread() != 0 };
+	const float preloadSeconds{ CVarPortalStreamingPreloadSeconds.GetValueOnGameThread() };
+	const float preloadDistance{ CVarPortalStreamingPreloadDistance.GetValueOnGameThread() };
+	const float releaseDistance{ CVarPortalStreamingReleaseDistance.GetValueOnGameThread() };
+	const float warmupSeconds{ CVarPortalWarmupSeconds.GetValueOnGameThread() };
+	const float warmupDistance{ CVarPortalWarmupDistance.GetValueOnGameThread() };
+
+	TArray<FVector> cameraLocations;
+	for (int32 viewerIndex : viewerIndices)
+	{
+		const FPortalViewer& viewer{ viewers[viewerIndex] };
+		const FVector& cameraLocation{ viewer.viewFrame.cameraLocation };
+		cameraLocations.Add(cameraLocation);
+
+		//The player can only reach one portal next, the one reached soonest gets the exit of the player's copy warmed up
+		APortalVR* warmupPortal{ nullptr };
+		float warmupTimeToReach{ MAX_flt };
+		for (APortalVR* portal : GetViewerPortals(viewerIndex))
+		{
+			const APortalVR* exitPortal{ portal->portalTarget };
+			if (!exitPortal)
+			{
+				continue;
+			}
+
+			const float distance{ FVector::Distance(cameraLocation, portal->portalMesh->GetComponentLocation()) };
+			const float timeToReach{ GetTimeToReach(viewer, portal, distance) };
+			if (bStreaming && portal->destinationLevels.Num() > 0)
+			{
+				//Right after walking through, the player is next to the exit portal and far from this one, but still needs what is around the exit
+				const float exitDistance{ FVector::Distance(cameraLocation, exitPortal->portalMesh->GetComponentLocation()) };
+				const bool bLoad{ distance <= preloadDistance || timeToReach <= preloadSeconds };
+				const bool bKeep{ FMath::Min(distance, exitDistance) <= releaseDistance };
+				if (bLoad || bKeep)
+				{
+					destinationStreaming->RequestDestination(portal, worldTime, bLoad);
+				}
+			}
+
+			//Exit portals only become visible once the player came through, nothing captured them before and their first capture would add to the teleport's frame
+			const bool bApproaching{ distance <= warmupDistance || timeToReach <= warmupSeconds };
+			if (bApproaching && (!warmupPortal || timeToReach < warmupTimeToReach) && (!bStreaming || destinationStreaming->IsDestinationReady(portal)))
+			{
+				warmupPortal = portal;
+				warmupTimeToReach = timeToReach;
+			}
+		}
+
+		if (warmupPortal)
+		{
+			WarmUpCapture(warmupPortal->portalTarget);
+		}
+	}
+
+	//Levels loaded before streaming was turned off are still released
+	destinationStreaming->ReleaseUnneeded(worldTime, cameraLocations);
+	SET_DWORD_STAT(STAT_PortalStreamedLevels, destinationStreaming->GetOwnedLevelCount());
+}
+
+float UPortalManagerSubsystem::GetTimeToReach(const FPortalViewer& viewer, const APortalVR* portal, float distance) const
+{
+	//Head movement is left out, the character's velocity is what carries the player over longer distances
+	const FVector toPortal{ portal->portalMesh->GetComponentLocation() - viewer.viewFrame.cameraLocation };
+	const float approachSpeed{ FVector::DotProduct(viewer.character->GetVelocity(), toPortal.GetSafeNormal()) };
+	return approachSpeed > KINDA_SMALL_NUMBER ? distance / approachSpeed : MAX_flt;
+}
+
+void UPortalManagerSubsystem::WarmUpCapture(APortalVR* portal)
+{
+	//Already warmed up, the render targets stay leased for as long as the player keeps approaching
+	if (portal->renderLeftTarget)
+	{
+		renderTargetPool->TouchRenderTargets(portal);
+		return;
+	}
+
+	/*
+	 * The teleport's forced capture then reuses these render targets. Only the budget bucket is lowered, the allocated bucket and its hysteresis are left as they were,
+	 * so once the portal is seen after the teleport AllocateCaptureResolutions() brings it straight back to its previous bucket instead of holding the warm up's for the hysteresis frames
+	 */
+	if (CVarPortalAdaptiveResolution.GetValueOnGameThread())
+	{
+		portal->budgetResolutionBucket = NumResolutionBuckets - 1;
+	}
+
+	//Through the exit portal the capture sees what is around the entrance, what the player looks back at after coming through. Nested portals aren't warmed up
+	const FPortalViewFrame& viewFrame{ viewers[portal->viewerIndex].viewFrame };
+	portal->PrepareCapture(viewFrame, true);
+	portal->SubmitCapture(viewFrame, true);
+	INC_DWORD_STAT(STAT_PortalCaptureWarmups);
+}
+
+void UPortalManagerSubsystem::BeginEntryHitch(const APortalVR* portal)
+{
+	entryPortal = portal->portalTarget;
+	entryFramesLeft = EntryHitchFrames;
+	entryMaxFrameMs = 0.0f;
+	bEntryDestinationReady = destinationStreaming->IsDestinationReady(portal);
+	bEntryWarmedUp = portal->portalTarget->renderLeftTarget != nullptr;
+
+	if (!bEntryDestinationReady)
+	{
+		UE_LOG(LogPortalManager, Warning, TEXT("Teleported through %s before its destination levels finished streaming in"), *portal->GetName());
+	}
+}
+
+void UPortalManagerSubsystem::MeasureEntryHitch()
+{
+	const double now{ FPlatformTime::Seconds() };
+	const float frameMs{ static_cast<float>((now - lastPostPhysicsTime) * 1000.0) };
+	lastPostPhysicsTime = now;
+	if (entryFramesLeft <= 0)
+	{
+		return;
+	}
+
+	entryMaxFrameMs = FMath::Max(entryMaxFrameMs, frameMs);
+	if (--entryFramesLeft > 0)
+	{
+		return;
+	}
+
+	if (entryMaxFrameMs > CVarPortalTargetFrameTime.GetValueOnGameThread() * 2.0f)
+	{
+		lastFrameCost.entryHitchMs = entryMaxFrameMs;
+		INC_DWORD_STAT(STAT_PortalEntryHitches);
+		SET_FLOAT_STAT(STAT_PortalEntryHitchTime, entryMaxFrameMs);
+		CSV_CUSTOM_STAT(Portal, EntryHitchMs, entryMaxFrameMs, ECsvCustomStatOp::Set);
+		CSV_EVENT(Portal, TEXT("Portal entry hitch"));
+		UE_LOG(LogPortalManager, Warning, TEXT("Coming out of %s hitched, %.1f ms frame (destination streamed in: %s, exit capture warmed up: %s)"),
+			entryPortal.IsValid() ? *entryPortal->GetName() : TEXT("a destroyed portal"), entryMaxFrameMs, bEntryDestinationReady ? TEXT("yes") : TEXT("no"), bEntryWarmedUp ? TEXT("yes") : TEXT("no"));
+	}
+	entryPortal.Reset();
+}
+
+void UPortalManagerSubsystem::SubmitPortalCapture(APortalVR* portal, bool bForce)
+{
+	/*
+	 * Material parameter updates and scene captures reach the render thread in the order they are submitted,
+	 * so a nested portal's material shows its nested capture while this capture renders and its own capture again in everything submitted after it
+	 */
+	const double startTime{ FPlatformTime::Seconds() };
+	const FPortalViewFrame& viewFrame{ viewers[portal->viewerIndex].viewFrame };
+	TArray<APortalVR*> nestedPortals;
+	if (portal->bCapturePrepared && portal->bCaptureScheduled)
+	{
+		FPortalRecursionView view;
+		portal->GetRecursionView(viewFrame, view);
+		CaptureNestedPortals(view, 1, nestedPortals);
+	}
+
+	//A reprojecting material maps the capture with the game thread pose, moving the capture would misplace it
+	if (bLateLatchCaptures && portal->viewerIndex == 0 && portal->bCapturePrepared && portal->bCaptureScheduled && !portal->bMaterialHasReprojection)
+	{
+		poseDeltaExtension->AddLatchedCapture(portal->captureLocation, portal->captureRotation, portal->GetThroughMatrix());
+	}
+	portal->SubmitCapture(viewFrame, bForce);
+
+	for (APortalVR* nestedPortal : nestedPortals)
+	{
+		nestedPortal->ApplyMaterialState(nestedPortal->capturedMaterialState);
+	}
+	portal->portalSubmitSeconds = FPlatformTime::Seconds() - startTime;
+}
+
+void UPortalManagerSubsystem::CaptureNestedPortals(const FPortalRecursionView& parentView, int32 level, TArray<APortalVR*>& outNestedPortals)
+{
+	const int32 maxDepth{ GetRecursionMaxDepth() };
+	if (maxDepth == 0)
+	{
+		return;
+	}
+
+	//Only the portals rendering for the same player, the others are hidden from the parent's capture
+	for (APortalVR* portal : GetViewerPortals(parentView.portal->viewerIndex))
+	{
+		if (portal->CaptureNested(parentView, level, maxDepth))
+		{
+			outNestedPortals.Add(portal);
+		}
+	}
+}
+
+bool UPortalManagerSubsystem::IsPotentiallyVisible(const APortalVR* portal, int32 visibilityCell) const
+{
+	if (!visibilityData || visibilityCell == INDEX_NONE || portal->visibilityIndex == INDEX_NONE || !CVarPortalPVS.GetValueOnAnyThread())
+	{
+		return true;
+	}
+
+	return visibilityData->IsVisibleFromCell(visibilityCell, portal->visibilityIndex);
+}
+
+bool UPortalManagerSubsystem::IsPotentiallyVisibleThrough(const APortalVR* throughPortal, const APortalVR* portal) const
+{
+	if (!visibilityData || throughPortal->visibilityIndex == INDEX_NONE || portal->visibilityIndex == INDEX_NONE || !CVarPortalPVS.GetValueOnAnyThread())
+	{
+		return true;
+	}
+
+	return visibilityData->IsVisibleThrough(throughPortal->visibilityIndex, portal->visibilityIndex);
+}
+
+int32 UPortalManagerSubsystem::GetRecursionMaxDepth()
+{
+	return FMath::Clamp(CVarPortalRecursionMaxDepth.GetValueOnGameThread(), 0, APortalVR::MaxRecursionDepth);
+}
+
+bool UPortalManagerSubsystem::ReserveRecursiveCapture(int32 level, int32 maxDepth, const FIntPoint& size)
+{
+	const int32 maxPasses{ CVarPortalMaxCapturePasses.GetValueOnGameThread() };
+	if (level > maxDepth || recursiveCapturesThisFrame >= CVarPortalMaxRecursiveCaptures.GetValueOnGameThread() || (maxPasses > 0 && capturePassesReserved >= maxPasses))
+	{
+		return false;
+	}
+
+	//Unlike a portal's own capture a nested one doesn't step down to smaller buckets, its size follows from the parent's capture
+	if (CVarPortalAdaptiveResolution.GetValueOnGameThread())
+	{
+		const int64 budget{ capturePixelBudget > 0 ? capturePixelBudget : MAX_int64 };
+		const int64 pixels{ static_cast<int64>(size.X) * size.Y };
+		if (capturePixelsReserved + pixels > budget)
+		{
+			return false;
+		}
+
+		capturePixelsReserved += pixels;
+		INC_DWORD_STAT_BY(STAT_PortalCapturedPixels, pixels);
+	}
+
+	++capturePassesReserved;
+	++recursiveCapturesThisFrame;
+	return true;
+}
+
+void UPortalManagerSubsystem::ReleaseRecursiveCapture(const FIntPoint& size)
+{
+	if (CVarPortalAdaptiveResolution.GetValueOnGameThread())
+	{
+		const int64 pixels{ static_cast<int64>(size.X) * size.Y };
+		capturePixelsReserved -= pixels;
+		DEC_DWORD_STAT_BY(STAT_PortalCapturedPixels, pixels);
+	}
+
+	--capturePassesReserved;
+	--recursiveCapturesThisFrame;
+}
+
+void UPortalManagerSubsystem::UnregisterPortal(APortalVR* portal)
+{
+	renderTargetPool->ReleaseRenderTargets(portal);
+	if (portal->viewerSource)
+	{
+		if (viewers.IsValidIndex(portal->viewerIndex))
+		{
+			viewers[portal->viewerIndex].portalCopies.RemoveSingleSwap(portal);
+		}
+		return;
+	}
+
+	//The split screen players' copies go with their destroyed level portal, levels being unloaded or torn down remove the copies along with it
+	if (portal->IsActorBeingDestroyed())
+	{
+		for (int32 viewerIndex = 1; viewerIndex < viewers.Num(); ++viewerIndex)
+		{
+			if (APortalVR* copy{ FindViewerPortal(portal, viewerIndex) })
+			{
+				copy->Destroy();
+			}
+		}
+	}
+
+	registeredPortals.RemoveSingleSwap(portal);
+	bViewerCopiesDirty = true;
+	if (FindPortalByNetId(portal->netId) == portal)
+	{
+		netPortals.Remove(portal->netId);
+	}
+	traversalCandidates.Remove(portal);
+}
+
+void FPortalTraversalCandidates::RemoveAtSwap(int32 index)
+{
+	bodies.RemoveAtSwap(index, 1, false);
+	prevLocations.RemoveAtSwap(index);
+}
+
+void UPortalManagerSubsystem::AddTraversalCandidate(APortalVR* portal, UPrimitiveComponent* body)
+{
+	//The first segment tested starts where the body entered the box
+	FPortalTraversalCandidates& candidates{ traversalCandidates.FindOrAdd(portal) };
+	if (!candidates.bodies.Contains(body))
+	{
+		candidates.bodies.Add(body);
+		candidates.prevLocations.Add(body->GetComponentLocation());
+	}
+}
+
+void UPortalManagerSubsystem::RemoveTraversalCandidate(APortalVR* portal, UPrimitiveComponent* body)
+{
+	FPortalTraversalCandidates* candidates{ traversalCandidates.Find(portal) };
+	if (!candidates)
+	{
+		return;
+	}
+
+	const int32 index{ candidates->bodies.IndexOfByKey(body) };
+	if (index != INDEX_NONE)
+	{
+		candidates->RemoveAtSwap(index);
+	}
+}
+
+void UPortalManagerSubsystem::UpdateTraversals()
+{
+	PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalTraversal, Traversal);
+	const double startTime{ FPlatformTime::Seconds() };
+
+	struct FPendingTraversal
+	{
+		UPrimitiveComponent* body;
+		FVector location;
+		FQuat rotation;
+		FVector linearVelocity;
+		FVector angularVelocity;
+	};
+	TArray<FPendingTraversal> pendingTraversals;
+
+	//Scratch arrays reused between portals
+	FPortalVectorArray currentLocations;
+	TArray<bool> crossed;
+	TArray<UPrimitiveComponent*> crossedBodies;
+	FPortalVectorArray locations, linearVelocities, angularVelocities;
+	FPortalQuatArray rotations;
+
+	int32 candidateCount{ 0 };
+	for (TPair<APortalVR*, FPortalTraversalCandidates>& portalCandidates : traversalCandidates)
+	{
+		APortalVR* portal{ portalCandidates.Key };
+		FPortalTraversalCandidates& candidates{ portalCandidates.Value };
+
+		//Bodies destroyed inside the box never send an end overlap
+		for (int32 index = candidates.bodies.Num() - 1; index >= 0; --index)
+		{
+			if (!candidates.bodies[index].IsValid())
+			{
+				candidates.RemoveAtSwap(index);
+			}
+		}
+
+		const int32 numBodies{ candidates.bodies.Num() };
+		if (numBodies == 0)
+		{
+			continue;
+		}
+		candidateCount += numBodies;
+
+		currentLocations.SetNum(numBodies);
+		for (int32 index = 0; index < numBodies; ++index)
+		{
+			currentLocations.Set(index, candidates.bodies[index]->GetComponentLocation());
+		}
+
+		FPortalMath::SegmentsCrossPortal(portal->GetPortalRect(), candidates.prevLocations, currentLocations, crossed);
+
+		crossedBodies.Reset();
+		for (int32 index = 0; index < numBodies; ++index)
+		{
+			UPrimitiveComponent* body{ candidates.bodies[index].Get() };
+			if (crossed[index] && body->IsSimulatingPhysics())
+			{
+				crossedBodies.Add(body);
+			}
+		}
+
+		//Next frame's segments start where the bodies are now
+		Swap(candidates.prevLocations, currentLocations);
+
+		const int32 numCrossed{ crossedBodies.Num() };
+		if (numCrossed == 0)
+		{
+			continue;
+		}
+
+		locations.SetNum(numCrossed);
+		rotations.SetNum(numCrossed);
+		linearVelocities.SetNum(numCrossed);
+		angularVelocities.SetNum(numCrossed);
+		for (int32 index = 0; index < numCrossed; ++index)
+		{
+			const UPrimitiveComponent* body{ crossedBodies[index] };
+			locations.Set(index, body->GetComponentLocation());
+			rotations.Set(index, body->GetComponentQuat());
+			linearVelocities.Set(index, body->GetPhysicsLinearVelocity());
+			angularVelocities.Set(index, body->GetPhysicsAngularVelocityInRadians());
+		}
+
+		//Angular velocity is an axis scaled by the rate of rotation, the through matrix is a proper rotation (the mirroring is a 180 degree turn) so it transforms like any other direction
+		const FMatrix& throughMatrix{ portal->GetThroughMatrix() };
+		FPortalMath::TransformPositions(throughMatrix, locations, locations);
+		FPortalMath::TransformRotations(throughMatrix, rotations, rotations);
+		FPortalMath::TransformDirections(throughMatrix, linearVelocities, linearVelocities);
+		FPortalMath::TransformDirections(throughMatrix, angularVelocities, angularVelocities);
+
+		for (int32 index = 0; index < numCrossed; ++index)
+		{
+			pendingTraversals.Add(FPendingTraversal{ crossedBodies[index], locations.Get(index), rotations.Get(index), linearVelocities.Get(index), angularVelocities.Get(index) });
+		}
+	}
+
+	//Teleporting fires the overlap events that move the bodies from this portal's candidates to the exit portal's, so the candidates can't be touched until every portal was tested
+	for (const FPendingTraversal& traversal : pendingTraversals)
+	{
+		traversal.body->SetWorldLocationAndRotation(traversal.location, traversal.rotation, false, nullptr, ETeleportType::TeleportPhysics);
+		traversal.body->SetPhysicsLinearVelocity(traversal.linearVelocity);
+		traversal.body->SetPhysicsAngularVelocityInRadians(traversal.angularVelocity);
+	}
+
+	INC_DWORD_STAT_BY(STAT_PortalTraversalCandidates, candidateCount);
+	INC_DWORD_STAT_BY(STAT_PortalTraversals, pendingTraversals.Num());
+	lastTraversalCandidateCount = candidateCount;
+	lastTraversalCount = pendingTraversals.Num();
+	lastTraversalSeconds = FPlatformTime::Seconds() - startTime;
+}
+
+void UPortalManagerSubsystem::ScheduleCaptures(int32 viewerIndex, int32 maxViewerPasses, uint64 frameNumber)
+{
+	const int32 maxRefreshInterval{ FMath::Clamp(CVarPortalMaxRefreshInterval.GetValueOnGameThread(), 1, UE_ARRAY_COUNT(RefreshIntervalCoverage)) };
+
+	TArray<APortalVR*> duePortals;
+	for (APortalVR* portal : GetViewerPortals(viewerIndex))
+	{
+		if (!portal->bCapturePrepared)
+		{
+			continue;
+		}
+
+		//Far tier portals show a snapshot that the material keeps on the portal's surface, at that distance its parallax error only builds up slowly
+		if (portal->lodTier == EPortalLODTier::Far)
+		{
+			if (portal->NeedsCapture() || GetWorld()->GetTimeSeconds() - portal->capturedTime >= portal->farTierRefreshSeconds)
+			{
+				duePortals.Add(portal);
+			}
+			continue;
+		}
+
+		/*
+		 * A portal is due on its refresh slot, every refreshInterval frames offset by its phase.
+		 * Portals that missed their slot (over the pass budget or their interval just changed) are due until they are captured
+		 */
+		portal->refreshInterval = GetRefreshInterval(portal, maxRefreshInterval);
+		const bool bRefreshSlot{ (frameNumber + portal->refreshPhase) % portal->refreshInterval == 0 };
+		if (bRefreshSlot || portal->framesSinceCapture > portal->refreshInterval || portal->NeedsCapture())
+		{
+			duePortals.Add(portal);
+		}
+	}
+
+	/*
+	 * Most overdue relative to their refresh interval first, larger portals first when they are equally overdue.
+	 * Portals that don't fit in this frame's passes are even more overdue next frame, so the load spreads over the following frames by itself
+	 */
+	duePortals.Sort([](const APortalVR& a, const APortalVR& b)
+	{
+		const int32 aOverdue{ a.framesSinceCapture * b.refreshInterval };
+		const int32 bOverdue{ b.framesSinceCapture * a.refreshInterval };
+		return aOverdue != bOverdue ? aOverdue > bOverdue : a.screenCoverage > b.screenCoverage;
+	});
+
+	//The portals' own captures are scheduled before any nested capture is submitted, nested captures only get the passes left over
+	int32 viewerPassesReserved{ 0 };
+	for (APortalVR* portal : duePortals)
+	{
+		//At least one portal is captured every frame for every player, so a single portal never starves
+		const int32 portalPasses{ portal->GetCapturePassCount() };
+		if (maxViewerPasses > 0 && viewerPassesReserved > 0 && viewerPassesReserved + portalPasses > maxViewerPasses)
+		{
+			INC_DWORD_STAT_BY(STAT_PortalCapturesDeferred, portalPasses);
+			continue;
+		}
+
+		viewerPassesReserved += portalPasses;
+		portal->bCaptureScheduled = true;
+	}
+	capturePassesReserved += viewerPassesReserved;
+}
+
+int32 UPortalManagerSubsystem::GetRefreshInterval(const APortalVR* portal, int32 maxRefreshInterval) const
+{
+	//Portals the player is stepping through are always refreshed, the reprojection can't hide anything that close. Without the reprojection in the material a skipped capture would slide along with the view
+	if (maxRefreshInterval <= 1 || !portal->bMaterialHasReprojection || portal->IsLocationNearPortal(viewers[portal->viewerIndex].viewFrame.cameraLocation))
+	{
+		return 1;
+	}
+
+	//Fast changing portals are refreshed as soon as their view drifted too far from the last capture, reprojecting only the portal's plane would show the parallax error
+	const bool bMovedTooFar{ FVector::DistSquared(portal->captureLocation, portal->capturedLocation) > FMath::Square(CVarPortalRefreshMotionDistance.GetValueOnGameThread()) };
+	const bool bTurnedTooFar{ FMath::RadiansToDegrees(portal->captureRotation.Quaternion().AngularDistance(portal->capturedRotation)) > CVarPortalRefreshMotionAngle.GetValueOnGameThread() };
+	if (bMovedTooFar || bTurnedTooFar)
+	{
+		return 1;
+	}
+
+	for (int32 interval = 1; interval < maxRefreshInterval; ++interval)
+	{
+		if (portal->screenCoverage >= RefreshIntervalCoverage[interval - 1])
+		{
+			return interval;
+		}
+	}
+	return maxRefreshInterval;
+}
+
+int32 UPortalManagerSubsystem::ReserveCapturePixels(const APortalVR* portal, int32 desiredBucket, bool bForce)
+{
+	if (!CVarPortalAdaptiveResolution.GetValueOnGameThread())
+	{
+		return 0;
+	}
+
+	//Budget of the first frame is not known yet, let everything through
+	const int64 budget{ capturePixelBudget > 0 ? capturePixelBudget : MAX_int64 };
+
+	for (int32 bucket = FMath::Clamp(desiredBucket, 0, NumResolutionBuckets - 1); bucket < NumResolutionBuckets; ++bucket)
+	{
+		const int64 pixels{ portal->GetCapturePixelCount(bucket) };
+		if (capturePixelsReserved + pixels <= budget || (bForce && bucket == NumResolutionBuckets - 1))
+		{
+			capturePixelsReserved += pixels;
+			INC_DWORD_STAT_BY(STAT_PortalCapturedPixels, pixels);
+			return bucket;
+		}
+	}
+
+	INC_DWORD_STAT(STAT_PortalsOverBudget);
+	return INDEX_NONE;
+}
+
+void UPortalManagerSubsystem::ReleaseCapturePixels(const APortalVR* portal, int32 bucket)
+{
+	if (!CVarPortalAdaptiveResolution.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	const int64 pixels{ portal->GetCapturePixelCount(bucket) };
+	capturePixelsReserved -= pixels;
+	DEC_DWORD_STAT_BY(STAT_PortalCapturedPixels, pixels);
+}
+
+void UPortalManagerSubsystem::UpdateFrameBudget()
+{
+	//The frame is bound by whichever of the game thread, render thread and GPU is slowest
+	const uint32 frameCycles{ FMath::Max3(GGameThreadTime, GRenderThreadTime, RHIGetGPUFrameCycles()) };
+	const float frameTimeMs{ static_cast<float>(FPlatformTime::ToMilliseconds(frameCycles)) };
+	smoothedFrameTimeMs = smoothedFrameTimeMs <= 0.0f ? frameTimeMs : FMath::Lerp(smoothedFrameTimeMs, frameTimeMs, 0.1f);
+
+	//Shrink the budget quickly when over the target frame time and grow it back slowly once there is some headroom
+	const float targetFrameTimeMs{ CVarPortalTargetFrameTime.GetValueOnGameThread() };
+	if (smoothedFrameTimeMs > targetFrameTimeMs)
+	{
+		budgetScale = FMath::Max(budgetScale * 0.95f, 0.25f);
+	}
+	else if (smoothedFrameTimeMs < targetFrameTimeMs * 0.9f)
+	{
+		budgetScale = FMath::Min(budgetScale * 1.02f, 1.0f);
+	}
+
+	capturePixelBudget = static_cast<int64>(CVarPortalMaxCapturedPixels.GetValueOnGameThread() * budgetScale);
+	SET_FLOAT_STAT(STAT_PortalBudgetScale, budgetScale);
+}
+
+void UPortalManagerSubsystem::AllocateCaptureResolutions()
+{
+	//Only portals that were visible this frame compete for the budget, the others keep their current bucket until they are seen again. Split screen players share the budget
+	TArray<APortalVR*> visiblePortals;
+	for (int32 viewerIndex = 0; viewerIndex < viewers.Num(); ++viewerIndex)
+	{
+		for (APortalVR* portal : GetViewerPortals(viewerIndex))
+		{
+			if (portal->screenCoverage > 0.0f)
+			{
+				visiblePortals.Add(portal);
+			}
+		}
+	}
+
+	//Largest portals first, nearest first when they cover the same amount of the screen
+	visiblePortals.Sort([](const APortalVR& a, const APortalVR& b)
+	{
+		return a.screenCoverage != b.screenCoverage ? a.screenCoverage > b.screenCoverage : a.cameraDistance < b.cameraDistance;
+	});
+
+	const int32 hysteresisFrames{ CVarPortalResolutionHysteresis.GetValueOnGameThread() };
+	int64 remainingPixels{ capturePixelBudget };
+	for (APortalVR* portal : visiblePortals)
+	{
+		//Only follow the preferred bucket once it has been stable for a while so targets aren't reallocated every frame
+		const int32 preferredBucket{ GetPreferredResolutionBucket(portal->screenCoverage) };
+		if (preferredBucket != portal->allocatedResolutionBucket && ++portal->pendingResolutionFrames >= hysteresisFrames)
+		{
+			portal->allocatedResolutionBucket = preferredBucket;
+			portal->pendingResolutionFrames = 0;
+		}
+		else if (preferredBucket == portal->allocatedResolutionBucket)
+		{
+			portal->pendingResolutionFrames = 0;
+		}
+
+		//The budget itself is never subject to hysteresis, step down right away when the portal doesn't fit anymore and back up once it fits again, the allocated bucket stays as it is
+		int32 bucket{ portal->allocatedResolutionBucket };
+		while (bucket < NumResolutionBuckets - 1 && portal->GetCapturePixelCount(bucket) > remainingPixels)
+		{
+			++bucket;
+		}
+		portal->budgetResolutionBucket = bucket;
+		remainingPixels -= portal->GetCapturePixelCount(bucket);
+	}
+}
+
+int32 UPortalManagerSubsystem::GetPreferredResolutionBucket(float screenCoverage)
+{
+	for (int32 bucket = 0; bucket < NumResolutionBuckets; ++bucket)
+	{
+		if (screenCoverage >= ResolutionBucketCoverage[bucket])
+		{
+			return bucket;
+		}
+	}
+	return NumResolutionBuckets - 1;
+}
+
+static void DumpPortalCosts(const TArray<FString>& args, UWorld* world, FOutputDevice& output)
+{
+	if (UPortalManagerSubsystem* portalManager{ world ? world->GetSubsystem<UPortalManagerSubsystem>() : nullptr })
+	{
+		portalManager->DumpPortalCosts(output);
+	}
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice PortalDumpCostsCommand(
+	TEXT("Portal.DumpCosts"),
+	TEXT("Prints every portal's LOD tier, capture state, screen coverage, render target memory and last frame game thread cost, most expensive first."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&DumpPortalCosts));
+
+static void DumpPortalNetStats(const TArray<FString>& args, UWorld* world, FOutputDevice& output)
+{
+	if (UPortalManagerSubsystem* portalManager{ world ? world->GetSubsystem<UPortalManagerSubsystem>() : nullptr })
+	{
+		portalManager->DumpNetStats(output);
+	}
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice PortalNetStatsCommand(
+	TEXT("Portal.Net.Stats"),
+	TEXT("Prints the predicted, validated and rejected portal crossings of this world, the movement corrections after them and the bits sent per crossing."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&DumpPortalNetStats));
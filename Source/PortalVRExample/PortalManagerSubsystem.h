@@ -0,0 +1,452 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ConvexVolume.h"
+#include "Engine/EngineBaseTypes.h"
+#include "PortalMath.h"
+#include "SceneView.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PortalManagerSubsystem.generated.h"
+
+//The player's view for the current frame, fetched once by the portal manager and shared by every portal
+struct FPortalViewFrame
+{
+	//Projection data of the player's eyes
+	FSceneViewProjectionData leftEye;
+	FSceneViewProjectionData rightEye;
+	FMatrix leftViewProjection;
+	FMatrix rightViewProjection;
+	FConvexVolume leftFrustum;
+	FConvexVolume rightFrustum;
+
+	//Pose of the player camera (VR headset)
+	FTransform cameraTransform;
+	FVector cameraLocation;
+
+	//Region of the baked portal visibility the camera is in, INDEX_NONE without visibility data or outside its grid
+	int32 visibilityCell{ INDEX_NONE };
+};
+
+/*
+ * A local player the portals render for, split screen has one per player. The level's portals render for the first one and every other one gets its own copy of each portal
+ * (see APortalVR::viewerIndex), a portal's material, captures and render targets only hold one view
+ */
+USTRUCT()
+struct FPortalViewer
+{
+	GENERATED_BODY()
+
+	//Not set on dedicated servers, and on clients until their pawn replicated
+	UPROPERTY()
+	APlayerController* controller{ nullptr };
+	UPROPERTY()
+	ULocalPlayer* localPlayer{ nullptr };
+	UPROPERTY()
+	class APortalCharacter* character{ nullptr };
+
+	//Copies of the level's portals rendering for this player, empty for the first player who sees the level's portals themselves
+	UPROPERTY()
+	TArray<class APortalVR*> portalCopies;
+
+	//The player's part of the viewport, the portals' render targets are sized from it
+	FIntPoint viewportSize{ 0, 0 };
+
+	//The player's view of the current frame
+	FPortalViewFrame viewFrame;
+};
+
+//Player view of a replayed pose trace, used by UpdateViewFrame() instead of the local player's while set, see "Portal.Trace.Replay"
+struct FPortalReplayedView
+{
+	//Pose of the camera relative to its parent (VROrigin) the captures were positioned from
+	FTransform cameraRelativeTransform;
+	//Eye positions in camera space and the eyes' projections, both eyes look along the camera
+	FVector leftEyeOffset;
+	FVector rightEyeOffset;
+	FMatrix leftProjection;
+	FMatrix rightProjection;
+};
+
+//A capture's view as seen by the portals inside it, one per recursion level of portals seen through portals
+struct FPortalRecursionView
+{
+	//Portal whose capture this is
+	const class APortalVR* portal{ nullptr };
+	//Pose of the capture camera
+	FTransform viewerTransform;
+	FVector viewerLocation;
+	FMatrix viewMatrix;
+	//Projection (never with an oblique near plane) and its frustum
+	FMatrix projection;
+	FConvexVolume frustum;
+	//Size of the capture's render target
+	FIntPoint size;
+};
+
+//The portal manager's tick functions, one per tick group it runs in, each calls back into the manager
+USTRUCT()
+struct FPortalManagerTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	class UPortalManagerSubsystem* manager{ nullptr };
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+//FTickFunctions are unsafe to copy and their copy assignment operator has been deleted, so UE4 has to be told not to copy the struct via copy assignment operator
+template <>
+struct TStructOpsTypeTraits<FPortalManagerTickFunction> : public TStructOpsTypeTraitsBase2<FPortalManagerTickFunction>
+{
+	enum { WithCopy = false };
+};
+
+//Game thread cost and work of the portal manager's last frame, read by the "Portal.Bench.Scalability" benchmark and reported to the stats and the CSV profiler
+struct FPortalFrameCost
+{
+	//Crossing tests of the player camera, without the teleport
+	double characterTrackingSeconds{ 0.0 };
+	//Teleporting the player including the exit portal's forced capture
+	double teleportSeconds{ 0.0 };
+	//Capture projections and capture camera poses of every prepared portal (APortalVR::UpdateCaptureProjections() and UpdatePortalView()), summed over the parallel preparation
+	double portalViewSeconds{ 0.0 };
+	//Submitting the scheduled scene captures, nested captures included
+	double submitSeconds{ 0.0 };
+
+	//Portals prepared for capturing (not culled), capture passes submitted and capture passes of culled or over budget portals
+	int32 activePortals{ 0 };
+	int32 capturePasses{ 0 };
+	int32 skippedPasses{ 0 };
+	int32 nestedCaptures{ 0 };
+	int32 teleports{ 0 };
+
+	//Longest frame after the last teleport, set on the frame it is reported if it was a hitch, see "Portal Entry Hitch Time"
+	float entryHitchMs{ 0.0f };
+};
+
+//Replicated portal crossings of this world since it started, printed by "Portal.Net.Stats" on each PIE client and the server
+struct FPortalNetStats
+{
+	//Client: crossings predicted and sent to the server, and the ones it rejected
+	int32 predictedCrossings{ 0 };
+	int32 rejectedCrossings{ 0 };
+	//Client: character movement corrections in total, and within "r.Portal.Net.CorrectionWindow" after a predicted crossing
+	int32 corrections{ 0 };
+	int32 crossingCorrections{ 0 };
+	//Client: size of the crossing messages sent
+	int64 totalCrossingBits{ 0 };
+	int32 maxCrossingBits{ 0 };
+	//Server: crossings of remote players validated and teleported, and rejected
+	int32 acceptedRemoteCrossings{ 0 };
+	int32 rejectedRemoteCrossings{ 0 };
+};
+
+//Physics bodies overlapping a portal's traversal box and their locations when they were last tested, kept as struct of arrays for the batch crossing test
+struct FPortalTraversalCandidates
+{
+	TArray<TWeakObjectPtr<class UPrimitiveComponent>> bodies;
+	FPortalVectorArray prevLocations;
+
+	void RemoveAtSwap(int32 index);
+};
+
+/*
+ * World level manager that knows about every portal in the world.
+ * Portals register themselves on Init() and don't tick on their own, the manager ticks them all at once with two tick functions:
+ * after physics it tests the local players and the physics bodies for crossing a portal, and in post update work it fetches each local player's view once and captures the portals for it.
+ * The per portal preparation runs in parallel, only the scene capture submissions stay on the game thread
+ */
+UCLASS()
+class PORTALVREXAMPLE_API UPortalManagerSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	//The capture scheduler, LOD and recursion tests drive the manager and its portals directly between two frames, see PortalManagerTests.cpp
+	friend class FPortalCaptureTestAccess;
+
+public:
+
+	//Quantized capture resolution steps, as a scale of the portal's full resolution. Index 0 is full resolution
+	static const float ResolutionBucketScales[];
+	static const int32 NumResolutionBuckets;
+
+private:
+
+	//All portals of the level currently alive in the world, without the split screen players' copies
+	UPROPERTY()
+	TArray<class APortalVR*> registeredPortals;
+
+	//Local players the portals render for, looked up every frame (see UpdateLocalViewers()). There is always at least the first one, without a player on dedicated servers
+	UPROPERTY()
+	TArray<FPortalViewer> viewers;
+
+	//Set when portals or viewers came or went, the split screen players' portal copies are brought up to date on the next UpdateLocalViewers()
+	bool bViewerCopiesDirty;
+
+	//Registered portals by network ID, see RegisterPortal()
+	TMap<uint16, class APortalVR*> netPortals;
+
+	//Replicated crossings so far, and when a local viewer last predicted one
+	FPortalNetStats netStats;
+	double lastPredictedCrossingTime;
+
+	//Runs in TG_PostPhysics: player and physics body traversal
+	FPortalManagerTickFunction postPhysicsTick;
+	//Runs in TG_PostUpdateWork: portal captures and the capture budget
+	FPortalManagerTickFunction postUpdateTick;
+
+	//Baked potentially visible set of the world's portals, nullptr if the map has none
+	UPROPERTY()
+	class UPortalVisibilityData* visibilityData;
+
+	//Render targets are leased from here by portals that are about to capture
+	UPROPERTY()
+	class UPortalRenderTargetPool* renderTargetPool;
+
+	//Loads the streaming levels of the destinations the player approaches
+	UPROPERTY()
+	class UPortalDestinationStreaming* destinationStreaming;
+
+	//Captured pixels that may be submitted per frame, derived from "r.Portal.MaxCapturedPixels" and scaled down when frames run over budget
+	int64 capturePixelBudget;
+	//Captured pixels already reserved by portals this frame
+	int64 capturePixelsReserved;
+	//Capture passes scheduled for portals and reserved by nested captures this frame, limited by "r.Portal.MaxCapturePassesPerFrame"
+	int32 capturePassesReserved;
+
+	//Smoothed frame cost in milliseconds, the slowest of the game thread, render thread and GPU
+	float smoothedFrameTimeMs;
+	//Scale applied to the captured pixel budget, lowered while the frame is over the target frame time and raised again once there is headroom
+	float budgetScale;
+
+	//Physics bodies near each portal, reported by the portals' traversal boxes
+	TMap<class APortalVR*, FPortalTraversalCandidates> traversalCandidates;
+
+	//Late latches the first player's captures and measures the pose to capture delta against the main view's late update, only created with a headset
+	TSharedPtr<class FPortalPoseDeltaExtension, ESPMode::ThreadSafe> poseDeltaExtension;
+	//Whether the first player's captures submitted from the current view frame are late latched, see "r.Portal.LateLatch"
+	bool bLateLatchCaptures;
+
+	//Nested captures of portals seen through portals submitted this frame, limited by "r.Portal.MaxRecursiveCapturesPerFrame"
+	int32 recursiveCapturesThisFrame;
+
+	//Cost of the last frame's player tracking and captures, read by the "Portal.Bench.Scalability" benchmark
+	FPortalFrameCost lastFrameCost;
+
+	//Set while a pose trace is replayed, replaces the local player's view
+	TOptional<FPortalReplayedView> replayedView;
+
+	//Broadcast after physics right before the player's crossing test, the pose trace recorder and replay sample and set the player's pose here
+	FSimpleMulticastDelegate preCharacterTrackingDelegate;
+
+	//Exit portal of the last teleport and the frames after it that are still measured for the entry hitch
+	TWeakObjectPtr<const class APortalVR> entryPortal;
+	int32 entryFramesLeft;
+	float entryMaxFrameMs;
+	//Whether the destination was streamed in and the exit portal held a capture when the player teleported
+	bool bEntryDestinationReady;
+	bool bEntryWarmedUp;
+	//Wall clock time of the last post physics tick, the entry hitch measures real frame times even with a fixed timestep
+	double lastPostPhysicsTime;
+
+	//Cost of the last traversal update, read by the "Portal.Bench.Traversal" benchmark
+	double lastTraversalSeconds;
+	int32 lastTraversalCandidateCount;
+	int32 lastTraversalCount;
+
+public:
+
+	UPortalManagerSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void RegisterPortal(class APortalVR* portal);
+	void UnregisterPortal(class APortalVR* portal);
+
+	int32 GetRegisteredPortalCount() const { return registeredPortals.Num(); }
+
+	int32 GetViewerCount() const { return viewers.Num(); }
+	const FPortalViewer& GetViewer(int32 viewerIndex) const { return viewers[viewerIndex]; }
+
+	//First local player, the only one wearing the headset, recording pose traces and running the benchmarks
+	APlayerController* GetPlayerController() const { return viewers[0].controller; }
+	ULocalPlayer* GetPlayerLocal() const { return viewers[0].localPlayer; }
+	class APortalCharacter* GetPlayerCharacter() const { return viewers[0].character; }
+
+	//Portals rendering for the viewer: the level's portals for the first one, their copies for the other split screen players
+	const TArray<class APortalVR*>& GetViewerPortals(int32 viewerIndex) const { return viewerIndex == 0 ? registeredPortals : viewers[viewerIndex].portalCopies; }
+
+	//nullptr for portals added at runtime on one machine only, whose IDs don't match between server and clients
+	class APortalVR* FindPortalByNetId(uint16 netId) const;
+
+	//Server: validates a crossing the character's client predicted with the same test the client ran and teleports the character the same way, or tells the client it was rejected
+	void ReceiveCrossing(class APortalCharacter* character, const struct FPortalCrossingMessage& message);
+
+	//Client: the server rejected a predicted crossing, character movement corrects the local player back
+	void OnCrossingRejected(uint16 portalId);
+
+	//Client: character movement corrected a local player's position
+	void OnMovementCorrection();
+
+	const FPortalNetStats& GetNetStats() const { return netStats; }
+
+	//Writes the replicated crossing counts and message sizes, see the "Portal.Net.Stats" console command
+	void DumpNetStats(FOutputDevice& output) const;
+
+	//First player's view of the current frame, see UpdateViewFrame()
+	const FPortalViewFrame& GetViewFrame() const { return viewers[0].viewFrame; }
+
+	//Fetches the viewer's camera pose and the projection data of both eyes, done once per frame and again after the player teleported
+	void UpdateViewFrame(int32 viewerIndex);
+
+	//Replaces the first player's view with a replayed one until cleared, the view frame is built from it on the next UpdateViewFrame()
+	void SetReplayedView(const FPortalReplayedView& view) { replayedView = view; }
+	void ClearReplayedView() { replayedView.Reset(); }
+
+	FSimpleMulticastDelegate& OnPreCharacterTracking() { return preCharacterTrackingDelegate; }
+
+	//nullptr without a headset
+	class FPortalPoseDeltaExtension* GetPoseDeltaExtension() const { return poseDeltaExtension.Get(); }
+
+	class UPortalRenderTargetPool* GetRenderTargetPool() const { return renderTargetPool; }
+	class UPortalDestinationStreaming* GetDestinationStreaming() const { return destinationStreaming; }
+
+	/*
+	 * Reserves the pixels for a portal capture at the given resolution bucket for the current frame.
+	 * Steps down to smaller buckets until the capture fits in the remaining budget and returns the bucket that fits, or INDEX_NONE if not even the smallest bucket fits.
+	 * Forced captures (exit portal when teleporting) always get at least the smallest bucket
+	 */
+	int32 ReserveCapturePixels(const class APortalVR* portal, int32 desiredBucket, bool bForce);
+
+	//Gives back a reservation of the bucket's pixels for a capture that couldn't be submitted after all
+	void ReleaseCapturePixels(const class APortalVR* portal, int32 bucket);
+
+	/*
+	 * Submits a prepared portal capture: first the portals seen through it are captured recursively up to "r.Portal.RecursionMaxDepth", then the portal itself,
+	 * then the nested portals' materials are switched back to their own captures
+	 */
+	void SubmitPortalCapture(class APortalVR* portal, bool bForce);
+
+	//Captures every portal of the parent view's viewer visible in the parent view at the given recursion level, returns the portals whose materials now show a nested capture
+	void CaptureNestedPortals(const FPortalRecursionView& parentView, int32 level, TArray<class APortalVR*>& outNestedPortals);
+
+	//Deepest level of nested captures, "r.Portal.RecursionMaxDepth" clamped to APortalVR::MaxRecursionDepth
+	static int32 GetRecursionMaxDepth();
+
+	//Takes one nested capture of the given size at the level from this frame's recursion, capture pass and captured pixel budgets, returns false past the maximum depth or if any of the budgets is used up
+	bool ReserveRecursiveCapture(int32 level, int32 maxDepth, const FIntPoint& size);
+
+	//Gives back a nested capture's reservation when it couldn't be captured after all
+	void ReleaseRecursiveCapture(const FIntPoint& size);
+
+	//O(1) tests against the baked visibility, true without visibility data, for portals that weren't baked or when "r.Portal.PVS" is 0
+	bool IsPotentiallyVisible(const class APortalVR* portal, int32 visibilityCell) const;
+	bool IsPotentiallyVisibleThrough(const class APortalVR* throughPortal, const class APortalVR* portal) const;
+
+	//Physics bodies overlapping a portal's traversal box, only these are tested for crossing the portal
+	void AddTraversalCandidate(class APortalVR* portal, class UPrimitiveComponent* body);
+	void RemoveTraversalCandidate(class APortalVR* portal, class UPrimitiveComponent* body);
+
+	const FPortalFrameCost& GetLastFrameCost() const { return lastFrameCost; }
+
+	//Writes a table of every portal's state and last frame cost, most expensive first, see the "Portal.DumpCosts" console command
+	void DumpPortalCosts(FOutputDevice& output) const;
+
+	double GetLastTraversalSeconds() const { return lastTraversalSeconds; }
+	int32 GetLastTraversalCandidateCount() const { return lastTraversalCandidateCount; }
+	int32 GetLastTraversalCount() const { return lastTraversalCount; }
+
+	//Called by the tick functions
+	void PostPhysicsTick(float DeltaTime);
+	void PostUpdateTick(float DeltaTime);
+
+private:
+
+	//Starts ticking the first time a portal registers
+	void InitializePlayerAndTicks();
+
+	/*
+	 * Looks up the local players again, clients get their pawn some time after the portals began play, pawns may be respawned and split screen players may join or leave.
+	 * Portals are told when their player or its part of the viewport changes
+	 */
+	void UpdateLocalViewers();
+
+	//Spawns the missing copies of connected portals for the split screen players, connected to each other the way the level's portals are
+	void UpdateViewerCopies();
+
+	//Copy of the portal rendering for the viewer, the portal itself for the first viewer, nullptr if it has none yet
+	class APortalVR* FindViewerPortal(class APortalVR* portal, int32 viewerIndex) const;
+
+	//Hides the portals rendering for the other players from every player's view and from the captures of its own portals
+	void HideOtherViewersPortals();
+
+	/*
+	 * The captures are positioned from the camera component, which the camera manager moved to the headset's pose. The main view is moved again to the newest pose on the render thread (late update),
+	 * this passes the captures' pose to the pose delta extension which moves the captures along (see "r.Portal.LateLatch") and measures what is left, see "Portal.Bench.PoseDelta"
+	 */
+	void ReportCapturePose();
+
+	//Moves the view frame's camera and eyes to the replayed view and replaces the eyes' projections
+	void ApplyReplayedView();
+
+	//Sets the per frame portal counts of "stat Portal" and the CSV profiler's Portal category
+	void ReportFrameCounts() const;
+
+	//Tests all of the viewer's portals for its camera crossing them and teleports the player through the first one it crossed, clients predict the crossing (see PredictCrossing())
+	void UpdateCharacterTracking(int32 viewerIndex);
+
+	/*
+	 * Client: teleports the viewer's character through the portal right away and sends the crossing to the server as a quantized message relative to the portal.
+	 * The client teleports from the quantized transform, so the server ends up with the same result as long as the crossing passes its validation
+	 */
+	void PredictCrossing(const FPortalViewer& viewer, class APortalVR* portal);
+
+	//Prepares all viewers' portal captures in parallel, schedules each viewer's and submits them on the game thread
+	void UpdateCaptures(const TArray<int32>& viewerIndices);
+
+	/*
+	 * Predicts from each viewer's distance to and approach speed towards each portal which destinations are about to be needed: streams in their levels ("r.Portal.Streaming.*"),
+	 * keeps them while any player is near either portal of the pair and releases them once out of reach. The exit portal of the destination each player reaches first is captured once
+	 * at low resolution before the teleport, so its render targets and shaders are ready when the teleport forces its capture ("r.Portal.Warmup*")
+	 */
+	void UpdateDestinationStreaming(const TArray<int32>& viewerIndices);
+
+	//Seconds until the viewer reaches the portal at their current approach speed, MAX_flt when not moving towards it
+	float GetTimeToReach(const FPortalViewer& viewer, const class APortalVR* portal, float distance) const;
+
+	//Captures the portal once at its lowest resolution bucket, allocating its render targets and compiling the capture's shaders before the player can see it. Later calls keep those render targets leased
+	void WarmUpCapture(class APortalVR* portal);
+
+	//Starts measuring the frames after the player teleported through the portal for a hitch
+	void BeginEntryHitch(const class APortalVR* portal);
+
+	//Measures the wall clock frame time since the last post physics tick while the frames after a teleport are measured, and reports the longest as a hitch once they are over
+	void MeasureEntryHitch();
+
+	/*
+	 * Temporal capture scheduler, picks which of the viewer's prepared portals are captured this frame within its share of "r.Portal.MaxCapturePassesPerFrame".
+	 * Near, large and fast changing portals are due every frame, small and static ones every few frames, the others keep their previous capture which the material reprojects.
+	 * The frame number picks the portals' refresh slots
+	 */
+	void ScheduleCaptures(int32 viewerIndex, int32 maxViewerPasses, uint64 frameNumber);
+
+	//Number of frames the portal may go between captures
+	int32 GetRefreshInterval(const class APortalVR* portal, int32 maxRefreshInterval) const;
+
+	/*
+	 * Tests every traversal candidate for crossing its portal since the last frame, one batch per portal, and teleports the bodies that did with their linear and angular velocity.
+	 * Runs after physics so the swept segments cover the whole simulation step
+	 */
+	void UpdateTraversals();
+
+	//Updates the smoothed frame cost and adjusts the budget scale from it
+	void UpdateFrameBudget();
+
+	//Picks the resolution bucket of every visible portal for the next frame, nearest and largest portals first, so the total stays within the pixel budget
+	void AllocateCaptureResolutions();
+
+	//Bucket a portal would like based only on how much of the screen it covers
+	static int32 GetPreferredResolutionBucket(float screenCoverage);
+};
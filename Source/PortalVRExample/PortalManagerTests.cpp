@@ -0,0 +1,1179 @@
+#include "PortalCharacter.h"
+#include "PortalCrossingMessage.h"
+#include "PortalManagerSubsystem.h"
+#include "PortalScalabilityBenchmark.h"
+#include "PortalVR.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/Package.h"
+
+#if WITH_EDITOR
+#include "Components/CapsuleComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/FileManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Settings/LevelEditorPlaySettings.h"
+#include "Tests/AutomationCommon.h"
+#include "Tests/AutomationEditorCommon.h"
+#endif
+
+/*
+ * Automation tests of the portal manager's networking, split screen, capture scheduling and scalability ("Automation RunTests PortalVR.Net", "PortalVR.SplitScreen", "PortalVR.Capture", "PortalVR.Bench").
+ * The message and reprojection tests only need the engine, the play in editor tests load the example map and play it with one or several clients or local players
+ */
+
+//Size of a crossing message sent as it is, a 16 bit portal ID, 4 vectors of floats and a rotator of floats
+static constexpr int32 UnquantizedCrossingBits{ 16 + 5 * 3 * 32 };
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCrossingMessageQuantizeTest, "PortalVR.Net.CrossingMessage.Quantize", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalCrossingMessageQuantizeTest::RunTest(const FString& Parameters)
+{
+	//A character walking through a portal, somewhat off its center and turned
+	FPortalCrossingMessage message;
+	message.portalId = 7;
+	message.characterLocation = FVector{ -12.34f, 25.67f, -80.01f };
+	message.characterRotation = FRotator{ 0.0f, 123.45f, 0.0f };
+	message.prevCameraLocation = FVector{ 3.21f, 20.5f, 64.2f };
+	message.cameraLocation = FVector{ -1.98f, 21.1f, 64.0f };
+
+	const FPortalCrossingMessage original{ message };
+	const int32 bits{ message.Quantize() };
+	TestTrue(TEXT("The message is smaller than its unquantized values"), bits > 0 && bits < UnquantizedCrossingBits);
+	TestEqual(TEXT("The portal ID is sent as it is"), message.portalId, original.portalId);
+	TestTrue(TEXT("The character location is kept to 0.1 cm"), message.characterLocation.Equals(original.characterLocation, 0.05f));
+	TestTrue(TEXT("The camera segment is kept to 0.1 cm"), message.prevCameraLocation.Equals(original.prevCameraLocation, 0.05f) && message.cameraLocation.Equals(original.cameraLocation, 0.05f));
+	TestTrue(TEXT("The character rotation is kept to 16 bits"), message.characterRotation.Equals(original.characterRotation, 360.0f / 65536.0f));
+
+	//The client teleports from the quantized message, it has to be what the server rebuilds from the received one
+	const FPortalCrossingMessage quantized{ message };
+	TestEqual(TEXT("Quantizing again doesn't change the size"), message.Quantize(), bits);
+	TestTrue(TEXT("Quantizing again doesn't change the values"), message.characterLocation == quantized.characterLocation && message.characterRotation == quantized.characterRotation
+		&& message.prevCameraLocation == quantized.prevCameraLocation && message.cameraLocation == quantized.cameraLocation);
+	return true;
+}
+
+/*
+ * Sets up the first player's portals and drives the portal manager's capture scheduler, LOD tiers and nested capture budget directly, between two frames of a play session.
+ * Everything it changes is put back when it goes out of scope, so the session's next frame captures as before
+ */
+class FPortalCaptureTestAccess
+{
+public:
+
+	explicit FPortalCaptureTestAccess(UPortalManagerSubsystem* inPortalManager);
+	~FPortalCaptureTestAccess();
+
+	//The first player's portals, all culled until they are set up with PreparePortal()
+	const TArray<APortalVR*>& GetPortals() const { return portalManager->GetViewerPortals(0); }
+
+	//Sets a console variable until the end of the test
+	void SetConsoleVariable(const TCHAR* name, const FString& value);
+
+	//Makes the portal a visible, static capture far from the camera that has something valid to show, covering the fraction of the screen
+	void PreparePortal(APortalVR* portal, float screenCoverage, int32 refreshPhase);
+
+	//Prepares and schedules the first player's captures for the frame like UPortalManagerSubsystem::UpdateCaptures(), then marks the scheduled portals captured like APortalVR::SubmitCapture(). Returns the capture passes scheduled
+	int32 ScheduleFrame(uint64 frameNumber, int32 maxViewerPasses);
+
+	static bool IsScheduled(const APortalVR* portal) { return portal->bCaptureScheduled; }
+	static int32 GetRefreshInterval(const APortalVR* portal) { return portal->refreshInterval; }
+	static int32 GetFramesSinceCapture(const APortalVR* portal) { return portal->framesSinceCapture; }
+	static int32 GetCapturePassCount(const APortalVR* portal) { return portal->GetCapturePassCount(); }
+
+	//Makes the portal look like it wasn't captured for a long time and uses up this frame's capture passes and captured pixels, a capture can then only be a forced one
+	static void ExhaustCaptureBudgets(UPortalManagerSubsystem* manager, APortalVR* portal);
+
+	//Teleports the character through the portal like a crossing of the camera does
+	static void TeleportThrough(APortalVR* portal, APortalCharacter* character) { portal->TeleportCharacter(character, character->GetActorTransform()); }
+
+	//Picks the portal's LOD tier coming from the current tier, at the distance from the camera and covering the fraction of the screen
+	EPortalLODTier SelectLODTier(APortalVR* portal, EPortalLODTier currentTier, float distance, float coverage, bool bReprojection) const;
+	static float GetMidTierDistance(const APortalVR* portal) { return portal->midTierDistance; }
+	static float GetFarTierDistance(const APortalVR* portal) { return portal->farTierDistance; }
+	static float GetNearTierMinScreenCoverage(const APortalVR* portal) { return portal->nearTierMinScreenCoverage; }
+
+	//Starts the frame's nested captures with the passes the portals' own captures already took
+	void ResetRecursionBudget(int32 capturePassesReserved);
+
+	//Takes nested captures at the level until the portal manager refuses one, returns how many it took
+	int32 ReserveRecursiveCaptures(int32 level, int32 maxDepth);
+
+	int32 GetRecursiveCapturesThisFrame() const { return portalManager->recursiveCapturesThisFrame; }
+	int32 GetCapturePassesReserved() const { return portalManager->capturePassesReserved; }
+
+	static FMatrix CaptureViewMatrix(const FVector& location, const FRotator& rotation) { return APortalVR::CaptureViewMatrix(location, rotation); }
+	static void ComputeReprojection(const FMatrix& worldToCaptureClip, FLinearColor (&reprojection)[3]) { APortalVR::ComputeReprojection(worldToCaptureClip, reprojection); }
+
+private:
+
+	//Capture state of a portal as it was before the test changed it
+	struct FSavedPortal
+	{
+		APortalVR* portal;
+		bool bCapturePrepared;
+		bool bCaptureScheduled;
+		int32 framesSinceCapture;
+		int32 refreshInterval;
+		int32 refreshPhase;
+		float screenCoverage;
+		float cameraDistance;
+		EPortalLODTier lodTier;
+		bool bMaterialHasReprojection;
+		bool bScissorRectChanged;
+		UTextureRenderTarget2D* renderLeftTarget;
+		UTextureRenderTarget2D* renderRightTarget;
+		FVector capturedLocation;
+		FQuat capturedRotation;
+	};
+
+	UPortalManagerSubsystem* portalManager;
+	TArray<FSavedPortal> savedPortals;
+	FVector savedCameraLocation;
+	int64 savedCapturePixelBudget;
+	int64 savedCapturePixelsReserved;
+	int32 savedCapturePassesReserved;
+	int32 savedRecursiveCapturesThisFrame;
+	TMap<FString, FString> savedConsoleVariables;
+
+	//Stands in for the render targets of portals that were never captured, only ever compared against nullptr
+	UTextureRenderTarget2D* placeholderTarget;
+};
+
+FPortalCaptureTestAccess::FPortalCaptureTestAccess(UPortalManagerSubsystem* inPortalManager)
+	:portalManager{ inPortalManager }, savedCameraLocation{ inPortalManager->viewers[0].viewFrame.cameraLocation }, savedCapturePixelBudget{ inPortalManager->capturePixelBudget },
+	savedCapturePixelsReserved{ inPortalManager->capturePixelsReserved }, savedCapturePassesReserved{ inPortalManager->capturePassesReserved }, savedRecursiveCapturesThisFrame{ inPortalManager->recursiveCapturesThisFrame },
+	placeholderTarget{ NewObject<UTextureRenderTarget2D>(GetTransientPackage()) }
+{
+	for (APortalVR* portal : GetPortals())
+	{
+		savedPortals.Add(FSavedPortal{ portal, portal->bCapturePrepared, portal->bCaptureScheduled, portal->framesSinceCapture, portal->refreshInterval, portal->refreshPhase, portal->screenCoverage, portal->cameraDistance,
+			portal->lodTier, portal->bMaterialHasReprojection, portal->bScissorRectChanged, portal->renderLeftTarget, portal->renderRightTarget, portal->capturedLocation, portal->capturedRotation });
+		portal->bCapturePrepared = false;
+		portal->bCaptureScheduled = false;
+	}
+
+	//Far away from every portal, so none of them is refreshed every frame for being stepped through. The pixel budget of 0 lets everything through
+	portalManager->viewers[0].viewFrame.cameraLocation = FVector{ 1.0e6f };
+	portalManager->capturePixelBudget = 0;
+	portalManager->capturePixelsReserved = 0;
+	portalManager->capturePassesReserved = 0;
+	portalManager->recursiveCapturesThisFrame = 0;
+}
+
+FPortalCaptureTestAccess::~FPortalCaptureTestAccess()
+{
+	for (const FSavedPortal& saved : savedPortals)
+	{
+		APortalVR* portal{ saved.portal };
+		portal->bCapturePrepared = saved.bCapturePrepared;
+		portal->bCaptureScheduled = saved.bCaptureScheduled;
+		portal->framesSinceCapture = saved.framesSinceCapture;
+		portal->refreshInterval = saved.refreshInterval;
+		portal->refreshPhase = saved.refreshPhase;
+		portal->screenCoverage = saved.screenCoverage;
+		portal->cameraDistance = saved.cameraDistance;
+		portal->lodTier = saved.lodTier;
+		portal->bMaterialHasReprojection = saved.bMaterialHasReprojection;
+		portal->bScissorRectChanged = saved.bScissorRectChanged;
+		portal->renderLeftTarget = saved.renderLeftTarget;
+		portal->renderRightTarget = saved.renderRightTarget;
+		portal->capturedLocation = saved.capturedLocation;
+		portal->capturedRotation = saved.capturedRotation;
+	}
+
+	portalManager->viewers[0].viewFrame.cameraLocation = savedCameraLocation;
+	portalManager->capturePixelBudget = savedCapturePixelBudget;
+	portalManager->capturePixelsReserved = savedCapturePixelsReserved;
+	portalManager->capturePassesReserved = savedCapturePassesReserved;
+	portalManager->recursiveCapturesThisFrame = savedRecursiveCapturesThisFrame;
+
+	for (const TPair<FString, FString>& consoleVariable : savedConsoleVariables)
+	{
+		IConsoleManager::Get().FindConsoleVariable(*consoleVariable.Key)->Set(*consoleVariable.Value, ECVF_SetByCode);
+	}
+}
+
+void FPortalCaptureTestAccess::SetConsoleVariable(const TCHAR* name, const FString& value)
+{
+	IConsoleVariable* consoleVariable{ IConsoleManager::Get().FindConsoleVariable(name) };
+	check(consoleVariable);
+	if (!savedConsoleVariables.Contains(name))
+	{
+		savedConsoleVariables.Add(name, consoleVariable->GetString());
+	}
+	consoleVariable->Set(*value, ECVF_SetByCode);
+}
+
+void FPortalCaptureTestAccess::PreparePortal(APortalVR* portal, float screenCoverage, int32 refreshPhase)
+{
+	portal->bCapturePrepared = true;
+	portal->bCaptureScheduled = false;
+	portal->framesSinceCapture = 0;
+	portal->refreshPhase = refreshPhase;
+	portal->screenCoverage = screenCoverage;
+	portal->lodTier = EPortalLODTier::Mid;
+	portal->bMaterialHasReprojection = true;
+	portal->bScissorRectChanged = false;
+	portal->renderLeftTarget = portal->renderLeftTarget ? portal->renderLeftTarget : placeholderTarget;
+	portal->renderRightTarget = portal->renderRightTarget ? portal->renderRightTarget : placeholderTarget;
+	portal->capturedLocation = portal->captureLocation;
+	portal->capturedRotation = portal->captureRotation.Quaternion();
+}
+
+int32 FPortalCaptureTestAccess::ScheduleFrame(uint64 frameNumber, int32 maxViewerPasses)
+{
+	for (APortalVR* portal : GetPortals())
+	{
+		if (portal->bCapturePrepared)
+		{
+			++portal->framesSinceCapture;
+			portal->bCaptureScheduled = false;
+		}
+	}
+
+	portalManager->capturePassesReserved = 0;
+	portalManager->ScheduleCaptures(0, maxViewerPasses, frameNumber);
+
+	for (APortalVR* portal : GetPortals())
+	{
+		if (portal->bCapturePrepared && portal->bCaptureScheduled)
+		{
+			portal->framesSinceCapture = 0;
+		}
+	}
+	return portalManager->capturePassesReserved;
+}
+
+EPortalLODTier FPortalCaptureTestAccess::SelectLODTier(APortalVR* portal, EPortalLODTier currentTier, float distance, float coverage, bool bReprojection) const
+{
+	portal->lodTier = currentTier;
+	portal->cameraDistance = distance;
+	portal->screenCoverage = coverage;
+	portal->bMaterialHasReprojection = bReprojection;
+	return portal->SelectLODTier(portalManager->viewers[0].viewFrame);
+}
+
+void FPortalCaptureTestAccess::ResetRecursionBudget(int32 capturePassesReserved)
+{
+	portalManager->capturePixelsReserved = 0;
+	portalManager->capturePassesReserved = capturePassesReserved;
+	portalManager->recursiveCapturesThisFrame = 0;
+}
+
+int32 FPortalCaptureTestAccess::ReserveRecursiveCaptures(int32 level, int32 maxDepth)
+{
+	//Far more than any budget the tests set, so a missing limit shows up as a count instead of an endless loop
+	constexpr int32 MaxReservations{ 100 };
+	int32 reservations{ 0 };
+	while (reservations < MaxReservations && portalManager->ReserveRecursiveCapture(level, maxDepth, FIntPoint{ 64, 64 }))
+	{
+		++reservations;
+	}
+	return reservations;
+}
+
+void FPortalCaptureTestAccess::ExhaustCaptureBudgets(UPortalManagerSubsystem* manager, APortalVR* portal)
+{
+	portal->framesSinceCapture = 100;
+	manager->capturePassesReserved = IConsoleManager::Get().FindConsoleVariable(TEXT("r.Portal.MaxCapturePassesPerFrame"))->GetInt();
+	manager->capturePixelsReserved = manager->capturePixelBudget;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalComputeReprojectionTest, "PortalVR.Capture.Reprojection", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalComputeReprojectionTest::RunTest(const FString& Parameters)
+{
+	//Off-center like an eye's projection, and a camera looking at the points from the side and one from above
+	FMatrix projection{ FReversedZPerspectiveMatrix{ HALF_PI * 0.45f, 1.2f, 1.0f, 10.0f } };
+	projection.M[2][0] = 0.1f;
+	projection.M[2][1] = -0.05f;
+	const FVector cameraLocations[]{ FVector{ -300.0f, 50.0f, 120.0f }, FVector{ 100.0f, -250.0f, 400.0f } };
+	const FRotator cameraRotations[]{ FRotator{ -5.0f, 10.0f, 0.0f }, FRotator{ -50.0f, 80.0f, 15.0f } };
+	const FVector points[]{ FVector{ 100.0f, 0.0f, 100.0f }, FVector{ 150.0f, 40.0f, 90.0f }, FVector{ 80.0f, -30.0f, 130.0f }, FVector{ 120.0f, 20.0f, 60.0f } };
+
+	for (int32 cameraIndex = 0; cameraIndex < UE_ARRAY_COUNT(cameraLocations); ++cameraIndex)
+	{
+		const FMatrix worldToClip{ FPortalCaptureTestAccess::CaptureViewMatrix(cameraLocations[cameraIndex], cameraRotations[cameraIndex]) * projection };
+		FLinearColor reprojection[3];
+		FPortalCaptureTestAccess::ComputeReprojection(worldToClip, reprojection);
+
+		for (const FVector& point : points)
+		{
+			//Where the capture rendered the point, NDC to render target UV with V pointing down
+			const FVector4 clipPosition{ worldToClip.TransformFVector4(FVector4{ point, 1.0f }) };
+			if (!TestTrue(TEXT("The point is in front of the camera"), clipPosition.W > 0.0f))
+			{
+				continue;
+			}
+			const FVector2D expectedUV{ clipPosition.X / clipPosition.W * 0.5f + 0.5f, 0.5f - clipPosition.Y / clipPosition.W * 0.5f };
+
+			//What the material computes from the rows
+			auto dot = [&point](const FLinearColor& row) { return row.R * point.X + row.G * point.Y + row.B * point.Z + row.A; };
+			const FVector2D reprojectedUV{ dot(reprojection[0]) / dot(reprojection[2]), dot(reprojection[1]) / dot(reprojection[2]) };
+			TestTrue(FString::Printf(TEXT("%s is reprojected to where camera %d captured it"), *point.ToString(), cameraIndex), reprojectedUV.Equals(expectedUV, 1.0e-4f));
+		}
+	}
+	return true;
+}
+
+#if WITH_EDITOR
+
+static const TCHAR* const PortalTestMap{ TEXT("/Game/VirtualRealityBP/Maps/MotionControllerMap") };
+
+static UPortalManagerSubsystem* GetPortalManager(UWorld* world)
+{
+	return world ? world->GetSubsystem<UPortalManagerSubsystem>() : nullptr;
+}
+
+//Play in editor worlds with the net mode, in the order the editor created them
+static TArray<UWorld*> GetPlayWorlds(ENetMode netMode)
+{
+	TArray<UWorld*> worlds;
+	for (const FWorldContext& context : GEngine->GetWorldContexts())
+	{
+		if (context.WorldType == EWorldType::PIE && context.World() && context.World()->GetNetMode() == netMode)
+		{
+			worlds.Add(context.World());
+		}
+	}
+	return worlds;
+}
+
+//A connected portal the characters can walk into, standing upright
+static APortalVR* FindWalkablePortal(const UPortalManagerSubsystem* portalManager)
+{
+	for (APortalVR* portal : portalManager->GetViewerPortals(0))
+	{
+		if (portal->GetPortalTarget() && FMath::Abs(portal->GetPortalRect().normal.Z) < 0.1f)
+		{
+			return portal;
+		}
+	}
+	return nullptr;
+}
+
+//Plays the map in editor with the play settings, and puts the editor's play settings back after the test
+class FPortalPlaySettingsScope
+{
+public:
+
+	FPortalPlaySettingsScope(EPlayNetMode netMode, int32 numberOfClients)
+	{
+		ULevelEditorPlaySettings* playSettings{ GetMutableDefault<ULevelEditorPlaySettings>() };
+		playSettings->GetPlayNetMode(savedNetMode);
+		playSettings->GetPlayNumberOfClients(savedNumberOfClients);
+		playSettings->GetRunUnderOneProcess(bSavedRunUnderOneProcess);
+		playSettings->SetPlayNetMode(netMode);
+		playSettings->SetPlayNumberOfClients(numberOfClients);
+		playSettings->SetRunUnderOneProcess(true);
+	}
+
+	void Restore() const
+	{
+		ULevelEditorPlaySettings* playSettings{ GetMutableDefault<ULevelEditorPlaySettings>() };
+		playSettings->SetPlayNetMode(savedNetMode);
+		playSettings->SetPlayNumberOfClients(savedNumberOfClients);
+		playSettings->SetRunUnderOneProcess(bSavedRunUnderOneProcess);
+	}
+
+private:
+
+	EPlayNetMode savedNetMode{ PIE_Standalone };
+	int32 savedNumberOfClients{ 1 };
+	bool bSavedRunUnderOneProcess{ true };
+};
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FPortalRestorePlaySettingsCommand, TSharedPtr<FPortalPlaySettingsScope>, playSettings);
+
+bool FPortalRestorePlaySettingsCommand::Update()
+{
+	playSettings->Restore();
+	return true;
+}
+
+/*
+ * Walks the character of every client through the map's portals, one client after the other so they don't bump into each other.
+ * The server puts the client's character in front of a connected portal, then the client walks into it, a bit away from the exit portal and back into it,
+ * until it predicted the number of crossings. Once every client is done and the server caught up, the crossings and corrections are checked in the net stats
+ */
+class FPortalScriptedCrossingsCommand : public IAutomationLatentCommand
+{
+public:
+
+	FPortalScriptedCrossingsCommand(FAutomationTestBase* inTest, int32 inNumberOfClients, int32 inCrossingsPerClient)
+		:test{ inTest }, numberOfClients{ inNumberOfClients }, crossingsPerClient{ inCrossingsPerClient }, phase{ EPhase::WaitForPlayers }, phaseStartTime{ 0.0 },
+		currentClient{ 0 }, phaseStartCrossings{ 0 }, clientStartCrossings{ 0 }
+	{
+	}
+
+	virtual bool Update() override;
+
+private:
+
+	enum class EPhase : uint8
+	{
+		WaitForPlayers,
+		Settle,
+		Approach,
+		Leave,
+		WaitForServer
+	};
+
+	//Seconds the clients get to join, a character to walk into a portal and the server to validate the last crossings
+	static constexpr double PlayersTimeout{ 30.0 };
+	static constexpr double ApproachTimeout{ 5.0 };
+	static constexpr double ServerTimeout{ 5.0 };
+	//Seconds a placed character stands still before walking, so the correction from being moved by the server is over before the first crossing
+	static constexpr double SettleSeconds{ 1.0 };
+	//Seconds a character walks away from the exit portal before it turns around
+	static constexpr double LeaveSeconds{ 0.5 };
+	//Distance in front of the portal the character starts at
+	static constexpr float StartDistance{ 200.0f };
+
+	FAutomationTestBase* test;
+	int32 numberOfClients;
+	int32 crossingsPerClient;
+
+	EPhase phase;
+	double phaseStartTime;
+	TArray<TWeakObjectPtr<UWorld>> clientWorlds;
+	TWeakObjectPtr<UWorld> serverWorld;
+	int32 currentClient;
+	TWeakObjectPtr<APortalVR> walkPortal;
+	//Crossings the current client predicted when the phase and its walk started
+	int32 phaseStartCrossings;
+	int32 clientStartCrossings;
+
+	void StartPhase(EPhase newPhase, int32 predictedCrossings);
+	bool WaitForPlayers(double phaseSeconds);
+	bool PlaceCharacter();
+	void CheckNetStats();
+};
+
+void FPortalScriptedCrossingsCommand::StartPhase(EPhase newPhase, int32 predictedCrossings)
+{
+	phase = newPhase;
+	phaseStartTime = FPlatformTime::Seconds();
+	phaseStartCrossings = predictedCrossings;
+}
+
+bool FPortalScriptedCrossingsCommand::Update()
+{
+	if (phaseStartTime == 0.0)
+	{
+		StartPhase(EPhase::WaitForPlayers, 0);
+	}
+
+	const double phaseSeconds{ FPlatformTime::Seconds() - phaseStartTime };
+	if (phase == EPhase::WaitForPlayers)
+	{
+		return WaitForPlayers(phaseSeconds);
+	}
+
+	if (phase == EPhase::WaitForServer)
+	{
+		//The server validated every predicted crossing, and corrections caused by the last ones had the time to arrive
+		int32 predictedCrossings{ 0 };
+		for (const TWeakObjectPtr<UWorld>& clientWorld : clientWorlds)
+		{
+			const UPortalManagerSubsystem* portalManager{ GetPortalManager(clientWorld.Get()) };
+			predictedCrossings += portalManager ? portalManager->GetNetStats().predictedCrossings : 0;
+		}
+		const UPortalManagerSubsystem* serverManager{ GetPortalManager(serverWorld.Get()) };
+		const FPortalNetStats* serverStats{ serverManager ? &serverManager->GetNetStats() : nullptr };
+		const IConsoleVariable* correctionWindow{ IConsoleManager::Get().FindConsoleVariable(TEXT("r.Portal.Net.CorrectionWindow")) };
+		const bool bServerDone{ !serverStats || serverStats->acceptedRemoteCrossings + serverStats->rejectedRemoteCrossings >= predictedCrossings };
+		if ((!bServerDone && phaseSeconds < ServerTimeout) || phaseSeconds < (correctionWindow ? correctionWindow->GetFloat() : 0.0f))
+		{
+			return false;
+		}
+
+		CheckNetStats();
+		return true;
+	}
+
+	UPortalManagerSubsystem* portalManager{ GetPortalManager(clientWorlds[currentClient].Get()) };
+	APortalCharacter* character{ portalManager ? portalManager->GetPlayerCharacter() : nullptr };
+	if (!character || !serverWorld.IsValid() || !walkPortal.IsValid())
+	{
+		test->AddError(TEXT("The play session ended before the crossings were done"));
+		return true;
+	}
+
+	const int32 predictedCrossings{ portalManager->GetNetStats().predictedCrossings };
+	switch (phase)
+	{
+	case EPhase::Settle:
+		if (phaseSeconds >= SettleSeconds)
+		{
+			StartPhase(EPhase::Approach, predictedCrossings);
+		}
+		break;
+
+	case EPhase::Approach:
+		if (predictedCrossings == phaseStartCrossings)
+		{
+			if (phaseSeconds > ApproachTimeout)
+			{
+				test->AddError(FString::Printf(TEXT("Client %d didn't cross %s within %.0f s"), currentClient, *walkPortal->GetName(), ApproachTimeout));
+				return true;
+			}
+			character->AddMovementInput(-walkPortal->GetPortalRect().normal);
+			break;
+		}
+
+		//The character came out of the exit portal, it's the one it walks back into
+		walkPortal = walkPortal->GetPortalTarget();
+		if (predictedCrossings - clientStartCrossings < crossingsPerClient)
+		{
+			StartPhase(EPhase::Leave, predictedCrossings);
+		}
+		else if (++currentClient < clientWorlds.Num())
+		{
+			return !PlaceCharacter();
+		}
+		else
+		{
+			StartPhase(EPhase::WaitForServer, predictedCrossings);
+		}
+		break;
+
+	case EPhase::Leave:
+		if (phaseSeconds >= LeaveSeconds)
+		{
+			StartPhase(EPhase::Approach, predictedCrossings);
+			break;
+		}
+		character->AddMovementInput(walkPortal->GetPortalRect().normal);
+		break;
+
+	default:
+		break;
+	}
+	return false;
+}
+
+bool FPortalScriptedCrossingsCommand::WaitForPlayers(double phaseSeconds)
+{
+	//Every client has its character and knows which player it is, the server has the characters of the clients and its own player
+	const TArray<UWorld*> clients{ GetPlayWorlds(NM_Client) };
+	const TArray<UWorld*> servers{ GetPlayWorlds(NM_ListenServer) };
+	bool bReady{ clients.Num() == numberOfClients && servers.Num() == 1 };
+	for (int32 index = 0; bReady && index < clients.Num(); ++index)
+	{
+		const UPortalManagerSubsystem* portalManager{ GetPortalManager(clients[index]) };
+		const APortalCharacter* character{ portalManager ? portalManager->GetPlayerCharacter() : nullptr };
+		bReady = character && character->GetPlayerState();
+	}
+	if (bReady)
+	{
+		int32 serverCharacters{ 0 };
+		for (TActorIterator<APortalCharacter> characterIterator{ servers[0] }; characterIterator; ++characterIterator)
+		{
+			serverCharacters += characterIterator->GetPlayerState() ? 1 : 0;
+		}
+		bReady = serverCharacters > numberOfClients;
+	}
+
+	if (!bReady)
+	{
+		if (phaseSeconds > PlayersTimeout)
+		{
+			test->AddError(FString::Printf(TEXT("%d clients didn't join the listen server within %.0f s"), numberOfClients, PlayersTimeout));
+			return true;
+		}
+		return false;
+	}
+
+	serverWorld = servers[0];
+	for (UWorld* client : clients)
+	{
+		clientWorlds.Add(client);
+	}
+	return !PlaceCharacter();
+}
+
+bool FPortalScriptedCrossingsCommand::PlaceCharacter()
+{
+	UPortalManagerSubsystem* portalManager{ GetPortalManager(clientWorlds[currentClient].Get()) };
+	const APortalCharacter* character{ portalManager ? portalManager->GetPlayerCharacter() : nullptr };
+	walkPortal = portalManager ? FindWalkablePortal(portalManager) : nullptr;
+	if (!character || !walkPortal.IsValid())
+	{
+		test->AddError(FString::Printf(TEXT("%s has no connected upright portal to walk through"), PortalTestMap));
+		return false;
+	}
+
+	//The server moves its copy of the client's character, the client's own move would be corrected back
+	APortalCharacter* serverCharacter{ nullptr };
+	for (TActorIterator<APortalCharacter> characterIterator{ serverWorld.Get() }; characterIterator; ++characterIterator)
+	{
+		if (characterIterator->GetPlayerState() && characterIterator->GetPlayerState()->GetPlayerId() == character->GetPlayerState()->GetPlayerId())
+		{
+			serverCharacter = *characterIterator;
+			break;
+		}
+	}
+	if (!serverCharacter)
+	{
+		test->AddError(FString::Printf(TEXT("The server has no character for client %d"), currentClient));
+		return false;
+	}
+
+	//Standing on the floor below the portal's center, facing it
+	const FPortalRect portalRect{ walkPortal->GetPortalRect() };
+	FVector location{ portalRect.origin + portalRect.normal * StartDistance };
+	location.Z = portalRect.origin.Z - portalRect.halfExtents.Y + serverCharacter->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() + 1.0f;
+	if (!serverCharacter->TeleportTo(location, (-portalRect.normal).Rotation()))
+	{
+		test->AddError(FString::Printf(TEXT("Client %d's character couldn't be put in front of %s"), currentClient, *walkPortal->GetName()));
+		return false;
+	}
+
+	clientStartCrossings = portalManager->GetNetStats().predictedCrossings;
+	StartPhase(EPhase::Settle, clientStartCrossings);
+	return true;
+}
+
+void FPortalScriptedCrossingsCommand::CheckNetStats()
+{
+	int32 predictedCrossings{ 0 };
+	for (int32 index = 0; index < clientWorlds.Num(); ++index)
+	{
+		const UPortalManagerSubsystem* portalManager{ GetPortalManager(clientWorlds[index].Get()) };
+		if (!portalManager)
+		{
+			test->AddError(FString::Printf(TEXT("Client %d left before its net stats were checked"), index));
+			continue;
+		}
+
+		portalManager->DumpNetStats(*GLog);
+		const FPortalNetStats& netStats{ portalManager->GetNetStats() };
+		predictedCrossings += netStats.predictedCrossings;
+		test->TestEqual(FString::Printf(TEXT("Client %d predicted every scripted crossing"), index), netStats.predictedCrossings, crossingsPerClient);
+		test->TestEqual(FString::Printf(TEXT("The server rejected none of client %d's crossings"), index), netStats.rejectedCrossings, 0);
+		test->TestEqual(FString::Printf(TEXT("Client %d's movement wasn't corrected after a crossing"), index), netStats.crossingCorrections, 0);
+		test->TestTrue(FString::Printf(TEXT("Client %d's crossing messages are smaller than their unquantized values"), index), netStats.maxCrossingBits > 0 && netStats.maxCrossingBits < UnquantizedCrossingBits);
+	}
+
+	const UPortalManagerSubsystem* serverManager{ GetPortalManager(serverWorld.Get()) };
+	if (!serverManager)
+	{
+		test->AddError(TEXT("The server left before its net stats were checked"));
+		return;
+	}
+
+	serverManager->DumpNetStats(*GLog);
+	test->TestEqual(TEXT("The server validated every crossing the clients predicted"), serverManager->GetNetStats().acceptedRemoteCrossings, predictedCrossings);
+	test->TestEqual(TEXT("The server rejected no crossing"), serverManager->GetNetStats().rejectedRemoteCrossings, 0);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalNetCrossingsTest, "PortalVR.Net.Crossings", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPortalNetCrossingsTest::RunTest(const FString& Parameters)
+{
+	//A listen server and two clients, each client walks through the portals a few times
+	constexpr int32 NumberOfClients{ 2 };
+	constexpr int32 CrossingsPerClient{ 4 };
+
+	const TSharedPtr<FPortalPlaySettingsScope> playSettings{ MakeShared<FPortalPlaySettingsScope>(PIE_ListenServer, NumberOfClients + 1) };
+	ADD_LATENT_AUTOMATION_COMMAND(FEditorLoadMap(PortalTestMap));
+	ADD_LATENT_AUTOMATION_COMMAND(FStartPIECommand(false));
+	ADD_LATENT_AUTOMATION_COMMAND(FPortalScriptedCrossingsCommand(this, NumberOfClients, CrossingsPerClient));
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FPortalRestorePlaySettingsCommand(playSettings));
+	return true;
+}
+
+/*
+ * Adds a second local player to a standalone play session and checks it got its own copy of every connected portal,
+ * connected to each other like the level's portals and hidden from the first player, and the other way around
+ */
+class FPortalSplitScreenCommand : public IAutomationLatentCommand
+{
+public:
+
+	explicit FPortalSplitScreenCommand(FAutomationTestBase* inTest)
+		:test{ inTest }, bPlayerCreated{ false }
+	{
+	}
+
+	virtual bool Update() override;
+
+private:
+
+	static constexpr double Timeout{ 10.0 };
+
+	FAutomationTestBase* test;
+	bool bPlayerCreated;
+
+	void CheckViewers(const UPortalManagerSubsystem* portalManager);
+};
+
+bool FPortalSplitScreenCommand::Update()
+{
+	const TArray<UWorld*> worlds{ GetPlayWorlds(NM_Standalone) };
+	UPortalManagerSubsystem* portalManager{ worlds.Num() > 0 ? GetPortalManager(worlds[0]) : nullptr };
+	if (!portalManager || !portalManager->GetPlayerCharacter())
+	{
+		if (GetCurrentRunTime() > Timeout)
+		{
+			test->AddError(TEXT("The play session didn't start"));
+			return true;
+		}
+		return false;
+	}
+
+	if (!bPlayerCreated)
+	{
+		bPlayerCreated = true;
+		if (!UGameplayStatics::CreatePlayer(worlds[0], -1, true))
+		{
+			test->AddError(TEXT("The second local player couldn't be created"));
+			return true;
+		}
+		return false;
+	}
+
+	//The manager picks the new player up on its next update, once the game mode gave it a character
+	if (portalManager->GetViewerCount() < 2 || !portalManager->GetViewer(1).character)
+	{
+		if (GetCurrentRunTime() > Timeout)
+		{
+			test->AddError(TEXT("The portal manager didn't pick up the second local player"));
+			return true;
+		}
+		return false;
+	}
+
+	CheckViewers(portalManager);
+	return true;
+}
+
+void FPortalSplitScreenCommand::CheckViewers(const UPortalManagerSubsystem* portalManager)
+{
+	test->TestEqual(TEXT("Both local players are viewers"), portalManager->GetViewerCount(), 2);
+
+	const TArray<APortalVR*>& levelPortals{ portalManager->GetViewerPortals(0) };
+	const TArray<APortalVR*>& portalCopies{ portalManager->GetViewerPortals(1) };
+	const int32 connectedPortals{ levelPortals.FilterByPredicate([](const APortalVR* portal) { return portal->GetPortalTarget() != nullptr; }).Num() };
+	test->TestTrue(TEXT("The map has connected portals"), connectedPortals > 0);
+	test->TestEqual(TEXT("The second player has a copy of every connected portal"), portalCopies.Num(), connectedPortals);
+
+	const APlayerController* firstController{ portalManager->GetViewer(0).controller };
+	const APlayerController* secondController{ portalManager->GetViewer(1).controller };
+	for (const APortalVR* portalCopy : portalCopies)
+	{
+		test->TestTrue(FString::Printf(TEXT("%s leads to the second player's copy of the exit portal"), *portalCopy->GetName()), portalCopies.Contains(portalCopy->GetPortalTarget()));
+		test->TestTrue(FString::Printf(TEXT("%s is hidden from the first player"), *portalCopy->GetName()), firstController && firstController->HiddenActors.Contains(portalCopy));
+	}
+	for (const APortalVR* levelPortal : levelPortals)
+	{
+		test->TestTrue(FString::Printf(TEXT("%s is hidden from the second player"), *levelPortal->GetName()), secondController && secondController->HiddenActors.Contains(levelPortal));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalSplitScreenViewersTest, "PortalVR.SplitScreen.Viewers", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPortalSplitScreenViewersTest::RunTest(const FString& Parameters)
+{
+	const TSharedPtr<FPortalPlaySettingsScope> playSettings{ MakeShared<FPortalPlaySettingsScope>(PIE_Standalone, 1) };
+	ADD_LATENT_AUTOMATION_COMMAND(FEditorLoadMap(PortalTestMap));
+	ADD_LATENT_AUTOMATION_COMMAND(FStartPIECommand(false));
+	ADD_LATENT_AUTOMATION_COMMAND(FPortalSplitScreenCommand(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FPortalRestorePlaySettingsCommand(playSettings));
+	return true;
+}
+
+/*
+ * Runs the scalability benchmark in a standalone play session until it completes, then checks it measured every pair count, went through the portals in each and wrote its CSV file.
+ * It needs no rendering, CI runs it headless: UE4Editor-Cmd PortalVRExample.uproject -nullrhi -unattended -ExecCmds="Automation RunTests PortalVR.Bench.Scalability; Quit"
+ */
+class FPortalScalabilityCommand : public IAutomationLatentCommand
+{
+public:
+
+	FPortalScalabilityCommand(FAutomationTestBase* inTest, const TArray<int32>& inPairCounts)
+		:test{ inTest }, pairCounts{ inPairCounts }
+	{
+	}
+
+	virtual bool Update() override;
+
+private:
+
+	//Seconds the play session gets to start, and the benchmark to run all pair counts
+	static constexpr double StartTimeout{ 10.0 };
+	static constexpr double BenchmarkTimeout{ 300.0 };
+
+	FAutomationTestBase* test;
+	TArray<int32> pairCounts;
+	TUniquePtr<FPortalScalabilityBenchmark> benchmark;
+
+	void CheckResults();
+};
+
+bool FPortalScalabilityCommand::Update()
+{
+	if (!benchmark.IsValid())
+	{
+		const TArray<UWorld*> worlds{ GetPlayWorlds(NM_Standalone) };
+		const UPortalManagerSubsystem* portalManager{ worlds.Num() > 0 ? GetPortalManager(worlds[0]) : nullptr };
+		if (!portalManager || !portalManager->GetPlayerCharacter())
+		{
+			if (GetCurrentRunTime() > StartTimeout)
+			{
+				test->AddError(TEXT("The play session didn't start"));
+				return true;
+			}
+			return false;
+		}
+
+		//Owned by the test rather than started as the console's benchmark, so completing it doesn't quit the headless run before the test reported
+		benchmark = MakeUnique<FPortalScalabilityBenchmark>(worlds[0], pairCounts);
+	}
+
+	if (!benchmark->IsComplete())
+	{
+		if (GetCurrentRunTime() > BenchmarkTimeout)
+		{
+			test->AddError(FString::Printf(TEXT("The scalability benchmark didn't complete within %.0f s"), BenchmarkTimeout));
+			benchmark.Reset();
+			return true;
+		}
+		return false;
+	}
+
+	CheckResults();
+	benchmark.Reset();
+	return true;
+}
+
+void FPortalScalabilityCommand::CheckResults()
+{
+	test->TestTrue(TEXT("The scalability benchmark succeeded"), benchmark->HasSucceeded());
+
+	const TArray<int32>& runTeleports{ benchmark->GetRunTeleports() };
+	test->TestEqual(TEXT("Every pair count was measured"), runTeleports.Num(), pairCounts.Num());
+	for (int32 run = 0; run < runTeleports.Num(); ++run)
+	{
+		test->TestTrue(FString::Printf(TEXT("The camera went through the portals with %d pairs"), pairCounts[run]), runTeleports[run] > 0);
+	}
+
+	const FString& csvPath{ benchmark->GetCsvPath() };
+	if (test->TestFalse(TEXT("The results were written"), csvPath.IsEmpty()))
+	{
+		test->TestTrue(FString::Printf(TEXT("%s exists"), *csvPath), IFileManager::Get().FileExists(*csvPath));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalScalabilityBenchmarkTest, "PortalVR.Bench.Scalability", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPortalScalabilityBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const TSharedPtr<FPortalPlaySettingsScope> playSettings{ MakeShared<FPortalPlaySettingsScope>(PIE_Standalone, 1) };
+	ADD_LATENT_AUTOMATION_COMMAND(FEditorLoadMap(PortalTestMap));
+	ADD_LATENT_AUTOMATION_COMMAND(FStartPIECommand(false));
+	ADD_LATENT_AUTOMATION_COMMAND(FPortalScalabilityCommand(this, TArray<int32>{ 1, 2, 4, 8 }));
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FPortalRestorePlaySettingsCommand(playSettings));
+	return true;
+}
+
+//Waits for the standalone play session's player, then runs the test's checks once between two frames
+class FPortalPlaySessionCommand : public IAutomationLatentCommand
+{
+public:
+
+	FPortalPlaySessionCommand(FAutomationTestBase* inTest, TFunction<void(UPortalManagerSubsystem*)> inChecks)
+		:test{ inTest }, checks{ MoveTemp(inChecks) }
+	{
+	}
+
+	virtual bool Update() override
+	{
+		const TArray<UWorld*> worlds{ GetPlayWorlds(NM_Standalone) };
+		UPortalManagerSubsystem* portalManager{ worlds.Num() > 0 ? GetPortalManager(worlds[0]) : nullptr };
+		if (!portalManager || !portalManager->GetPlayerCharacter())
+		{
+			if (GetCurrentRunTime() > StartTimeout)
+			{
+				test->AddError(TEXT("The play session didn't start"));
+				return true;
+			}
+			return false;
+		}
+
+		checks(portalManager);
+		return true;
+	}
+
+private:
+
+	//Seconds the play session gets to start
+	static constexpr double StartTimeout{ 10.0 };
+
+	FAutomationTestBase* test;
+	TFunction<void(UPortalManagerSubsystem*)> checks;
+};
+
+//Plays the example map standalone and runs the checks in it
+static void RunInPlaySession(FAutomationTestBase* test, TFunction<void(UPortalManagerSubsystem*)> checks)
+{
+	const TSharedPtr<FPortalPlaySettingsScope> playSettings{ MakeShared<FPortalPlaySettingsScope>(PIE_Standalone, 1) };
+	ADD_LATENT_AUTOMATION_COMMAND(FEditorLoadMap(PortalTestMap));
+	ADD_LATENT_AUTOMATION_COMMAND(FStartPIECommand(false));
+	ADD_LATENT_AUTOMATION_COMMAND(FPortalPlaySessionCommand(test, MoveTemp(checks)));
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FPortalRestorePlaySettingsCommand(playSettings));
+}
+
+//Screen coverage of a portal the scheduler refreshes every 1, 2, 3 and 4 frames, between the thresholds of UPortalManagerSubsystem::GetRefreshInterval()
+static const float RefreshIntervalTestCoverage[]{ 0.2f, 0.05f, 0.02f, 0.005f };
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCaptureRefreshIntervalTest, "PortalVR.Capture.Scheduler.RefreshInterval", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPortalCaptureRefreshIntervalTest::RunTest(const FString& Parameters)
+{
+	RunInPlaySession(this, [this](UPortalManagerSubsystem* portalManager)
+	{
+		FPortalCaptureTestAccess access{ portalManager };
+		const TArray<APortalVR*>& portals{ access.GetPortals() };
+		if (!TestTrue(TEXT("The map has portals"), portals.Num() > 0))
+		{
+			return;
+		}
+
+		access.SetConsoleVariable(TEXT("r.Portal.MaxRefreshInterval"), TEXT("4"));
+		access.SetConsoleVariable(TEXT("r.Portal.MaxCapturePassesPerFrame"), TEXT("0"));
+
+		//A single visible portal, captured exactly on the frames of its refresh slot
+		APortalVR* portal{ portals[0] };
+		constexpr uint64 FirstFrame{ 1000 };
+		for (int32 interval = 1; interval <= UE_ARRAY_COUNT(RefreshIntervalTestCoverage); ++interval)
+		{
+			for (int32 phase = 0; phase < interval; ++phase)
+			{
+				access.PreparePortal(portal, RefreshIntervalTestCoverage[interval - 1], phase);
+				int32 captures{ 0 };
+				for (uint64 frame = FirstFrame; frame < FirstFrame + interval * 4; ++frame)
+				{
+					access.ScheduleFrame(frame, 0);
+					const bool bRefreshSlot{ (frame + phase) % interval == 0 };
+					captures += FPortalCaptureTestAccess::IsScheduled(portal) ? 1 : 0;
+					TestEqual(FString::Printf(TEXT("Interval %d, phase %d, frame %llu captures on the refresh slot only"), interval, phase, frame), FPortalCaptureTestAccess::IsScheduled(portal), bRefreshSlot);
+				}
+				TestEqual(FString::Printf(TEXT("The portal's refresh interval is %d"), interval), FPortalCaptureTestAccess::GetRefreshInterval(portal), interval);
+				TestEqual(FString::Printf(TEXT("Interval %d, phase %d captures once every %d frames"), interval, phase, interval), captures, 4);
+			}
+		}
+
+		//Two portals on the same interval with different phases take turns
+		if (portals.Num() > 1)
+		{
+			access.PreparePortal(portals[0], RefreshIntervalTestCoverage[1], 0);
+			access.PreparePortal(portals[1], RefreshIntervalTestCoverage[1], 1);
+			for (uint64 frame = FirstFrame; frame < FirstFrame + 8; ++frame)
+			{
+				access.ScheduleFrame(frame, 0);
+				TestTrue(FString::Printf(TEXT("Frame %llu captures one of the two portals"), frame), FPortalCaptureTestAccess::IsScheduled(portals[0]) != FPortalCaptureTestAccess::IsScheduled(portals[1]));
+			}
+		}
+	});
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCaptureDeferredTest, "PortalVR.Capture.Scheduler.PassBudget", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPortalCaptureDeferredTest::RunTest(const FString& Parameters)
+{
+	RunInPlaySession(this, [this](UPortalManagerSubsystem* portalManager)
+	{
+		FPortalCaptureTestAccess access{ portalManager };
+		const TArray<APortalVR*>& portals{ access.GetPortals() };
+		if (!TestTrue(TEXT("The map has at least two portals"), portals.Num() > 1))
+		{
+			return;
+		}
+
+		//Every portal is due every frame, but the passes only fit the largest one
+		int32 maxViewerPasses{ 0 };
+		for (APortalVR* portal : portals)
+		{
+			access.PreparePortal(portal, RefreshIntervalTestCoverage[0], 0);
+			maxViewerPasses = FMath::Max(maxViewerPasses, FPortalCaptureTestAccess::GetCapturePassCount(portal));
+		}
+
+		//The deferred portals are the most overdue on the next frames, so every portal gets its turn before any is captured again
+		constexpr uint64 FirstFrame{ 1000 };
+		const int32 frames{ portals.Num() * 3 };
+		for (uint64 frame = FirstFrame; frame < FirstFrame + frames; ++frame)
+		{
+			const int32 scheduledPasses{ access.ScheduleFrame(frame, maxViewerPasses) };
+			TestTrue(FString::Printf(TEXT("Frame %llu schedules %d passes, no more than %d"), frame, scheduledPasses, maxViewerPasses), scheduledPasses > 0 && scheduledPasses <= maxViewerPasses);
+			for (APortalVR* portal : portals)
+			{
+				TestTrue(FString::Printf(TEXT("%s waits at most %d frames on frame %llu"), *portal->GetName(), portals.Num(), frame), FPortalCaptureTestAccess::GetFramesSinceCapture(portal) < portals.Num());
+			}
+		}
+	});
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalCaptureTeleportTest, "PortalVR.Capture.Scheduler.Teleport", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPortalCaptureTeleportTest::RunTest(const FString& Parameters)
+{
+	RunInPlaySession(this, [this](UPortalManagerSubsystem* portalManager)
+	{
+		APortalVR* portal{ FindWalkablePortal(portalManager) };
+		if (!TestNotNull(TEXT("The map has a walkable portal"), portal))
+		{
+			return;
+		}
+
+		//Long overdue, with the frame's capture passes and pixels used up the exit portal could only get a forced capture
+		APortalVR* exitPortal{ portal->GetPortalTarget() };
+		FPortalCaptureTestAccess::ExhaustCaptureBudgets(portalManager, exitPortal);
+		FPortalCaptureTestAccess::TeleportThrough(portal, portalManager->GetPlayerCharacter());
+		TestTrue(TEXT("The exit portal's capture was scheduled"), FPortalCaptureTestAccess::IsScheduled(exitPortal));
+		TestEqual(TEXT("The exit portal was captured the frame of the teleport"), FPortalCaptureTestAccess::GetFramesSinceCapture(exitPortal), 0);
+	});
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalLODHysteresisTest, "PortalVR.Capture.LOD.Hysteresis", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPortalLODHysteresisTest::RunTest(const FString& Parameters)
+{
+	RunInPlaySession(this, [this](UPortalManagerSubsystem* portalManager)
+	{
+		FPortalCaptureTestAccess access{ portalManager };
+		const TArray<APortalVR*>& portals{ access.GetPortals() };
+		if (!TestTrue(TEXT("The map has portals"), portals.Num() > 0))
+		{
+			return;
+		}
+
+		access.SetConsoleVariable(TEXT("r.Portal.LODMaxTier"), TEXT("2"));
+		access.SetConsoleVariable(TEXT("r.Portal.LODDistanceScale"), TEXT("1"));
+		access.SetConsoleVariable(TEXT("r.Portal.LODHysteresis"), TEXT("0.1"));
+
+		APortalVR* portal{ portals[0] };
+		const float midDistance{ FPortalCaptureTestAccess::GetMidTierDistance(portal) };
+		const float farDistance{ FPortalCaptureTestAccess::GetFarTierDistance(portal) };
+		if (!TestTrue(TEXT("The portal's far tier starts well behind its mid tier"), midDistance > 0.0f && farDistance * 0.85f > midDistance * 1.15f))
+		{
+			return;
+		}
+
+		//A portal hardly covering the screen changes tier once its distance crossed the threshold by 10 %, and only changes back once it crossed back by 10 %
+		TestEqual(TEXT("Near stays near 5 % past the mid tier distance"), access.SelectLODTier(portal, EPortalLODTier::Near, midDistance * 1.05f, 0.0f, true), EPortalLODTier::Near);
+		TestEqual(TEXT("Near drops to mid 15 % past the mid tier distance"), access.SelectLODTier(portal, EPortalLODTier::Near, midDistance * 1.15f, 0.0f, true), EPortalLODTier::Mid);
+		TestEqual(TEXT("Mid stays mid 5 % short of the mid tier distance"), access.SelectLODTier(portal, EPortalLODTier::Mid, midDistance * 0.95f, 0.0f, true), EPortalLODTier::Mid);
+		TestEqual(TEXT("Mid goes back to near 15 % short of the mid tier distance"), access.SelectLODTier(portal, EPortalLODTier::Mid, midDistance * 0.85f, 0.0f, true), EPortalLODTier::Near);
+		TestEqual(TEXT("Mid stays mid 5 % past the far tier distance"), access.SelectLODTier(portal, EPortalLODTier::Mid, farDistance * 1.05f, 0.0f, true), EPortalLODTier::Mid);
+		TestEqual(TEXT("Mid drops to far 15 % past the far tier distance"), access.SelectLODTier(portal, EPortalLODTier::Mid, farDistance * 1.15f, 0.0f, true), EPortalLODTier::Far);
+		TestEqual(TEXT("Far stays far 5 % short of the far tier distance"), access.SelectLODTier(portal, EPortalLODTier::Far, farDistance * 0.95f, 0.0f, true), EPortalLODTier::Far);
+		TestEqual(TEXT("Far goes back to mid 15 % short of the far tier distance"), access.SelectLODTier(portal, EPortalLODTier::Far, farDistance * 0.85f, 0.0f, true), EPortalLODTier::Mid);
+		TestEqual(TEXT("Without the reprojection in the material the portal stays mid"), access.SelectLODTier(portal, EPortalLODTier::Mid, farDistance * 2.0f, 0.0f, false), EPortalLODTier::Mid);
+
+		//Going back and forth within the margin around either threshold never changes the tier, on either side of it
+		const float thresholds[]{ midDistance, farDistance };
+		for (float threshold : thresholds)
+		{
+			auto countTierChanges = [&access, portal, threshold](EPortalLODTier& tier)
+			{
+				int32 changes{ 0 };
+				for (int32 step = 0; step < 20; ++step)
+				{
+					const EPortalLODTier nextTier{ access.SelectLODTier(portal, tier, threshold * (step % 2 == 0 ? 0.95f : 1.05f), 0.0f, true) };
+					changes += nextTier != tier ? 1 : 0;
+					tier = nextTier;
+				}
+				return changes;
+			};
+
+			EPortalLODTier tier{ access.SelectLODTier(portal, EPortalLODTier::Near, threshold * 1.5f, 0.0f, true) };
+			const EPortalLODTier tierBeyond{ tier };
+			TestEqual(FString::Printf(TEXT("Moving around %.0f coming from beyond it keeps the tier"), threshold), countTierChanges(tier), 0);
+
+			tier = access.SelectLODTier(portal, tier, threshold * 0.8f, 0.0f, true);
+			TestTrue(FString::Printf(TEXT("Coming closer than %.0f goes up a tier"), threshold), tier < tierBeyond);
+			TestEqual(FString::Printf(TEXT("Moving around %.0f coming from closer keeps the tier"), threshold), countTierChanges(tier), 0);
+		}
+
+		//Between the thresholds a portal covering enough of the screen is near, with the same margin on its coverage
+		const float nearMinCoverage{ FPortalCaptureTestAccess::GetNearTierMinScreenCoverage(portal) };
+		if (nearMinCoverage > 0.0f && nearMinCoverage < 0.8f)
+		{
+			const float distance{ (midDistance * 1.15f + farDistance * 0.85f) * 0.5f };
+			TestEqual(TEXT("Mid stays mid 5 % over the near tier coverage"), access.SelectLODTier(portal, EPortalLODTier::Mid, distance, nearMinCoverage * 1.05f, true), EPortalLODTier::Mid);
+			TestEqual(TEXT("Mid goes near 15 % over the near tier coverage"), access.SelectLODTier(portal, EPortalLODTier::Mid, distance, nearMinCoverage * 1.15f, true), EPortalLODTier::Near);
+			TestEqual(TEXT("Near stays near 5 % under the near tier coverage"), access.SelectLODTier(portal, EPortalLODTier::Near, distance, nearMinCoverage * 0.95f, true), EPortalLODTier::Near);
+			TestEqual(TEXT("Near drops to mid 15 % under the near tier coverage"), access.SelectLODTier(portal, EPortalLODTier::Near, distance, nearMinCoverage * 0.85f, true), EPortalLODTier::Mid);
+		}
+	});
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalRecursionBudgetTest, "PortalVR.Capture.Recursion.Budget", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPortalRecursionBudgetTest::RunTest(const FString& Parameters)
+{
+	RunInPlaySession(this, [this](UPortalManagerSubsystem* portalManager)
+	{
+		FPortalCaptureTestAccess access{ portalManager };
+		access.SetConsoleVariable(TEXT("r.Portal.MaxCapturePassesPerFrame"), TEXT("0"));
+		access.SetConsoleVariable(TEXT("r.Portal.MaxRecursiveCapturesPerFrame"), TEXT("100"));
+
+		//The depth follows the console variable up to the deepest level the portals keep nested captures for
+		access.SetConsoleVariable(TEXT("r.Portal.RecursionMaxDepth"), TEXT("0"));
+		TestEqual(TEXT("Depth 0 turns the recursion off"), UPortalManagerSubsystem::GetRecursionMaxDepth(), 0);
+		access.SetConsoleVariable(TEXT("r.Portal.RecursionMaxDepth"), TEXT("5"));
+		TestEqual(TEXT("The depth is clamped to the deepest level"), UPortalManagerSubsystem::GetRecursionMaxDepth(), APortalVR::MaxRecursionDepth);
+		access.SetConsoleVariable(TEXT("r.Portal.RecursionMaxDepth"), TEXT("2"));
+		const int32 maxDepth{ UPortalManagerSubsystem::GetRecursionMaxDepth() };
+		TestEqual(TEXT("The depth follows the console variable"), maxDepth, 2);
+
+		//Levels down to the maximum depth are captured, the level below it is refused without taking anything from the budgets
+		access.ResetRecursionBudget(0);
+		TestTrue(TEXT("Level 1 is captured"), access.ReserveRecursiveCaptures(1, maxDepth) > 0);
+		access.ResetRecursionBudget(0);
+		TestTrue(TEXT("Level 2 is captured"), access.ReserveRecursiveCaptures(2, maxDepth) > 0);
+		access.ResetRecursionBudget(0);
+		TestEqual(TEXT("Level 3 is past the maximum depth"), access.ReserveRecursiveCaptures(3, maxDepth), 0);
+		TestEqual(TEXT("The refused level took no nested capture"), access.GetRecursiveCapturesThisFrame(), 0);
+		TestEqual(TEXT("The refused level took no capture pass"), access.GetCapturePassesReserved(), 0);
+
+		//The frame's nested captures stop at the per frame maximum, each taking one capture pass
+		access.SetConsoleVariable(TEXT("r.Portal.MaxRecursiveCapturesPerFrame"), TEXT("3"));
+		access.ResetRecursionBudget(0);
+		TestEqual(TEXT("Three nested captures fit in the frame"), access.ReserveRecursiveCaptures(1, maxDepth), 3);
+		TestEqual(TEXT("A deeper level doesn't get a fourth"), access.ReserveRecursiveCaptures(2, maxDepth), 0);
+		TestEqual(TEXT("The nested captures took a pass each"), access.GetCapturePassesReserved(), 3);
+
+		//Nested captures only get the capture passes the portals' own captures left over
+		access.SetConsoleVariable(TEXT("r.Portal.MaxRecursiveCapturesPerFrame"), TEXT("100"));
+		access.SetConsoleVariable(TEXT("r.Portal.MaxCapturePassesPerFrame"), TEXT("8"));
+		access.ResetRecursionBudget(6);
+		TestEqual(TEXT("Two nested captures fit in the passes left over"), access.ReserveRecursiveCaptures(1, maxDepth), 2);
+		TestEqual(TEXT("The frame's passes are used up"), access.GetCapturePassesReserved(), 8);
+	});
+	return true;
+}
+
+#endif
+
+#endif
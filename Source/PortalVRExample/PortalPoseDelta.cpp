@@ -0,0 +1,136 @@
+#include "PortalPoseDelta.h"
+#include "PortalMath.h"
+#include "PortalStats.h"
+
+#include "Engine/Engine.h"
+#include "IXRTrackingSystem.h"
+#include "RenderingThread.h"
+#include "SceneView.h"
+
+//Captures are matched to the views rendering them by location, both come from the same floats
+static constexpr float LatchedCaptureTolerance{ 0.01f };
+
+//Largest head move (cm, degrees) between the game thread pose and the newest one that is latched
+static constexpr float MaxLatchDistance{ 10.0f };
+static constexpr float MaxLatchAngle{ 15.0f };
+
+FPortalPoseDeltaExtension::FPortalPoseDeltaExtension(const FAutoRegister& autoRegister)
+	:FSceneViewExtensionBase{ autoRegister }, bHasCapturePose_RenderThread{ false }, bHasLatchedPose_RenderThread{ false }
+{
+}
+
+void FPortalPoseDeltaExtension::SetCapturePose(const FTransform& capturePose, const FTransform& parentTransform)
+{
+	//The command keeps the extension alive, the portal manager may release it before the command ran
+	TSharedRef<FPortalPoseDeltaExtension, ESPMode::ThreadSafe> extension{ StaticCastSharedRef<FPortalPoseDeltaExtension>(AsShared()) };
+	ENQUEUE_RENDER_COMMAND(SetPortalCapturePose)(
+		[extension, capturePose, parentTransform](FRHICommandListImmediate& RHICmdList)
+		{
+			extension->capturePose_RenderThread = capturePose;
+			extension->parentTransform_RenderThread = parentTransform;
+			extension->bHasCapturePose_RenderThread = true;
+			extension->latchedCaptures_RenderThread.Reset();
+			extension->bHasLatchedPose_RenderThread = false;
+		});
+}
+
+void FPortalPoseDeltaExtension::AddLatchedCapture(const FVector& location, const FRotator& rotation, const FMatrix& throughMatrix)
+{
+	TSharedRef<FPortalPoseDeltaExtension, ESPMode::ThreadSafe> extension{ StaticCastSharedRef<FPortalPoseDeltaExtension>(AsShared()) };
+	ENQUEUE_RENDER_COMMAND(AddPortalLatchedCapture)(
+		[extension, latchedCapture = FLatchedCapture{ location, rotation, throughMatrix }](FRHICommandListImmediate& RHICmdList)
+		{
+			extension->latchedCaptures_RenderThread.Add(latchedCapture);
+		});
+}
+
+FPortalPoseDeltaStats FPortalPoseDeltaExtension::ConsumeDeltaStats()
+{
+	FScopeLock lock{ &deltaStatsLock };
+	const FPortalPoseDeltaStats consumedStats{ deltaStats };
+	deltaStats = FPortalPoseDeltaStats{};
+	return consumedStats;
+}
+
+void FPortalPoseDeltaExtension::PreRenderView_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneView& InView)
+{
+	if (!InView.bIsSceneCapture || !bHasCapturePose_RenderThread || latchedCaptures_RenderThread.Num() == 0)
+	{
+		return;
+	}
+
+	//Captures render from their component's location, a capture that wasn't added (a nested capture, another viewer's) is left where the game thread put it
+	const FVector viewOrigin{ InView.ViewMatrices.GetViewOrigin() };
+	const FLatchedCapture* latchedCapture{ latchedCaptures_RenderThread.FindByPredicate([&viewOrigin](const FLatchedCapture& capture) { return capture.location.Equals(viewOrigin, LatchedCaptureTolerance); }) };
+	if (!latchedCapture)
+	{
+		return;
+	}
+
+	if (!bHasLatchedPose_RenderThread)
+	{
+		FQuat lateOrientation;
+		FVector latePosition;
+		if (!GEngine->XRSystem.IsValid() || !GEngine->XRSystem->GetCurrentPose(IXRTrackingSystem::HMDDeviceId, lateOrientation, latePosition))
+		{
+			return;
+		}
+
+		//A jump in the pose is a recenter or lost tracking, not head motion within the frame, the captures stay where the game thread put them
+		float distance;
+		float angle;
+		latchedPose_RenderThread = FTransform{ lateOrientation, latePosition };
+		FPortalMath::GetPoseDelta(capturePose_RenderThread, latchedPose_RenderThread, distance, angle);
+		if (distance > MaxLatchDistance || angle > MaxLatchAngle)
+		{
+			latchedCaptures_RenderThread.Reset();
+			return;
+		}
+		bHasLatchedPose_RenderThread = true;
+	}
+
+	/*
+	 * The same update the headset's late update does on the main view. Only the view matrix moves, the oblique near plane baked into the projection is in view space and moves along by the latched distance (a few millimeters).
+	 * Materials reprojecting the capture map it with the game thread pose, the portal manager doesn't add their captures
+	 */
+	FVector latchedLocation;
+	FRotator latchedRotation;
+	FPortalMath::LateLatchThroughPortal(latchedCapture->throughMatrix, parentTransform_RenderThread, capturePose_RenderThread, latchedPose_RenderThread,
+		latchedCapture->location, latchedCapture->rotation, latchedLocation, latchedRotation);
+	InView.ViewLocation = latchedLocation;
+	InView.ViewRotation = latchedRotation;
+	InView.UpdateViewMatrix();
+	INC_DWORD_STAT(STAT_PortalLateLatchedCaptures);
+}
+
+void FPortalPoseDeltaExtension::PostRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily)
+{
+	//Scene captures may be rendered as view families of their own, only the player's stereo view got the late update
+	if (!bHasCapturePose_RenderThread || InViewFamily.Views.Num() == 0 || InViewFamily.Views[0]->StereoPass != eSSP_LEFT_EYE)
+	{
+		return;
+	}
+	bHasCapturePose_RenderThread = false;
+
+	//The tracking system hands out the late updated pose on the render thread until the next frame begins rendering
+	FQuat lateOrientation;
+	FVector latePosition;
+	if (!GEngine->XRSystem.IsValid() || !GEngine->XRSystem->GetCurrentPose(IXRTrackingSystem::HMDDeviceId, lateOrientation, latePosition))
+	{
+		return;
+	}
+
+	//Latched captures were rendered from the pose sampled when they were latched, the rest is what the latch didn't catch up with
+	float distance;
+	float angle;
+	FPortalMath::GetPoseDelta(bHasLatchedPose_RenderThread ? latchedPose_RenderThread : capturePose_RenderThread, FTransform{ lateOrientation, latePosition }, distance, angle);
+	SET_FLOAT_STAT(STAT_PortalPoseToCaptureDistance, distance);
+	SET_FLOAT_STAT(STAT_PortalPoseToCaptureAngle, angle);
+
+	FScopeLock lock{ &deltaStatsLock };
+	++deltaStats.frames;
+	deltaStats.totalDistance += distance;
+	deltaStats.maxDistance = FMath::Max(deltaStats.maxDistance, distance);
+	deltaStats.totalAngle += angle;
+	deltaStats.maxAngle = FMath::Max(deltaStats.maxAngle, angle);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SceneViewExtension.h"
+
+//Pose to capture delta accumulated over a number of frames
+struct FPortalPoseDeltaStats
+{
+	int32 frames{ 0 };
+	float totalDistance{ 0.0f };
+	float maxDistance{ 0.0f };
+	float totalAngle{ 0.0f };
+	float maxAngle{ 0.0f };
+};
+
+/*
+ * Late latches the portal captures and measures how far the head pose they were rendered from is from the pose the main view is finally rendered with.
+ * The headset's tracking system moves the main view to its newest pose on the render thread (late update), after the captures were positioned on the game thread.
+ * Scene capture view families gather the view extensions too, so when a capture view is about to render, this moves it along with the head's move since the game thread pose,
+ * through the portal it captures (see FPortalMath::LateLatchThroughPortal()). Captures are found by the location they were submitted from, see AddLatchedCapture().
+ * Every frame the portal manager passes the head pose its captures used, and once the main view family was rendered the difference to the late updated pose is recorded.
+ * Poses are in tracking space, relative to the camera's parent (VROrigin)
+ */
+class FPortalPoseDeltaExtension : public FSceneViewExtensionBase
+{
+public:
+
+	FPortalPoseDeltaExtension(const FAutoRegister& autoRegister);
+
+	//Game thread: head pose this frame's captures are positioned from, and the world transform of the tracking space it's relative to. Forgets the previous frame's latched captures
+	void SetCapturePose(const FTransform& capturePose, const FTransform& parentTransform);
+
+	//Game thread: a capture about to be submitted from the location and rotation through the portal with the through matrix, it's latched when it renders
+	void AddLatchedCapture(const FVector& location, const FRotator& rotation, const FMatrix& throughMatrix);
+
+	//Game thread: deltas recorded since the last call, read by the "Portal.Bench.PoseDelta" benchmark
+	FPortalPoseDeltaStats ConsumeDeltaStats();
+
+	virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override {}
+	virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override {}
+	virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override {}
+	virtual void PreRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily) override {}
+	virtual void PreRenderView_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneView& InView) override;
+	virtual void PostRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily) override;
+
+private:
+
+	struct FLatchedCapture
+	{
+		FVector location;
+		FRotator rotation;
+		FMatrix throughMatrix;
+	};
+
+	//Render thread copies, set in submission order before the frame's captures and main view
+	FTransform capturePose_RenderThread;
+	FTransform parentTransform_RenderThread;
+	bool bHasCapturePose_RenderThread;
+	TArray<FLatchedCapture> latchedCaptures_RenderThread;
+
+	//Newest pose sampled when the frame's first capture was latched, all of the frame's captures are latched to it
+	FTransform latchedPose_RenderThread;
+	bool bHasLatchedPose_RenderThread;
+
+	FCriticalSection deltaStatsLock;
+	FPortalPoseDeltaStats deltaStats;
+};
@@ -0,0 +1,84 @@
+#include "PortalBenchmark.h"
+#include "PortalPoseDelta.h"
+#include "PortalManagerSubsystem.h"
+
+#include "Engine/World.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalPoseDelta, Log, All);
+
+/*
+ * Benchmark of the pose to capture delta, run with a headset while moving the head ("Portal.Bench.PoseDelta [frames]").
+ * Over a number of frames it reports how far the head pose the portal captures were rendered from was from the late updated pose the player's view was rendered with, see FPortalPoseDeltaExtension.
+ * Run it with "r.Portal.LateLatch 0" and 1 to compare the captures placed on the game thread with the late latched ones
+ */
+class FPortalPoseDeltaBenchmark : public FPortalBenchmark
+{
+public:
+
+	FPortalPoseDeltaBenchmark(UWorld* inWorld, int32 inFrames);
+
+private:
+
+	TWeakObjectPtr<UWorld> world;
+	int32 frames;
+	int32 currentFrame;
+
+	virtual bool Tick(float deltaTime) override;
+	FPortalPoseDeltaExtension* GetExtension() const;
+};
+
+FPortalPoseDeltaBenchmark::FPortalPoseDeltaBenchmark(UWorld* inWorld, int32 inFrames)
+	:world{ inWorld }, frames{ inFrames }, currentFrame{ 0 }
+{
+	FPortalPoseDeltaExtension* extension{ GetExtension() };
+	if (!extension)
+	{
+		UE_LOG(LogPortalPoseDelta, Warning, TEXT("Portal pose delta benchmark needs a headset and a level with portals"));
+		Complete(false);
+		return;
+	}
+
+	//Deltas recorded before the benchmark started are discarded
+	extension->ConsumeDeltaStats();
+	UE_LOG(LogPortalPoseDelta, Display, TEXT("Portal pose delta benchmark, %d frames"), frames);
+	StartTicking();
+}
+
+FPortalPoseDeltaExtension* FPortalPoseDeltaBenchmark::GetExtension() const
+{
+	UPortalManagerSubsystem* portalManager{ world.IsValid() ? world->GetSubsystem<UPortalManagerSubsystem>() : nullptr };
+	return portalManager ? portalManager->GetPoseDeltaExtension() : nullptr;
+}
+
+bool FPortalPoseDeltaBenchmark::Tick(float deltaTime)
+{
+	FPortalPoseDeltaExtension* extension{ GetExtension() };
+	if (!extension)
+	{
+		Complete(false);
+		return false;
+	}
+
+	if (++currentFrame < frames)
+	{
+		return true;
+	}
+
+	//The render thread runs up to a frame behind, so a frame or two fewer than requested may have been measured
+	const FPortalPoseDeltaStats stats{ extension->ConsumeDeltaStats() };
+	const float measuredFrames{ static_cast<float>(FMath::Max(stats.frames, 1)) };
+	UE_LOG(LogPortalPoseDelta, Display, TEXT("  Measured frames : %d"), stats.frames);
+	UE_LOG(LogPortalPoseDelta, Display, TEXT("  Pose to capture : %7.3f cm avg, %7.3f cm max, %7.3f deg avg, %7.3f deg max"),
+		stats.totalDistance / measuredFrames, stats.maxDistance, stats.totalAngle / measuredFrames, stats.maxAngle);
+
+	Complete(stats.frames > 0);
+	return false;
+}
+
+static FPortalBenchmarkCommand PortalPoseDeltaBenchmarkCommand(
+	TEXT("Portal.Bench.PoseDelta"),
+	TEXT("Reports the distance and angle between the head pose the portal captures used and the late updated pose of the player's view. Usage: Portal.Bench.PoseDelta [frames]"),
+	[](const TArray<FString>& args, UWorld* world)
+	{
+		return MakeUnique<FPortalPoseDeltaBenchmark>(world, args.Num() > 0 ? FMath::Max(FCString::Atoi(*args[0]), 1) : 300);
+	});
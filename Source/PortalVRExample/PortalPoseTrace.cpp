@@ -0,0 +1,115 @@
+#include "PortalPoseTrace.h"
+
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalPoseTrace, Log, All);
+
+void FPortalPoseTraceFrame::SetProjection(float (&outTerms)[6], const FMatrix& projection)
+{
+	outTerms[0] = projection.M[0][0];
+	outTerms[1] = projection.M[1][1];
+	outTerms[2] = projection.M[2][0];
+	outTerms[3] = projection.M[2][1];
+	outTerms[4] = projection.M[2][2];
+	outTerms[5] = projection.M[3][2];
+}
+
+FMatrix FPortalPoseTraceFrame::GetProjection(const float (&terms)[6])
+{
+	return FMatrix{
+		FPlane{ terms[0], 0.0f, 0.0f, 0.0f },
+		FPlane{ 0.0f, terms[1], 0.0f, 0.0f },
+		FPlane{ terms[2], terms[3], terms[4], 1.0f },
+		FPlane{ 0.0f, 0.0f, terms[5], 0.0f } };
+}
+
+FArchive& operator<<(FArchive& ar, FPortalPoseTraceFrame& frame)
+{
+	ar << frame.rootLocation << frame.rootRotation;
+	ar << frame.originLocation << frame.originRotation;
+	ar << frame.cameraLocation << frame.cameraRotation;
+	ar << frame.viewCameraLocation << frame.viewCameraRotation;
+	ar << frame.leftEyeOffset << frame.rightEyeOffset;
+	for (int32 term = 0; term < 6; ++term)
+	{
+		ar << frame.leftProjection[term] << frame.rightProjection[term];
+	}
+
+	//A bool is serialized as 4 bytes
+	uint8 teleported{ frame.bTeleported };
+	ar << teleported;
+	frame.bTeleported = teleported != 0;
+	return ar;
+}
+
+bool FPortalPoseTrace::Save(const FString& path) const
+{
+	TArray<uint8> bytes;
+	FMemoryWriter writer{ bytes };
+
+	uint32 magic{ FileMagic };
+	uint32 version{ FileVersion };
+	FString savedMapName{ mapName };
+	float savedFrameDeltaTime{ frameDeltaTime };
+	int32 frameCount{ frames.Num() };
+	writer << magic << version << savedMapName << savedFrameDeltaTime << frameCount;
+	for (FPortalPoseTraceFrame frame : frames)
+	{
+		writer << frame;
+	}
+
+	return FFileHelper::SaveArrayToFile(bytes, *path);
+}
+
+bool FPortalPoseTrace::Load(const FString& path)
+{
+	TArray<uint8> bytes;
+	if (!FFileHelper::LoadFileToArray(bytes, *path))
+	{
+		UE_LOG(LogPortalPoseTrace, Error, TEXT("Failed to read the portal pose trace %s"), *path);
+		return false;
+	}
+
+	FMemoryReader reader{ bytes };
+	uint32 magic{ 0 };
+	uint32 version{ 0 };
+	reader << magic << version;
+	if (magic != FileMagic || version != FileVersion)
+	{
+		UE_LOG(LogPortalPoseTrace, Error, TEXT("%s is not a portal pose trace of version %u"), *path, FileVersion);
+		return false;
+	}
+
+	int32 frameCount{ 0 };
+	reader << mapName << frameDeltaTime << frameCount;
+	if (reader.IsError() || frameCount < 0 || frameCount > reader.TotalSize() || frameDeltaTime <= 0.0f)
+	{
+		UE_LOG(LogPortalPoseTrace, Error, TEXT("The portal pose trace %s is corrupt"), *path);
+		return false;
+	}
+
+	frames.SetNum(frameCount);
+	for (FPortalPoseTraceFrame& frame : frames)
+	{
+		reader << frame;
+	}
+	if (reader.IsError())
+	{
+		UE_LOG(LogPortalPoseTrace, Error, TEXT("The portal pose trace %s is truncated"), *path);
+		frames.Reset();
+		return false;
+	}
+	return true;
+}
+
+FString FPortalPoseTrace::GetTracePath(const FString& nameOrPath)
+{
+	if (nameOrPath.Contains(TEXT("/")) || nameOrPath.Contains(TEXT("\\")))
+	{
+		return nameOrPath;
+	}
+	return FPaths::ProfilingDir() / TEXT("Portal") / TEXT("Traces") / nameOrPath + TEXT(".portaltrace");
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * One frame of a recorded player pose, as the portal manager saw it.
+ * The character's pose is sampled right before the crossing test, so a replay that sets it at the same point crosses the same portals in the same frames.
+ * The camera's pose and the eyes are sampled after the frame as the captures used them
+ */
+struct FPortalPoseTraceFrame
+{
+	//Character root in world space, VROrigin relative to the root and the camera relative to VROrigin (the headset pose) before the crossing test
+	FVector rootLocation{ ForceInitToZero };
+	FQuat rootRotation{ FQuat::Identity };
+	FVector originLocation{ ForceInitToZero };
+	FQuat originRotation{ FQuat::Identity };
+	FVector cameraLocation{ ForceInitToZero };
+	FQuat cameraRotation{ FQuat::Identity };
+
+	//Camera relative to VROrigin the captures were positioned from
+	FVector viewCameraLocation{ ForceInitToZero };
+	FQuat viewCameraRotation{ FQuat::Identity };
+
+	//Eye positions in camera space and the terms of the eyes' projection matrices, see GetProjection()
+	FVector leftEyeOffset{ ForceInitToZero };
+	FVector rightEyeOffset{ ForceInitToZero };
+	float leftProjection[6]{};
+	float rightProjection[6]{};
+
+	//The player teleported through a portal this frame
+	bool bTeleported{ false };
+
+	/*
+	 * An eye's projection is an off center reversed Z perspective, only its scale, center offset and depth terms are stored:
+	 * [0][0], [1][1], [2][0], [2][1], [2][2] and [3][2], [2][3] is always 1
+	 */
+	static void SetProjection(float (&outTerms)[6], const FMatrix& projection);
+	static FMatrix GetProjection(const float (&terms)[6]);
+
+	friend FArchive& operator<<(FArchive& ar, FPortalPoseTraceFrame& frame);
+};
+
+/*
+ * Player poses of a play session recorded frame by frame, saved as a compact binary file ("Portal.Trace.Record") and replayed headless as a regression benchmark ("Portal.Trace.Replay").
+ * Traces are saved to "Saved/Profiling/Portal/Traces/<name>.portaltrace"
+ */
+struct FPortalPoseTrace
+{
+	//"PPTR" and the file format version, files of another version are rejected
+	static constexpr uint32 FileMagic{ 0x52545050 };
+	static constexpr uint32 FileVersion{ 1 };
+
+	//Map the trace was recorded in, replays in other maps only warn
+	FString mapName;
+	//Average frame time of the recording, replays run at it as a fixed timestep
+	float frameDeltaTime{ 1.0f / 90.0f };
+	TArray<FPortalPoseTraceFrame> frames;
+
+	bool Save(const FString& path) const;
+	bool Load(const FString& path);
+
+	//Path of a trace from its name, or the path itself if it already is one
+	static FString GetTracePath(const FString& nameOrPath);
+};
@@ -0,0 +1,411 @@
+#include "PortalBenchmark.h"
+#include "PortalCharacter.h"
+#include "PortalLocalPlayer.h"
+#include "PortalManagerSubsystem.h"
+#include "PortalPoseTrace.h"
+
+#include "Algo/Accumulate.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalPoseTrace, Log, All);
+
+/*
+ * Records the player's poses every frame until stopped ("Portal.Trace.Record [name]", "Portal.Trace.Stop"), on a headset or in the editor.
+ * The character's root, VROrigin and camera are sampled right before the portal manager's crossing test, the camera pose and eyes the captures used once the frame is done
+ */
+class FPortalPoseTraceRecorder : public FPortalBenchmark
+{
+public:
+
+	FPortalPoseTraceRecorder(UWorld* inWorld, const FString& inPath);
+	virtual ~FPortalPoseTraceRecorder() override;
+
+	//Saves the trace, returns false if nothing was recorded or the file couldn't be written
+	bool Save();
+
+private:
+
+	TWeakObjectPtr<UPortalManagerSubsystem> portalManager;
+	TWeakObjectPtr<APortalCharacter> character;
+	FString path;
+	FPortalPoseTrace trace;
+	FDelegateHandle trackingHandle;
+
+	double totalDeltaTime;
+	//The portal manager ran its crossing test since the last tick, the last frame still needs the captures' view
+	bool bFrameSampled;
+
+	void SampleCharacter();
+	virtual bool Tick(float deltaTime) override;
+};
+
+//Recording started by Portal.Trace.Record, for Portal.Trace.Stop to save
+static FPortalPoseTraceRecorder* ActivePoseTraceRecorder{ nullptr };
+
+FPortalPoseTraceRecorder::FPortalPoseTraceRecorder(UWorld* inWorld, const FString& inPath)
+	:path{ inPath }, totalDeltaTime{ 0.0 }, bFrameSampled{ false }
+{
+	portalManager = inWorld->GetSubsystem<UPortalManagerSubsystem>();
+	character = portalManager.IsValid() ? portalManager->GetPlayerCharacter() : nullptr;
+	if (!character.IsValid())
+	{
+		UE_LOG(LogPortalPoseTrace, Warning, TEXT("Portal pose trace recording needs a level with portals and a portal character"));
+		return;
+	}
+
+	trace.mapName = inWorld->GetMapName();
+	trackingHandle = portalManager->OnPreCharacterTracking().AddRaw(this, &FPortalPoseTraceRecorder::SampleCharacter);
+	ActivePoseTraceRecorder = this;
+	StartTicking();
+	UE_LOG(LogPortalPoseTrace, Display, TEXT("Recording a portal pose trace to %s"), *path);
+}
+
+FPortalPoseTraceRecorder::~FPortalPoseTraceRecorder()
+{
+	if (ActivePoseTraceRecorder == this)
+	{
+		ActivePoseTraceRecorder = nullptr;
+	}
+	if (portalManager.IsValid())
+	{
+		portalManager->OnPreCharacterTracking().Remove(trackingHandle);
+	}
+}
+
+void FPortalPoseTraceRecorder::SampleCharacter()
+{
+	if (!character.IsValid())
+	{
+		return;
+	}
+
+	FPortalPoseTraceFrame& frame{ trace.frames.AddDefaulted_GetRef() };
+	frame.rootLocation = character->GetActorLocation();
+	frame.rootRotation = character->GetActorQuat();
+	frame.originLocation = character->VROrigin->GetRelativeLocation();
+	frame.originRotation = character->VROrigin->GetRelativeRotation().Quaternion();
+	frame.cameraLocation = character->Camera->GetRelativeLocation();
+	frame.cameraRotation = character->Camera->GetRelativeRotation().Quaternion();
+	bFrameSampled = true;
+}
+
+bool FPortalPoseTraceRecorder::Tick(float deltaTime)
+{
+	if (!portalManager.IsValid() || !character.IsValid())
+	{
+		UE_LOG(LogPortalPoseTrace, Warning, TEXT("The world of the portal pose trace recording is gone, stop the recording to save what was recorded"));
+		return false;
+	}
+	if (!bFrameSampled)
+	{
+		return true;
+	}
+	bFrameSampled = false;
+	totalDeltaTime += deltaTime;
+
+	//The core ticker runs after the world ticked, the view frame holds the pose and eyes this frame's captures used
+	const FPortalViewFrame& viewFrame{ portalManager->GetViewFrame() };
+	const FTransform viewCameraTransform{ viewFrame.cameraTransform.GetRelativeTransform(character->VROrigin->GetComponentTransform()) };
+	FPortalPoseTraceFrame& frame{ trace.frames.Last() };
+	frame.viewCameraLocation = viewCameraTransform.GetLocation();
+	frame.viewCameraRotation = viewCameraTransform.GetRotation();
+	frame.leftEyeOffset = viewFrame.cameraTransform.InverseTransformPosition(viewFrame.leftEye.ViewOrigin);
+	frame.rightEyeOffset = viewFrame.cameraTransform.InverseTransformPosition(viewFrame.rightEye.ViewOrigin);
+
+	UPortalLocalPlayer* portalPlayer{ Cast<UPortalLocalPlayer>(portalManager->GetPlayerLocal()) };
+	FPortalPoseTraceFrame::SetProjection(frame.leftProjection, portalPlayer ? portalPlayer->GetCameraProjectionMatrix(eSSP_LEFT_EYE) : viewFrame.leftEye.ProjectionMatrix);
+	FPortalPoseTraceFrame::SetProjection(frame.rightProjection, portalPlayer ? portalPlayer->GetCameraProjectionMatrix(eSSP_RIGHT_EYE) : viewFrame.rightEye.ProjectionMatrix);
+	frame.bTeleported = portalManager->GetLastFrameCost().teleports > 0;
+	return true;
+}
+
+bool FPortalPoseTraceRecorder::Save()
+{
+	//A frame sampled before the crossing test but stopped before its tick has no view
+	if (bFrameSampled)
+	{
+		trace.frames.Pop();
+	}
+	if (trace.frames.Num() == 0)
+	{
+		UE_LOG(LogPortalPoseTrace, Warning, TEXT("No frames were recorded, the portal pose trace isn't saved"));
+		return false;
+	}
+
+	trace.frameDeltaTime = static_cast<float>(totalDeltaTime / trace.frames.Num());
+	if (!trace.Save(path))
+	{
+		UE_LOG(LogPortalPoseTrace, Error, TEXT("Failed to write the portal pose trace to %s"), *path);
+		return false;
+	}
+	UE_LOG(LogPortalPoseTrace, Display, TEXT("Portal pose trace of %d frames (%.1f fps) written to %s"),
+		trace.frames.Num(), 1.0f / trace.frameDeltaTime, *FPaths::ConvertRelativePathToFull(path));
+	return true;
+}
+
+/*
+ * Replays a recorded pose trace as a regression benchmark ("Portal.Trace.Replay <name|path>").
+ * Every frame the recorded character pose is set right before the portal manager's crossing test and the recorded eyes replace the local player's view,
+ * at the recording's frame time as a fixed timestep, so the player crosses the same portals in the same frames on every run, with or without a headset.
+ * The portal manager's per frame cost is written to "Saved/Profiling/Portal/PortalReplay-<trace>-<date>.csv", and frames whose teleports differ from the recording are reported.
+ * For CI run it headless, it quits once done and exits with an error if the teleports differed:
+ * UE4Editor PortalVRExample.uproject /Game/Maps/<Map> -game -nullrhi -unattended -ExecCmds="Portal.Trace.Replay <name>"
+ */
+class FPortalPoseTraceReplay : public FPortalBenchmark
+{
+public:
+
+	FPortalPoseTraceReplay(UWorld* inWorld, const FString& inPath);
+	virtual ~FPortalPoseTraceReplay() override;
+
+private:
+
+	TWeakObjectPtr<UPortalManagerSubsystem> portalManager;
+	TWeakObjectPtr<APortalCharacter> character;
+	FString traceName;
+	FPortalPoseTrace trace;
+	FDelegateHandle trackingHandle;
+
+	//Frame being replayed, the first frame is replayed once unmeasured so the crossing test doesn't see the jump from where the player was to the trace's start
+	int32 currentFrame;
+	bool bWarmupFrame;
+	bool bFrameApplied;
+	//The character and the engine's timestep were taken over and are yet to be restored
+	bool bReplaying;
+
+	//Character and engine state before the replay, restored once it is done
+	FTransform savedCharacterTransform;
+	FTransform savedOriginTransform;
+	FTransform savedCameraTransform;
+	TEnumAsByte<EMovementMode> savedMovementMode;
+	bool bSavedUseFixedTimeStep;
+	double savedFixedDeltaTime;
+
+	FString csv;
+	TArray<double> totalMs;
+	int32 teleports;
+	int32 teleportMismatches;
+
+	void ApplyFrame();
+	virtual bool Tick(float deltaTime) override;
+	void Finish();
+	void Restore();
+};
+
+FPortalPoseTraceReplay::FPortalPoseTraceReplay(UWorld* inWorld, const FString& inPath)
+	:traceName{ FPaths::GetBaseFilename(inPath) }, currentFrame{ 0 }, bWarmupFrame{ true }, bFrameApplied{ false }, bReplaying{ false }, savedMovementMode{ MOVE_Walking },
+	bSavedUseFixedTimeStep{ FApp::UseFixedTimeStep() }, savedFixedDeltaTime{ FApp::GetFixedDeltaTime() }, teleports{ 0 }, teleportMismatches{ 0 }
+{
+	portalManager = inWorld->GetSubsystem<UPortalManagerSubsystem>();
+	if (!portalManager.IsValid() || !portalManager->GetPlayerCharacter())
+	{
+		UE_LOG(LogPortalPoseTrace, Warning, TEXT("Portal pose trace replay needs a level with portals and a portal character"));
+		Finish();
+		return;
+	}
+	if (!trace.Load(inPath) || trace.frames.Num() == 0)
+	{
+		Finish();
+		return;
+	}
+	if (trace.mapName != inWorld->GetMapName())
+	{
+		UE_LOG(LogPortalPoseTrace, Warning, TEXT("The portal pose trace was recorded in %s, replaying it in %s"), *trace.mapName, *inWorld->GetMapName());
+	}
+
+	//The replay sets the character's pose, it must not move on its own
+	character = portalManager->GetPlayerCharacter();
+	savedCharacterTransform = character->GetActorTransform();
+	savedOriginTransform = character->VROrigin->GetRelativeTransform();
+	savedCameraTransform = character->Camera->GetRelativeTransform();
+	savedMovementMode = character->GetCharacterMovement()->MovementMode;
+	character->GetCharacterMovement()->SetMovementMode(MOVE_None);
+
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(trace.frameDeltaTime);
+	bReplaying = true;
+
+	csv = TEXT("frame,tracking_ms,portal_view_ms,teleport_ms,submit_ms,total_ms,active_portals,capture_passes,skipped_passes,nested_captures,teleports,recorded_teleports,entry_hitch_ms\n");
+
+	UE_LOG(LogPortalPoseTrace, Display, TEXT("Replaying the portal pose trace %s, %d frames at %.1f fps"), *traceName, trace.frames.Num(), 1.0f / trace.frameDeltaTime);
+	trackingHandle = portalManager->OnPreCharacterTracking().AddRaw(this, &FPortalPoseTraceReplay::ApplyFrame);
+	StartTicking();
+}
+
+FPortalPoseTraceReplay::~FPortalPoseTraceReplay()
+{
+	Restore();
+}
+
+void FPortalPoseTraceReplay::ApplyFrame()
+{
+	if (!character.IsValid() || !trace.frames.IsValidIndex(currentFrame))
+	{
+		return;
+	}
+
+	//The root is in world space, a frame that teleported differently than the recording is corrected by the next one
+	const FPortalPoseTraceFrame& frame{ trace.frames[currentFrame] };
+	character->SetActorLocationAndRotation(frame.rootLocation, frame.rootRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	character->VROrigin->SetRelativeLocationAndRotation(frame.originLocation, frame.originRotation);
+	character->Camera->SetRelativeLocationAndRotation(frame.cameraLocation, frame.cameraRotation);
+
+	FPortalReplayedView replayedView;
+	replayedView.cameraRelativeTransform = FTransform{ frame.viewCameraRotation, frame.viewCameraLocation };
+	replayedView.leftEyeOffset = frame.leftEyeOffset;
+	replayedView.rightEyeOffset = frame.rightEyeOffset;
+	replayedView.leftProjection = FPortalPoseTraceFrame::GetProjection(frame.leftProjection);
+	replayedView.rightProjection = FPortalPoseTraceFrame::GetProjection(frame.rightProjection);
+	portalManager->SetReplayedView(replayedView);
+	bFrameApplied = true;
+}
+
+bool FPortalPoseTraceReplay::Tick(float deltaTime)
+{
+	if (!portalManager.IsValid() || !character.IsValid())
+	{
+		UE_LOG(LogPortalPoseTrace, Warning, TEXT("The world of the portal pose trace replay is gone"));
+		Finish();
+		return false;
+	}
+
+	//Frames the world didn't tick in (paused, loading) don't advance the replay
+	if (!bFrameApplied)
+	{
+		return true;
+	}
+	bFrameApplied = false;
+	if (bWarmupFrame)
+	{
+		bWarmupFrame = false;
+		return true;
+	}
+
+	//The core ticker runs after the world ticked, so this reads the portal manager's cost of the frame that was just replayed
+	const FPortalFrameCost& frameCost{ portalManager->GetLastFrameCost() };
+	const FPortalPoseTraceFrame& frame{ trace.frames[currentFrame] };
+	const double trackingMs{ frameCost.characterTrackingSeconds * 1000.0 };
+	const double portalViewMs{ frameCost.portalViewSeconds * 1000.0 };
+	const double teleportMs{ frameCost.teleportSeconds * 1000.0 };
+	const double submitMs{ frameCost.submitSeconds * 1000.0 };
+	const double frameTotalMs{ trackingMs + portalViewMs + teleportMs + submitMs };
+	csv += FString::Printf(TEXT("%d,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%d,%.2f\n"), currentFrame, trackingMs, portalViewMs, teleportMs, submitMs, frameTotalMs,
+		frameCost.activePortals, frameCost.capturePasses, frameCost.skippedPasses, frameCost.nestedCaptures, frameCost.teleports, frame.bTeleported ? 1 : 0, frameCost.entryHitchMs);
+	totalMs.Add(frameTotalMs);
+	teleports += frameCost.teleports;
+
+	if ((frameCost.teleports > 0) != frame.bTeleported)
+	{
+		++teleportMismatches;
+		UE_LOG(LogPortalPoseTrace, Warning, TEXT("Frame %d %s in the recording but %s in the replay"), currentFrame,
+			frame.bTeleported ? TEXT("teleported") : TEXT("didn't teleport"), frameCost.teleports > 0 ? TEXT("teleported") : TEXT("didn't"));
+	}
+
+	if (++currentFrame < trace.frames.Num())
+	{
+		return true;
+	}
+
+	Finish();
+	return false;
+}
+
+void FPortalPoseTraceReplay::Restore()
+{
+	if (!bReplaying)
+	{
+		return;
+	}
+	bReplaying = false;
+
+	FApp::SetUseFixedTimeStep(bSavedUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(savedFixedDeltaTime);
+	if (portalManager.IsValid())
+	{
+		portalManager->OnPreCharacterTracking().Remove(trackingHandle);
+		portalManager->ClearReplayedView();
+	}
+	if (character.IsValid())
+	{
+		character->SetActorTransform(savedCharacterTransform, false, nullptr, ETeleportType::TeleportPhysics);
+		character->VROrigin->SetRelativeTransform(savedOriginTransform);
+		character->Camera->SetRelativeTransform(savedCameraTransform);
+		character->GetCharacterMovement()->SetMovementMode(savedMovementMode);
+		character.Reset();
+	}
+}
+
+void FPortalPoseTraceReplay::Finish()
+{
+	Restore();
+
+	if (totalMs.Num() > 0)
+	{
+		const FString csvPath{ FPaths::ProfilingDir() / TEXT("Portal") / FString::Printf(TEXT("PortalReplay-%s-%s.csv"), *traceName, *FDateTime::Now().ToString()) };
+		if (FFileHelper::SaveStringToFile(csv, *csvPath))
+		{
+			UE_LOG(LogPortalPoseTrace, Display, TEXT("Portal pose trace replay results written to %s"), *FPaths::ConvertRelativePathToFull(csvPath));
+		}
+		else
+		{
+			UE_LOG(LogPortalPoseTrace, Error, TEXT("Failed to write the portal pose trace replay results to %s"), *csvPath);
+		}
+
+		TArray<double> sortedMs{ totalMs };
+		sortedMs.Sort();
+		UE_LOG(LogPortalPoseTrace, Display, TEXT("%d frames: %7.3f ms/frame avg, %7.3f ms p95, %7.3f ms max, %d teleports"), totalMs.Num(),
+			Algo::Accumulate(totalMs, 0.0) / totalMs.Num(), sortedMs[FMath::Min(FMath::FloorToInt(sortedMs.Num() * 0.95f), sortedMs.Num() - 1)], sortedMs.Last(), teleports);
+		if (teleportMismatches > 0)
+		{
+			UE_LOG(LogPortalPoseTrace, Error, TEXT("%d frames teleported differently than the recording"), teleportMismatches);
+		}
+	}
+
+	//Headless CI runs end with the replay, failing if nothing was replayed or it didn't reproduce the recording's teleports
+	Complete(totalMs.Num() > 0 && teleportMismatches == 0);
+}
+
+static void StopPortalPoseTrace(const TArray<FString>& args, UWorld* world)
+{
+	if (!ActivePoseTraceRecorder)
+	{
+		UE_LOG(LogPortalPoseTrace, Warning, TEXT("No portal pose trace is being recorded"));
+		return;
+	}
+
+	ActivePoseTraceRecorder->Save();
+	FPortalBenchmark::Stop();
+}
+
+static FPortalBenchmarkCommand PortalPoseTraceRecordCommand(
+	TEXT("Portal.Trace.Record"),
+	TEXT("Records the player's poses every frame until Portal.Trace.Stop, for replaying them as a portal regression benchmark. Usage: Portal.Trace.Record [name]"),
+	[](const TArray<FString>& args, UWorld* world)
+	{
+		const FString name{ args.Num() > 0 ? args[0] : FString::Printf(TEXT("PortalTrace-%s"), *FDateTime::Now().ToString()) };
+		return MakeUnique<FPortalPoseTraceRecorder>(world, FPortalPoseTrace::GetTracePath(name));
+	});
+
+static FAutoConsoleCommandWithWorldAndArgs PortalPoseTraceStopCommand(
+	TEXT("Portal.Trace.Stop"),
+	TEXT("Stops recording the player's poses and saves the trace to Saved/Profiling/Portal/Traces"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StopPortalPoseTrace));
+
+static FPortalBenchmarkCommand PortalPoseTraceReplayCommand(
+	TEXT("Portal.Trace.Replay"),
+	TEXT("Replays a recorded pose trace at its fixed frame time and writes the portal manager's per frame cost to a CSV file. Usage: Portal.Trace.Replay <name|path>"),
+	[](const TArray<FString>& args, UWorld* world) -> TUniquePtr<FPortalBenchmark>
+	{
+		if (args.Num() == 0)
+		{
+			UE_LOG(LogPortalPoseTrace, Warning, TEXT("Usage: Portal.Trace.Replay <name|path>"));
+			return nullptr;
+		}
+		return MakeUnique<FPortalPoseTraceReplay>(world, FPortalPoseTrace::GetTracePath(args[0]));
+	});
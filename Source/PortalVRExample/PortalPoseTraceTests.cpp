@@ -0,0 +1,172 @@
+#include "PortalPoseTrace.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/*
+ * Automation tests of the pose trace files ("Automation RunTests PortalVR.PoseTrace"), they only need the engine.
+ * The traces are written to the automation's transient directory and deleted again
+ */
+
+//Three frames with every value set, the second one teleporting
+static FPortalPoseTrace MakeTestTrace()
+{
+	FPortalPoseTrace trace;
+	trace.mapName = TEXT("/Game/VirtualRealityBP/Maps/MotionControllerMap");
+	trace.frameDeltaTime = 1.0f / 72.0f;
+
+	for (int32 index = 0; index < 3; ++index)
+	{
+		const float offset{ index * 10.0f };
+		FPortalPoseTraceFrame frame;
+		frame.rootLocation = FVector{ 100.0f + offset, -250.5f, 92.0f };
+		frame.rootRotation = FRotator{ 0.0f, 30.0f + offset, 0.0f }.Quaternion();
+		frame.originLocation = FVector{ 0.0f, 0.0f, -90.0f };
+		frame.originRotation = FQuat::Identity;
+		frame.cameraLocation = FVector{ 5.0f, -3.0f + offset, 170.25f };
+		frame.cameraRotation = FRotator{ -10.0f, offset, 2.5f }.Quaternion();
+		frame.viewCameraLocation = frame.cameraLocation + FVector{ 0.5f, 0.25f, 0.0f };
+		frame.viewCameraRotation = FRotator{ -10.5f, offset + 1.0f, 2.5f }.Quaternion();
+		frame.leftEyeOffset = FVector{ 0.0f, -3.2f, 0.0f };
+		frame.rightEyeOffset = FVector{ 0.0f, 3.2f, 0.0f };
+
+		FMatrix leftProjection{ FReversedZPerspectiveMatrix{ HALF_PI * 0.5f, 1.0f, 0.9f, 10.0f } };
+		leftProjection.M[2][0] = -0.05f - offset * 0.001f;
+		FMatrix rightProjection{ leftProjection };
+		rightProjection.M[2][0] = -leftProjection.M[2][0];
+		FPortalPoseTraceFrame::SetProjection(frame.leftProjection, leftProjection);
+		FPortalPoseTraceFrame::SetProjection(frame.rightProjection, rightProjection);
+
+		frame.bTeleported = index == 1;
+		trace.frames.Add(frame);
+	}
+	return trace;
+}
+
+static bool AreFramesEqual(const FPortalPoseTraceFrame& a, const FPortalPoseTraceFrame& b)
+{
+	return a.rootLocation == b.rootLocation && a.rootRotation == b.rootRotation && a.originLocation == b.originLocation && a.originRotation == b.originRotation
+		&& a.cameraLocation == b.cameraLocation && a.cameraRotation == b.cameraRotation && a.viewCameraLocation == b.viewCameraLocation && a.viewCameraRotation == b.viewCameraRotation
+		&& a.leftEyeOffset == b.leftEyeOffset && a.rightEyeOffset == b.rightEyeOffset
+		&& FMemory::Memcmp(a.leftProjection, b.leftProjection, sizeof(a.leftProjection)) == 0 && FMemory::Memcmp(a.rightProjection, b.rightProjection, sizeof(a.rightProjection)) == 0
+		&& a.bTeleported == b.bTeleported;
+}
+
+static FString GetTestTracePath()
+{
+	return FPaths::AutomationTransientDir() / TEXT("PortalPoseTraceTest.portaltrace");
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalPoseTraceProjectionTest, "PortalVR.PoseTrace.Projection", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalPoseTraceProjectionTest::RunTest(const FString& Parameters)
+{
+	//Off center like a headset's eyes, with the infinite far plane the engine uses and with a far plane
+	FMatrix infiniteProjection{ FReversedZPerspectiveMatrix{ HALF_PI * 0.45f, 1.2f, 1.0f, 10.0f } };
+	infiniteProjection.M[2][0] = 0.08f;
+	infiniteProjection.M[2][1] = -0.03f;
+	FMatrix finiteProjection{ FReversedZPerspectiveMatrix{ HALF_PI * 0.5f, HALF_PI * 0.5f, 1.0f, 1.0f, 10.0f, 5000.0f } };
+	finiteProjection.M[2][0] = -0.12f;
+
+	for (const FMatrix& projection : { infiniteProjection, finiteProjection })
+	{
+		float terms[6];
+		FPortalPoseTraceFrame::SetProjection(terms, projection);
+		TestTrue(TEXT("The projection is rebuilt from its terms"), FPortalPoseTraceFrame::GetProjection(terms).Equals(projection, 0.0f));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalPoseTraceSaveLoadTest, "PortalVR.PoseTrace.SaveLoad", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalPoseTraceSaveLoadTest::RunTest(const FString& Parameters)
+{
+	const FString path{ GetTestTracePath() };
+	const FPortalPoseTrace trace{ MakeTestTrace() };
+	if (!TestTrue(TEXT("The trace is saved"), trace.Save(path)))
+	{
+		return false;
+	}
+
+	FPortalPoseTrace loaded;
+	const bool bLoaded{ loaded.Load(path) };
+	IFileManager::Get().Delete(*path);
+	if (!TestTrue(TEXT("The trace is loaded"), bLoaded))
+	{
+		return false;
+	}
+
+	TestEqual(TEXT("The map name is kept"), loaded.mapName, trace.mapName);
+	TestEqual(TEXT("The frame time is kept"), loaded.frameDeltaTime, trace.frameDeltaTime);
+	if (TestEqual(TEXT("Every frame is loaded"), loaded.frames.Num(), trace.frames.Num()))
+	{
+		for (int32 index = 0; index < trace.frames.Num(); ++index)
+		{
+			TestTrue(FString::Printf(TEXT("Frame %d is loaded as it was saved"), index), AreFramesEqual(loaded.frames[index], trace.frames[index]));
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalPoseTraceRejectTest, "PortalVR.PoseTrace.Reject", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalPoseTraceRejectTest::RunTest(const FString& Parameters)
+{
+	const FString path{ GetTestTracePath() };
+	if (!TestTrue(TEXT("The trace is saved"), MakeTestTrace().Save(path)))
+	{
+		return false;
+	}
+
+	TArray<uint8> savedBytes;
+	FFileHelper::LoadFileToArray(savedBytes, *path);
+
+	//Loads the saved file with the change applied, it has to be rejected without any frame loaded
+	auto testRejected = [this, &path, &savedBytes](const TCHAR* what, TFunctionRef<void(TArray<uint8>&)> change)
+	{
+		TArray<uint8> bytes{ savedBytes };
+		change(bytes);
+		FFileHelper::SaveArrayToFile(bytes, *path);
+
+		FPortalPoseTrace loaded;
+		TestFalse(FString::Printf(TEXT("A trace with %s is rejected"), what), loaded.Load(path));
+		TestEqual(FString::Printf(TEXT("A trace with %s loads no frame"), what), loaded.frames.Num(), 0);
+	};
+
+	//Magic and version are the file's first two 32 bit words
+	AddExpectedError(TEXT("is not a portal pose trace"), EAutomationExpectedErrorFlags::Contains, 2);
+	testRejected(TEXT("another magic"), [](TArray<uint8>& bytes)
+	{
+		bytes[0] ^= 0xff;
+	});
+	testRejected(TEXT("another version"), [](TArray<uint8>& bytes)
+	{
+		const uint32 version{ FPortalPoseTrace::FileVersion + 1 };
+		FMemory::Memcpy(&bytes[sizeof(uint32)], &version, sizeof(version));
+	});
+
+	//Cut off in the middle of the last frame, and halfway through the frames
+	AddExpectedError(TEXT("is truncated"), EAutomationExpectedErrorFlags::Contains, 2);
+	testRejected(TEXT("its last frame cut off"), [](TArray<uint8>& bytes)
+	{
+		bytes.SetNum(bytes.Num() - 10);
+	});
+	testRejected(TEXT("half its bytes cut off"), [](TArray<uint8>& bytes)
+	{
+		bytes.SetNum(bytes.Num() / 2);
+	});
+
+	IFileManager::Get().Delete(*path);
+
+	AddExpectedError(TEXT("Failed to read the portal pose trace"), EAutomationExpectedErrorFlags::Contains, 1);
+	FPortalPoseTrace missing;
+	TestFalse(TEXT("A missing trace is rejected"), missing.Load(path));
+	return true;
+}
+
+#endif
@@ -0,0 +1,216 @@
+#include "PortalRenderTargetPool.h"
+#include "PortalStats.h"
+#include "PortalVR.h"
+
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarPortalRenderTargetPoolSize(
+	TEXT("r.Portal.RenderTargetPoolSizeMB"),
+	256,
+	TEXT("Maximum memory (MB) of all pooled portal render targets, least recently used render targets are evicted to stay under it."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPortalRenderTargetIdleTime(
+	TEXT("r.Portal.RenderTargetIdleTime"),
+	2.0f,
+	TEXT("Seconds of world time a portal can go without capturing or showing its previous capture before its render targets are returned to the pool."),
+	ECVF_Default);
+
+UPortalRenderTargetPool::UPortalRenderTargetPool()
+	:currentBytes{ 0 }, peakBytes{ 0 }
+{
+}
+
+UTextureRenderTarget2D* UPortalRenderTargetPool::AcquireRenderTarget(APortalVR* owner, int32 ownerSlot, const FIntPoint& size, EPixelFormat format)
+{
+	//World time stops while the game is paused or stuck in a hitch, so those don't make every lease look idle
+	const float now{ GetWorld()->GetTimeSeconds() };
+	auto touch = [now](FPortalRenderTargetEntry& entry)
+	{
+		entry.lastUsedTime = now;
+		entry.lastUsedFrame = GFrameCounter;
+		return entry.renderTarget;
+	};
+
+	//Most of the time the owner already holds a matching lease
+	FPortalRenderTargetEntry* leasedEntry{ entries.FindByPredicate([owner, ownerSlot](const FPortalRenderTargetEntry& entry) { return entry.owner == owner && entry.ownerSlot == ownerSlot; }) };
+	if (leasedEntry)
+	{
+		if (leasedEntry->size == size && leasedEntry->format == format)
+		{
+			return touch(*leasedEntry);
+		}
+
+		//Size or format changed, hand the old one back so another portal can use it
+		leasedEntry->owner = nullptr;
+	}
+
+	FPortalRenderTargetEntry* freeEntry{ entries.FindByPredicate([&size, format](const FPortalRenderTargetEntry& entry) { return !entry.owner && entry.size == size && entry.format == format; }) };
+	if (freeEntry)
+	{
+		freeEntry->owner = owner;
+		freeEntry->ownerSlot = ownerSlot;
+		return touch(*freeEntry);
+	}
+
+	const int64 sizeBytes{ static_cast<int64>(size.X) * size.Y * GPixelFormats[format].BlockBytes };
+	if (!MakeRoom(sizeBytes))
+	{
+		return nullptr;
+	}
+
+	//Pixel formats without a matching ETextureRenderTargetFormat (R11G11B10) need the override format, the captures write linear scene color into all of them
+	UTextureRenderTarget2D* renderTarget{ NewObject<UTextureRenderTarget2D>(this) };
+	renderTarget->ClearColor = FLinearColor::Black;
+	renderTarget->bAutoGenerateMips = false;
+	renderTarget->InitCustomFormat(size.X, size.Y, format, true);
+	renderTarget->UpdateResourceImmediate(true);
+
+	FPortalRenderTargetEntry& newEntry{ entries.AddDefaulted_GetRef() };
+	newEntry.renderTarget = renderTarget;
+	newEntry.owner = owner;
+	newEntry.ownerSlot = ownerSlot;
+	newEntry.size = size;
+	newEntry.format = format;
+	newEntry.sizeBytes = sizeBytes;
+
+	currentBytes += sizeBytes;
+	peakBytes = FMath::Max(peakBytes, currentBytes);
+	UpdateMemoryStats();
+
+	return touch(newEntry);
+}
+
+void UPortalRenderTargetPool::ReleaseRenderTargets(APortalVR* owner)
+{
+	for (FPortalRenderTargetEntry& entry : entries)
+	{
+		if (entry.owner == owner)
+		{
+			entry.owner = nullptr;
+		}
+	}
+}
+
+void UPortalRenderTargetPool::TouchRenderTargets(const APortalVR* owner)
+{
+	const float now{ GetWorld()->GetTimeSeconds() };
+	for (FPortalRenderTargetEntry& entry : entries)
+	{
+		if (entry.owner == owner && entry.ownerSlot < APortalVR::NestedCaptureSlot)
+		{
+			entry.lastUsedTime = now;
+			entry.lastUsedFrame = GFrameCounter;
+		}
+	}
+}
+
+int64 UPortalRenderTargetPool::GetLeasedBytes(const APortalVR* owner) const
+{
+	int64 leasedBytes{ 0 };
+	for (const FPortalRenderTargetEntry& entry : entries)
+	{
+		leasedBytes += entry.owner == owner ? entry.sizeBytes : 0;
+	}
+	return leasedBytes;
+}
+
+void UPortalRenderTargetPool::ReleaseIdleRenderTargets()
+{
+	const float idleTime{ CVarPortalRenderTargetIdleTime.GetValueOnGameThread() };
+	const float now{ GetWorld()->GetTimeSeconds() };
+
+	for (int32 index = entries.Num() - 1; index >= 0; --index)
+	{
+		FPortalRenderTargetEntry& entry{ entries[index] };
+		if (entry.owner && now - entry.lastUsedTime > idleTime)
+		{
+			RevokeLease(entry);
+		}
+		else if (!entry.owner && now - entry.lastUsedTime > idleTime * 2.0f)
+		{
+			DestroyEntry(index);
+		}
+	}
+}
+
+void UPortalRenderTargetPool::ReleaseAll()
+{
+	for (int32 index = entries.Num() - 1; index >= 0; --index)
+	{
+		if (entries[index].owner)
+		{
+			RevokeLease(entries[index]);
+		}
+		DestroyEntry(index);
+	}
+}
+
+bool UPortalRenderTargetPool::MakeRoom(int64 bytes)
+{
+	const int64 maxBytes{ static_cast<int64>(CVarPortalRenderTargetPoolSize.GetValueOnGameThread()) * 1024 * 1024 };
+
+	while (currentBytes + bytes > maxBytes)
+	{
+		//Free render targets go first, then leases that weren't used this frame. Anything used this frame is being displayed and can't be taken away
+		int32 evictIndex{ INDEX_NONE };
+		for (int32 index = 0; index < entries.Num(); ++index)
+		{
+			const FPortalRenderTargetEntry& entry{ entries[index] };
+			if (entry.owner && entry.lastUsedFrame == GFrameCounter)
+			{
+				continue;
+			}
+
+			if (evictIndex == INDEX_NONE)
+			{
+				evictIndex = index;
+				continue;
+			}
+
+			const FPortalRenderTargetEntry& candidate{ entries[evictIndex] };
+			const bool bEntryIsFree{ !entry.owner };
+			const bool bCandidateIsFree{ !candidate.owner };
+			if (bEntryIsFree != bCandidateIsFree ? bEntryIsFree : entry.lastUsedTime < candidate.lastUsedTime)
+			{
+				evictIndex = index;
+			}
+		}
+
+		if (evictIndex == INDEX_NONE)
+		{
+			return false;
+		}
+
+		if (entries[evictIndex].owner)
+		{
+			RevokeLease(entries[evictIndex]);
+		}
+		DestroyEntry(evictIndex);
+	}
+
+	return true;
+}
+
+void UPortalRenderTargetPool::RevokeLease(FPortalRenderTargetEntry& entry)
+{
+	//Let the owner drop its references so its material doesn't show whatever the next portal renders into this target
+	APortalVR* owner{ entry.owner };
+	entry.owner = nullptr;
+	owner->OnRenderTargetRevoked(entry.ownerSlot);
+}
+
+void UPortalRenderTargetPool::DestroyEntry(int32 index)
+{
+	currentBytes -= entries[index].sizeBytes;
+	entries[index].renderTarget->ReleaseResource();
+	entries.RemoveAtSwap(index);
+	UpdateMemoryStats();
+}
+
+void UPortalRenderTargetPool::UpdateMemoryStats()
+{
+	SET_MEMORY_STAT(STAT_PortalRenderTargetMemory, currentBytes);
+	SET_MEMORY_STAT(STAT_PortalRenderTargetMemoryPeak, peakBytes);
+	SET_DWORD_STAT(STAT_PortalRenderTargetCount, entries.Num());
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "PortalRenderTargetPool.generated.h"
+
+//A render target owned by the pool, either leased to a portal or free to be handed out again
+USTRUCT()
+struct FPortalRenderTargetEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UTextureRenderTarget2D* renderTarget{ nullptr };
+
+	//Portal currently leasing the render target, nullptr when the entry is free
+	class APortalVR* owner{ nullptr };
+	//Which of the owner's render targets this is (0 = left eye/shared, 1 = right eye)
+	int32 ownerSlot{ 0 };
+
+	FIntPoint size{ 0, 0 };
+	TEnumAsByte<EPixelFormat> format{ PF_FloatRGBA };
+	int64 sizeBytes{ 0 };
+
+	//Last world time and frame the render target was handed to its owner, used for idle release and least recently used eviction
+	float lastUsedTime{ 0.0f };
+	uint64 lastUsedFrame{ 0 };
+};
+
+/*
+ * World level pool of portal render targets, owned by the portal manager.
+ * Portals lease render targets by size and format right before they capture, so portals that are never seen never allocate anything.
+ * Leases that haven't been used for a while are returned to the pool, and the total memory stays under "r.Portal.RenderTargetPoolSizeMB" by evicting the least recently used render targets
+ */
+UCLASS()
+class PORTALVREXAMPLE_API UPortalRenderTargetPool : public UObject
+{
+	GENERATED_BODY()
+
+private:
+
+	UPROPERTY()
+	TArray<FPortalRenderTargetEntry> entries;
+
+	//Memory of all render targets owned by the pool, leased or free
+	int64 currentBytes;
+	int64 peakBytes;
+
+public:
+
+	UPortalRenderTargetPool();
+
+	/*
+	 * Returns the render target leased to the owner's slot if it matches the size and format, otherwise leases a matching free one or allocates a new one.
+	 * Returns nullptr if the memory cap can't be met even after evicting every render target not used this frame
+	 */
+	UTextureRenderTarget2D* AcquireRenderTarget(class APortalVR* owner, int32 ownerSlot, const FIntPoint& size, EPixelFormat format);
+
+	//Returns every render target leased by the owner to the pool
+	void ReleaseRenderTargets(class APortalVR* owner);
+
+	//Marks the owner's eye render targets as used without capturing into them, for portals that keep showing their previous capture. The nested captures' targets are left to age
+	void TouchRenderTargets(const class APortalVR* owner);
+
+	//Returns leases that haven't been used for "r.Portal.RenderTargetIdleTime" seconds of world time and frees render targets that stayed unused for twice as long
+	void ReleaseIdleRenderTargets();
+
+	//Frees every render target, leased ones included. Used when the viewport is resized and all sizes become stale
+	void ReleaseAll();
+
+	//Memory of the render targets currently leased by the owner
+	int64 GetLeasedBytes(const class APortalVR* owner) const;
+
+	int64 GetCurrentBytes() const { return currentBytes; }
+	int64 GetPeakBytes() const { return peakBytes; }
+
+private:
+
+	//Evicts least recently used render targets, free ones first, until the given amount of memory fits under the cap
+	bool MakeRoom(int64 bytes);
+
+	//Takes a render target away from its owner, the entry becomes free
+	void RevokeLease(FPortalRenderTargetEntry& entry);
+
+	//Releases the render target's resource and removes the entry from the pool
+	void DestroyEntry(int32 index);
+
+	void UpdateMemoryStats();
+};
@@ -0,0 +1,328 @@
+#include "PortalScalabilityBenchmark.h"
+#include "PortalCharacter.h"
+#include "PortalManagerSubsystem.h"
+#include "PortalRenderTargetPool.h"
+#include "PortalVR.h"
+
+#include "Algo/Accumulate.h"
+#include "Camera/CameraComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalScalability, Log, All);
+
+FPortalScalabilityBenchmark::FPortalScalabilityBenchmark(UWorld* inWorld, const TArray<int32>& inPairCounts)
+	:world{ inWorld }, pairCounts{ inPairCounts }, pairOrigin{ ForceInitToZero }, pairSpacing{ 0.0f }, exitHeight{ 0.0f }, savedControlRotation{ ForceInitToZero },
+	savedMovementMode{ MOVE_Walking }, currentRun{ 0 }, currentFrame{ 0 }
+{
+	for (TActorIterator<APortalVR> portalIterator{ inWorld }; portalIterator; ++portalIterator)
+	{
+		if (portalIterator->GetPortalTarget() && !portalIterator->IsViewerCopy())
+		{
+			templatePortal = *portalIterator;
+			break;
+		}
+	}
+
+	APlayerController* playerController{ inWorld->GetFirstPlayerController() };
+	character = playerController ? Cast<APortalCharacter>(playerController->GetPawn()) : nullptr;
+	if (!templatePortal.IsValid() || !character.IsValid())
+	{
+		UE_LOG(LogPortalScalability, Warning, TEXT("Portal scalability benchmark needs a level with connected portals and a portal character"));
+		character.Reset();
+		Finish(false);
+		return;
+	}
+
+	//Entrances in a row facing +X and their exits right above them, far enough from the level that nothing of it gets in the way
+	const FPortalRect portalRect{ templatePortal->GetPortalRect() };
+	pairOrigin = templatePortal->GetActorLocation() + FVector{ 0.0f, 0.0f, 20000.0f };
+	pairSpacing = portalRect.halfExtents.X * 4.0f + 200.0f;
+	exitHeight = portalRect.halfExtents.Y * 4.0f + 1000.0f;
+
+	savedCharacterTransform = character->GetActorTransform();
+	savedControlRotation = playerController->GetControlRotation();
+	savedMovementMode = character->GetCharacterMovement()->MovementMode;
+	character->GetCharacterMovement()->SetMovementMode(MOVE_Flying);
+
+	csv = TEXT("pairs,portals,frames,")
+		TEXT("tracking_avg_ms,tracking_p50_ms,tracking_p95_ms,tracking_p99_ms,tracking_max_ms,")
+		TEXT("portal_view_avg_ms,portal_view_p50_ms,portal_view_p95_ms,portal_view_p99_ms,portal_view_max_ms,")
+		TEXT("teleport_avg_ms,teleport_p50_ms,teleport_p95_ms,teleport_p99_ms,teleport_max_ms,")
+		TEXT("submit_avg_ms,submit_p50_ms,submit_p95_ms,submit_p99_ms,submit_max_ms,")
+		TEXT("total_avg_ms,total_p50_ms,total_p95_ms,total_p99_ms,total_max_ms,")
+		TEXT("capture_passes_avg,capture_passes_p50,capture_passes_p95,capture_passes_p99,capture_passes_max,")
+		TEXT("nested_captures_avg,nested_captures_p50,nested_captures_p95,nested_captures_p99,nested_captures_max,")
+		TEXT("rt_memory_avg_mb,rt_memory_p50_mb,rt_memory_p95_mb,rt_memory_p99_mb,rt_memory_max_mb,teleports\n");
+
+	UE_LOG(LogPortalScalability, Display, TEXT("Portal scalability benchmark, %d warmup and %d measured frames per pair count"), WarmupFrames, MeasuredFrames);
+	if (!StartRun())
+	{
+		Finish(false);
+		return;
+	}
+	StartTicking();
+}
+
+FPortalScalabilityBenchmark::~FPortalScalabilityBenchmark()
+{
+	DestroyPairs();
+	RestoreCharacter();
+}
+
+bool FPortalScalabilityBenchmark::Tick(float deltaTime)
+{
+	UPortalManagerSubsystem* portalManager{ world.IsValid() ? world->GetSubsystem<UPortalManagerSubsystem>() : nullptr };
+	if (!portalManager || !character.IsValid())
+	{
+		UE_LOG(LogPortalScalability, Warning, TEXT("The world of the portal scalability benchmark is gone"));
+		Finish(false);
+		return false;
+	}
+
+	//The core ticker runs once per engine frame after the world ticked, so this reads the portal manager's cost of the frame that just finished
+	if (currentFrame >= WarmupFrames)
+	{
+		const FPortalFrameCost& frameCost{ portalManager->GetLastFrameCost() };
+		const double trackingMs{ frameCost.characterTrackingSeconds * 1000.0 };
+		const double portalViewMs{ frameCost.portalViewSeconds * 1000.0 };
+		const double teleportMs{ frameCost.teleportSeconds * 1000.0 };
+		const double submitMs{ frameCost.submitSeconds * 1000.0 };
+		samples.trackingMs.Add(trackingMs);
+		samples.portalViewMs.Add(portalViewMs);
+		samples.teleportMs.Add(teleportMs);
+		samples.submitMs.Add(submitMs);
+		samples.totalMs.Add(trackingMs + portalViewMs + teleportMs + submitMs);
+		samples.capturePasses.Add(frameCost.capturePasses);
+		samples.nestedCaptures.Add(frameCost.nestedCaptures);
+		samples.renderTargetMB.Add(portalManager->GetRenderTargetPool()->GetCurrentBytes() / (1024.0 * 1024.0));
+		samples.teleports += frameCost.teleports;
+	}
+
+	if (++currentFrame < WarmupFrames + MeasuredFrames)
+	{
+		MoveCamera(currentFrame);
+		return true;
+	}
+
+	FinishRun();
+	if (++currentRun < pairCounts.Num())
+	{
+		if (StartRun())
+		{
+			return true;
+		}
+		Finish(false);
+		return false;
+	}
+
+	Finish(true);
+	return false;
+}
+
+bool FPortalScalabilityBenchmark::StartRun()
+{
+	DestroyPairs();
+	if (!SpawnPairs(pairCounts[currentRun]))
+	{
+		return false;
+	}
+
+	currentFrame = 0;
+	samples = FRunSamples{};
+	MoveCamera(0);
+	return true;
+}
+
+void FPortalScalabilityBenchmark::FinishRun()
+{
+	const int32 pairs{ pairCounts[currentRun] };
+	const int32 portals{ world.IsValid() ? world->GetSubsystem<UPortalManagerSubsystem>()->GetRegisteredPortalCount() : 0 };
+	const double averageTotalMs{ samples.totalMs.Num() > 0 ? Algo::Accumulate(samples.totalMs, 0.0) / samples.totalMs.Num() : 0.0 };
+	const double averageCapturePasses{ samples.capturePasses.Num() > 0 ? Algo::Accumulate(samples.capturePasses, 0.0) / samples.capturePasses.Num() : 0.0 };
+
+	csv += FString::Printf(TEXT("%d,%d,%d,"), pairs, portals, samples.totalMs.Num());
+	csv += FormatPercentiles(samples.trackingMs) + TEXT(",");
+	csv += FormatPercentiles(samples.portalViewMs) + TEXT(",");
+	csv += FormatPercentiles(samples.teleportMs) + TEXT(",");
+	csv += FormatPercentiles(samples.submitMs) + TEXT(",");
+	csv += FormatPercentiles(samples.totalMs) + TEXT(",");
+	csv += FormatPercentiles(samples.capturePasses) + TEXT(",");
+	csv += FormatPercentiles(samples.nestedCaptures) + TEXT(",");
+	csv += FormatPercentiles(samples.renderTargetMB) + FString::Printf(TEXT(",%d\n"), samples.teleports);
+	runTeleports.Add(samples.teleports);
+
+	UE_LOG(LogPortalScalability, Display, TEXT("%4d pairs (%4d portals): %7.3f ms/frame avg, %6.2f capture passes/frame avg, %d teleports"),
+		pairs, portals, averageTotalMs, averageCapturePasses, samples.teleports);
+}
+
+void FPortalScalabilityBenchmark::RestoreCharacter()
+{
+	if (!character.IsValid())
+	{
+		return;
+	}
+
+	character->SetActorTransform(savedCharacterTransform, false, nullptr, ETeleportType::TeleportPhysics);
+	character->GetCharacterMovement()->SetMovementMode(savedMovementMode);
+	if (AController* controller{ character->GetController() })
+	{
+		controller->SetControlRotation(savedControlRotation);
+	}
+	character.Reset();
+}
+
+void FPortalScalabilityBenchmark::Finish(bool bSucceeded)
+{
+	DestroyPairs();
+	RestoreCharacter();
+
+	//The camera walks through every pair, a run without teleports measured portals nobody went through
+	if (runTeleports.Contains(0))
+	{
+		UE_LOG(LogPortalScalability, Error, TEXT("The camera didn't go through the portals in every pair count run"));
+		bSucceeded = false;
+	}
+
+	//Pair counts measured before a failure are still written
+	if (currentRun > 0)
+	{
+		const FString path{ FPaths::ProfilingDir() / TEXT("Portal") / FString::Printf(TEXT("PortalScalability-%s.csv"), *FDateTime::Now().ToString()) };
+		if (FFileHelper::SaveStringToFile(csv, *path))
+		{
+			csvPath = FPaths::ConvertRelativePathToFull(path);
+			UE_LOG(LogPortalScalability, Display, TEXT("Portal scalability results written to %s"), *csvPath);
+		}
+		else
+		{
+			UE_LOG(LogPortalScalability, Error, TEXT("Failed to write the portal scalability results to %s"), *path);
+			bSucceeded = false;
+		}
+	}
+
+	Complete(bSucceeded);
+}
+
+bool FPortalScalabilityBenchmark::SpawnPairs(int32 count)
+{
+	if (!world.IsValid() || !templatePortal.IsValid())
+	{
+		return false;
+	}
+
+	//The class defaults are spawned rather than copies of the template, whose captures were already changed by its LOD tier. Both portals of a pair are connected before either begins play
+	UClass* portalClass{ templatePortal->GetClass() };
+	for (int32 index = 0; index < count; ++index)
+	{
+		const FTransform entranceTransform{ FRotator::ZeroRotator, pairOrigin + FVector{ 0.0f, index * pairSpacing, 0.0f } };
+		const FTransform exitTransform{ FRotator::ZeroRotator, entranceTransform.GetLocation() + FVector{ 0.0f, 0.0f, exitHeight } };
+		APortalVR* entrancePortal{ world->SpawnActorDeferred<APortalVR>(portalClass, entranceTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn) };
+		APortalVR* exitPortal{ world->SpawnActorDeferred<APortalVR>(portalClass, exitTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn) };
+		if (!entrancePortal || !exitPortal || !entrancePortal->GetPortalMesh()->GetStaticMesh())
+		{
+			UE_LOG(LogPortalScalability, Warning, TEXT("%s can't be spawned as a portal pair, its portal mesh has to be set in the class defaults"), *portalClass->GetName());
+			if (entrancePortal)
+			{
+				entrancePortal->Destroy();
+			}
+			if (exitPortal)
+			{
+				exitPortal->Destroy();
+			}
+			return false;
+		}
+
+		entrancePortal->SetPortalTarget(exitPortal);
+		exitPortal->SetPortalTarget(entrancePortal);
+		entrancePortal->FinishSpawning(entranceTransform);
+		exitPortal->FinishSpawning(exitTransform);
+		spawnedPortals.Add(entrancePortal);
+		spawnedPortals.Add(exitPortal);
+	}
+	return true;
+}
+
+void FPortalScalabilityBenchmark::DestroyPairs()
+{
+	for (const TWeakObjectPtr<APortalVR>& portal : spawnedPortals)
+	{
+		if (portal.IsValid())
+		{
+			portal->Destroy();
+		}
+	}
+	spawnedPortals.Reset();
+}
+
+void FPortalScalabilityBenchmark::MoveCamera(int32 frame)
+{
+	const int32 pairs{ pairCounts[currentRun] };
+	const int32 segment{ frame / SegmentFrames };
+	const int32 segmentFrame{ frame % SegmentFrames };
+	const FVector entranceLocation{ pairOrigin + FVector{ 0.0f, (segment % pairs) * pairSpacing, 0.0f } };
+
+	//Every segment starts in front of the next entrance, all portals face +X so moving over from the last exit never crosses a portal
+	if (segmentFrame == 0)
+	{
+		PlaceCamera(entranceLocation + FVector{ ApproachDistance, 0.0f, 0.0f }, FRotator{ 0.0f, 180.0f, 0.0f });
+		return;
+	}
+
+	//Walks towards the entrance until the portal manager teleports the camera to the exit above it, then walks on away from the exitPortal
+	const FVector cameraLocation{ character->Camera->GetComponentLocation() };
+	const bool bThroughPortal{ cameraLocation.Z > entranceLocation.Z + exitHeight * 0.5f };
+	const FVector direction{ bThroughPortal ? FVector::ForwardVector : -FVector::ForwardVector };
+	PlaceCamera(cameraLocation + direction * StepDistance, direction.Rotation());
+}
+
+void FPortalScalabilityBenchmark::PlaceCamera(const FVector& cameraLocation, const FRotator& cameraRotation)
+{
+	//The camera may be offset from the character's root, the character is moved so the camera ends up on the path
+	const FVector cameraOffset{ character->GetActorTransform().InverseTransformPosition(character->Camera->GetComponentLocation()) };
+	character->SetActorLocationAndRotation(cameraLocation - cameraRotation.RotateVector(cameraOffset), cameraRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	character->GetCharacterMovement()->Velocity = FVector::ZeroVector;
+	if (AController* controller{ character->GetController() })
+	{
+		controller->SetControlRotation(cameraRotation);
+	}
+}
+
+FString FPortalScalabilityBenchmark::FormatPercentiles(TArray<double>& values)
+{
+	if (values.Num() == 0)
+	{
+		return TEXT("0,0,0,0,0");
+	}
+
+	//Nearest rank percentiles
+	values.Sort();
+	const auto percentile = [&values](double fraction)
+	{
+		return values[FMath::Clamp(FMath::CeilToInt(fraction * values.Num()) - 1, 0, values.Num() - 1)];
+	};
+	const double average{ Algo::Accumulate(values, 0.0) / values.Num() };
+	return FString::Printf(TEXT("%.4f,%.4f,%.4f,%.4f,%.4f"), average, percentile(0.5), percentile(0.95), percentile(0.99), values.Last());
+}
+
+static FPortalBenchmarkCommand PortalScalabilityBenchmarkCommand(
+	TEXT("Portal.Bench.Scalability"),
+	TEXT("Spawns portal pairs, walks the player through them and writes the portal manager's per frame cost for each pair count to a CSV file. Usage: Portal.Bench.Scalability [pairs...]"),
+	[](const TArray<FString>& args, UWorld* world)
+	{
+		TArray<int32> pairCounts;
+		for (const FString& arg : args)
+		{
+			pairCounts.Add(FMath::Max(FCString::Atoi(*arg), 1));
+		}
+		if (pairCounts.Num() == 0)
+		{
+			pairCounts = { 1, 2, 4, 8, 16, 32 };
+		}
+		return MakeUnique<FPortalScalabilityBenchmark>(world, pairCounts);
+	});
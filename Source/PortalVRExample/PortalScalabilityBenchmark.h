@@ -0,0 +1,91 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "PortalBenchmark.h"
+
+/*
+ * Benchmark of how the portal cost scales with the number of portals, run in a level with at least one portal ("Portal.Bench.Scalability [pairs...]").
+ * For every pair count it spawns that many pairs of the level's first portal's class (a blueprint with its mesh and material set) far away from the level, and moves the player camera along a fixed path
+ * walking through one pair after the other. The portal manager's game thread cost (camera crossing tests, capture views, teleports and capture submissions), the capture passes
+ * and the render target memory are recorded every frame and written to "Saved/Profiling/Portal/PortalScalability-<date>.csv" with percentiles, so builds can be compared.
+ * It needs no rendering. CI runs it headless through the "PortalVR.Bench.Scalability" automation test (see PortalManagerTests.cpp), or through the console command, which quits once done
+ * with an error if the level can't run it, a pair count saw no teleport or the CSV file couldn't be written:
+ * UE4Editor PortalVRExample.uproject /Game/Maps/<Map> -game -nullrhi -unattended -ExecCmds="Portal.Bench.Scalability 1 2 4 8 16"
+ */
+class FPortalScalabilityBenchmark : public FPortalBenchmark
+{
+public:
+
+	FPortalScalabilityBenchmark(UWorld* inWorld, const TArray<int32>& inPairCounts);
+	virtual ~FPortalScalabilityBenchmark() override;
+
+	//CSV file the results were written to, empty until the benchmark completed with at least one pair count measured
+	const FString& GetCsvPath() const { return csvPath; }
+
+	//Teleports of the camera measured for each pair count run so far
+	const TArray<int32>& GetRunTeleports() const { return runTeleports; }
+
+private:
+
+	//Frames run before and measured after spawning each pair count
+	static constexpr int32 WarmupFrames{ 30 };
+	static constexpr int32 MeasuredFrames{ 600 };
+	//Distance (in world units) the camera starts in front of a portal and moves per frame, the path is fixed per frame so runs don't depend on the frame time
+	static constexpr float ApproachDistance{ 400.0f };
+	static constexpr float StepDistance{ 10.0f };
+	//Frames the camera walks through a pair before moving on to the next one, including the frames after coming out of the exit portal
+	static constexpr int32 SegmentFrames{ 60 };
+
+	//Per frame samples of one pair count
+	struct FRunSamples
+	{
+		TArray<double> trackingMs;
+		TArray<double> portalViewMs;
+		TArray<double> teleportMs;
+		TArray<double> submitMs;
+		TArray<double> totalMs;
+		TArray<double> capturePasses;
+		TArray<double> nestedCaptures;
+		TArray<double> renderTargetMB;
+		int32 teleports{ 0 };
+	};
+
+	TWeakObjectPtr<UWorld> world;
+	TWeakObjectPtr<class APortalVR> templatePortal;
+	TWeakObjectPtr<class APortalCharacter> character;
+	TArray<int32> pairCounts;
+	TArray<TWeakObjectPtr<class APortalVR>> spawnedPortals;
+
+	//Where the pairs are spawned and how far apart, derived from the template portal's size
+	FVector pairOrigin;
+	float pairSpacing;
+	float exitHeight;
+
+	//Character's transform and movement mode before the benchmark, restored once it is done
+	FTransform savedCharacterTransform;
+	FRotator savedControlRotation;
+	TEnumAsByte<EMovementMode> savedMovementMode;
+
+	int32 currentRun;
+	int32 currentFrame;
+	FRunSamples samples;
+	TArray<int32> runTeleports;
+	FString csv;
+	FString csvPath;
+
+	virtual bool Tick(float deltaTime) override;
+	bool StartRun();
+	void FinishRun();
+	void Finish(bool bSucceeded);
+	void RestoreCharacter();
+	bool SpawnPairs(int32 count);
+	void DestroyPairs();
+
+	//Moves the player camera to the path's position for the frame
+	void MoveCamera(int32 frame);
+	void PlaceCamera(const FVector& cameraLocation, const FRotator& cameraRotation);
+
+	//Average, median, 95th and 99th percentile and maximum as CSV columns
+	static FString FormatPercentiles(TArray<double>& values);
+};
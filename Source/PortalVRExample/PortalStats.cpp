@@ -0,0 +1,68 @@
+#include "PortalStats.h"
+
+CSV_DEFINE_CATEGORY(Portal, true);
+
+DEFINE_STAT(STAT_PortalPostPhysicsTick);
+DEFINE_STAT(STAT_PortalPostUpdateTick);
+DEFINE_STAT(STAT_PortalPrepareCaptures);
+DEFINE_STAT(STAT_PortalSubmitCaptures);
+
+DEFINE_STAT(STAT_PortalCharacterTracking);
+DEFINE_STAT(STAT_PortalUpdateView);
+DEFINE_STAT(STAT_PortalCaptureSceneLeft);
+DEFINE_STAT(STAT_PortalCaptureSceneRight);
+DEFINE_STAT(STAT_PortalTeleportCharacter);
+DEFINE_STAT(STAT_PortalCreateTexturesAndMaterial);
+
+DEFINE_STAT(STAT_PortalsRegistered);
+DEFINE_STAT(STAT_PortalsActive);
+DEFINE_STAT(STAT_PortalsCulled);
+
+DEFINE_STAT(STAT_PortalsCaptured);
+DEFINE_STAT(STAT_PortalsCulledBackFace);
+DEFINE_STAT(STAT_PortalsCulledFrustum);
+DEFINE_STAT(STAT_PortalsCulledOcclusion);
+DEFINE_STAT(STAT_PortalsCulledPVS);
+DEFINE_STAT(STAT_PortalCapturesSkipped);
+
+DEFINE_STAT(STAT_PortalCapturesReused);
+DEFINE_STAT(STAT_PortalCapturesDeferred);
+
+DEFINE_STAT(STAT_PortalCapturedPixels);
+DEFINE_STAT(STAT_PortalsOverBudget);
+DEFINE_STAT(STAT_PortalBudgetScale);
+
+DEFINE_STAT(STAT_PortalRenderTargetMemory);
+DEFINE_STAT(STAT_PortalRenderTargetMemoryPeak);
+DEFINE_STAT(STAT_PortalRenderTargetCount);
+
+DEFINE_STAT(STAT_PortalTraversal);
+DEFINE_STAT(STAT_PortalTraversalCandidates);
+DEFINE_STAT(STAT_PortalTraversals);
+
+DEFINE_STAT(STAT_PortalRecursionLevel1);
+DEFINE_STAT(STAT_PortalRecursionLevel2);
+DEFINE_STAT(STAT_PortalRecursionLevel3);
+DEFINE_STAT(STAT_PortalRecursiveCapturesLevel1);
+DEFINE_STAT(STAT_PortalRecursiveCapturesLevel2);
+DEFINE_STAT(STAT_PortalRecursiveCapturesLevel3);
+DEFINE_STAT(STAT_PortalRecursionFallbacks);
+
+DEFINE_STAT(STAT_PortalsLODNear);
+DEFINE_STAT(STAT_PortalsLODMid);
+DEFINE_STAT(STAT_PortalsLODFar);
+DEFINE_STAT(STAT_PortalLODFarRefreshes);
+
+DEFINE_STAT(STAT_PortalPoseToCaptureDistance);
+DEFINE_STAT(STAT_PortalPoseToCaptureAngle);
+DEFINE_STAT(STAT_PortalLateLatchedCaptures);
+
+DEFINE_STAT(STAT_PortalStreamedLevels);
+DEFINE_STAT(STAT_PortalCaptureWarmups);
+DEFINE_STAT(STAT_PortalEntryHitches);
+DEFINE_STAT(STAT_PortalEntryHitchTime);
+
+DEFINE_STAT(STAT_PortalNetPredictedCrossings);
+DEFINE_STAT(STAT_PortalNetRejectedCrossings);
+DEFINE_STAT(STAT_PortalNetCrossingCorrections);
+DEFINE_STAT(STAT_PortalNetCrossingBits);
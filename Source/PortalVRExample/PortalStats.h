@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
+
+//Stat group for everything portal related, view in game with "stat Portal"
+DECLARE_STATS_GROUP(TEXT("Portal"), STATGROUP_Portal, STATCAT_Advanced);
+
+//CSV profiler category of the portal timings and per frame counts, recorded with "csvprofile start" or -csvCaptureFrames
+CSV_DECLARE_CATEGORY_EXTERN(Portal);
+
+//Times a scope as a cycle stat ("stat Portal"), a CSV profiler timing of the Portal category and an Unreal Insights CPU scope, all three from one place
+#define PORTAL_SCOPE_CYCLE_COUNTER(Stat, ScopeName) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	CSV_SCOPED_TIMING_STAT(Portal, ScopeName); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Portal_##ScopeName)
+
+//Game thread cost of the portal manager's ticks, see UPortalManagerSubsystem. Capture preparation runs in parallel unless "r.Portal.ParallelPrepare" is 0, so comparing both shows what it saves
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Post Physics Tick"), STAT_PortalPostPhysicsTick, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Post Update Tick"), STAT_PortalPostUpdateTick, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Prepare Captures"), STAT_PortalPrepareCaptures, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Submit Captures"), STAT_PortalSubmitCaptures, STATGROUP_Portal, );
+
+//Game thread cost of the individual steps, see APortalVR. Portal views are prepared in parallel, so their stat is summed over the worker threads
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Character Tracking"), STAT_PortalCharacterTracking, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Update View"), STAT_PortalUpdateView, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Capture Scene Left"), STAT_PortalCaptureSceneLeft, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Capture Scene Right"), STAT_PortalCaptureSceneRight, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Teleport Character"), STAT_PortalTeleportCharacter, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Create Textures And Material"), STAT_PortalCreateTexturesAndMaterial, STATGROUP_Portal, );
+
+//Portals registered with the portal manager, the ones prepared for capturing this frame and the ones culled, see UPortalManagerSubsystem::UpdateCaptures()
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Registered"), STAT_PortalsRegistered, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Active"), STAT_PortalsActive, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Culled"), STAT_PortalsCulled, STATGROUP_Portal, );
+
+//Per frame counters for the portal visibility culling stage in front of the portal captures, see APortalVR::ShouldCapturePortal()
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Captured"), STAT_PortalsCaptured, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Culled (Back Face)"), STAT_PortalsCulledBackFace, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Culled (Frustum)"), STAT_PortalsCulledFrustum, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Culled (Occlusion)"), STAT_PortalsCulledOcclusion, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Culled (PVS)"), STAT_PortalsCulledPVS, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Captures Skipped"), STAT_PortalCapturesSkipped, STATGROUP_Portal, );
+
+//Temporal capture scheduler, capture passes of visible portals that kept their previous capture this frame and how many of those were due but over the pass budget
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Captures Reused"), STAT_PortalCapturesReused, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Captures Deferred"), STAT_PortalCapturesDeferred, STATGROUP_Portal, );
+
+//Adaptive capture resolution, see UPortalManagerSubsystem
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Captured Pixels"), STAT_PortalCapturedPixels, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals Over Budget"), STAT_PortalsOverBudget, STATGROUP_Portal, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Portal Budget Scale"), STAT_PortalBudgetScale, STATGROUP_Portal, );
+
+//Render target pool, see UPortalRenderTargetPool
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Portal Render Target Memory"), STAT_PortalRenderTargetMemory, STATGROUP_Portal, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Portal Render Target Memory Peak"), STAT_PortalRenderTargetMemoryPeak, STATGROUP_Portal, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Portal Render Targets"), STAT_PortalRenderTargetCount, STATGROUP_Portal, );
+
+//Physics body traversal, see UPortalManagerSubsystem::UpdateTraversals()
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Traversal"), STAT_PortalTraversal, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Traversal Candidates"), STAT_PortalTraversalCandidates, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Traversals"), STAT_PortalTraversals, STATGROUP_Portal, );
+
+//Recursive portal rendering, nested captures per level (portals seen through portals) and their cost including the deeper levels, see APortalVR::CaptureNested()
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Recursion Level 1"), STAT_PortalRecursionLevel1, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Recursion Level 2"), STAT_PortalRecursionLevel2, STATGROUP_Portal, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Portal Recursion Level 3"), STAT_PortalRecursionLevel3, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Recursive Captures Level 1"), STAT_PortalRecursiveCapturesLevel1, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Recursive Captures Level 2"), STAT_PortalRecursiveCapturesLevel2, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Recursive Captures Level 3"), STAT_PortalRecursiveCapturesLevel3, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Recursion Fallbacks"), STAT_PortalRecursionFallbacks, STATGROUP_Portal, );
+
+//Distance based LOD tiers of the visible portals and how often far tier snapshots were refreshed, see APortalVR::SelectLODTier()
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals LOD Near"), STAT_PortalsLODNear, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals LOD Mid"), STAT_PortalsLODMid, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portals LOD Far"), STAT_PortalsLODFar, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal LOD Far Refreshes"), STAT_PortalLODFarRefreshes, STATGROUP_Portal, );
+
+//Distance and angle between the head pose the portal captures were rendered from and the late updated pose the player's view was rendered with, see FPortalPoseDeltaExtension
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Portal Pose To Capture Distance"), STAT_PortalPoseToCaptureDistance, STATGROUP_Portal, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Portal Pose To Capture Angle"), STAT_PortalPoseToCaptureAngle, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Late Latched Captures"), STAT_PortalLateLatchedCaptures, STATGROUP_Portal, );
+
+//Portal destination streaming and capture warm-up, see UPortalManagerSubsystem::UpdateDestinationStreaming(). The entry hitch is the longest frame after the last teleport that took over twice "r.Portal.TargetFrameTimeMs"
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Streamed Levels"), STAT_PortalStreamedLevels, STATGROUP_Portal, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Portal Capture Warmups"), STAT_PortalCaptureWarmups, STATGROUP_Portal, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Portal Entry Hitches"), STAT_PortalEntryHitches, STATGROUP_Portal, );
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Portal Entry Hitch Time"), STAT_PortalEntryHitchTime, STATGROUP_Portal, );
+
+//Replicated portal crossings, see UPortalManagerSubsystem::PredictCrossing(). Bits of the last crossing message sent, and character movement corrections within "r.Portal.Net.CorrectionWindow" of a crossing
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Portal Net Predicted Crossings"), STAT_PortalNetPredictedCrossings, STATGROUP_Portal, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Portal Net Rejected Crossings"), STAT_PortalNetRejectedCrossings, STATGROUP_Portal, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Portal Net Crossing Corrections"), STAT_PortalNetCrossingCorrections, STATGROUP_Portal, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Portal Net Crossing Bits"), STAT_PortalNetCrossingBits, STATGROUP_Portal, );
@@ -0,0 +1,221 @@
+#include "PortalBenchmark.h"
+#include "PortalManagerSubsystem.h"
+#include "PortalVR.h"
+
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HelperMacros.h"
+#include "Math/RandomStream.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalTraversal, Log, All);
+
+/*
+ * Benchmark of the physics body traversal, run in a level with connected portals ("Portal.Bench.Traversal [bodies...]").
+ * For every body count it spawns that many small physics cubes in front of the portals flying into them, and averages the cost of
+ * UPortalManagerSubsystem::UpdateTraversals() over a number of frames so the scaling with the number of bodies can be compared
+ */
+class FPortalTraversalBenchmark : public FPortalBenchmark
+{
+public:
+
+	FPortalTraversalBenchmark(UWorld* inWorld, const TArray<int32>& inBodyCounts);
+	virtual ~FPortalTraversalBenchmark() override;
+
+private:
+
+	//Frames measured for each body count, the bodies pass through the portals' traversal boxes within that time
+	static constexpr int32 MeasuredFrames{ 60 };
+
+	TWeakObjectPtr<UWorld> world;
+	TArray<TWeakObjectPtr<APortalVR>> portals;
+	TArray<int32> bodyCounts;
+	TArray<TWeakObjectPtr<AStaticMeshActor>> bodies;
+	UStaticMesh* bodyMesh;
+	FRandomStream random;
+
+	int32 currentRun;
+	int32 currentFrame;
+	double totalSeconds;
+	double maxSeconds;
+	int64 totalCandidates;
+	int32 totalTraversals;
+
+	virtual bool Tick(float deltaTime) override;
+	void StartRun();
+	void FinishRun();
+	void SpawnBodies(int32 count);
+	void DestroyBodies();
+};
+
+FPortalTraversalBenchmark::FPortalTraversalBenchmark(UWorld* inWorld, const TArray<int32>& inBodyCounts)
+	:world{ inWorld }, bodyCounts{ inBodyCounts }, bodyMesh{ nullptr }, random{ 0x54524156 }, currentRun{ 0 }, currentFrame{ 0 },
+	totalSeconds{ 0.0 }, maxSeconds{ 0.0 }, totalCandidates{ 0 }, totalTraversals{ 0 }
+{
+	//Split screen players' copies don't teleport anything, bodies flying into them would never be traversal candidates
+	for (TActorIterator<APortalVR> portalIterator{ inWorld }; portalIterator; ++portalIterator)
+	{
+		if (!portalIterator->IsViewerCopy())
+		{
+			portals.Add(*portalIterator);
+		}
+	}
+
+	bodyMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (portals.Num() == 0 || !bodyMesh)
+	{
+		UE_LOG(LogPortalTraversal, Warning, TEXT("Portal traversal benchmark needs a level with portals"));
+		Complete(false);
+		return;
+	}
+
+	UE_LOG(LogPortalTraversal, Display, TEXT("Portal traversal benchmark, %d portals, %d frames per body count"), portals.Num(), MeasuredFrames);
+	StartRun();
+	StartTicking();
+}
+
+FPortalTraversalBenchmark::~FPortalTraversalBenchmark()
+{
+	DestroyBodies();
+}
+
+bool FPortalTraversalBenchmark::Tick(float deltaTime)
+{
+	UPortalManagerSubsystem* portalManager{ world.IsValid() ? world->GetSubsystem<UPortalManagerSubsystem>() : nullptr };
+	if (!portalManager)
+	{
+		Complete(false);
+		return false;
+	}
+
+	//The core ticker runs once per engine frame after the world ticked, so this reads the traversal update of the frame that just finished
+	const double seconds{ portalManager->GetLastTraversalSeconds() };
+	totalSeconds += seconds;
+	maxSeconds = FMath::Max(maxSeconds, seconds);
+	totalCandidates += portalManager->GetLastTraversalCandidateCount();
+	totalTraversals += portalManager->GetLastTraversalCount();
+
+	if (++currentFrame < MeasuredFrames)
+	{
+		return true;
+	}
+
+	FinishRun();
+	if (++currentRun < bodyCounts.Num())
+	{
+		StartRun();
+		return true;
+	}
+
+	DestroyBodies();
+	Complete(true);
+	return false;
+}
+
+void FPortalTraversalBenchmark::StartRun()
+{
+	DestroyBodies();
+	SpawnBodies(bodyCounts[currentRun]);
+
+	currentFrame = 0;
+	totalSeconds = 0.0;
+	maxSeconds = 0.0;
+	totalCandidates = 0;
+	totalTraversals = 0;
+}
+
+void FPortalTraversalBenchmark::FinishRun()
+{
+	const double averageCandidates{ static_cast<double>(totalCandidates) / MeasuredFrames };
+	const double averageMs{ totalSeconds * 1000.0 / MeasuredFrames };
+	const double microsecondsPerCandidate{ totalCandidates > 0 ? totalSeconds * 1000000.0 / totalCandidates : 0.0 };
+	UE_LOG(LogPortalTraversal, Display, TEXT("%5d bodies: %8.1f candidates/frame, %7.3f ms/frame avg, %7.3f ms max, %6.3f us/candidate, %d traversals"),
+		bodyCounts[currentRun], averageCandidates, averageMs, maxSeconds * 1000.0, microsecondsPerCandidate, totalTraversals);
+}
+
+void FPortalTraversalBenchmark::SpawnBodies(int32 count)
+{
+	if (!world.IsValid())
+	{
+		return;
+	}
+
+	//Portals destroyed since the benchmark started (streamed out or removed by gameplay) are skipped, the bodies go to the remaining ones
+	TArray<const APortalVR*> validPortals;
+	for (const TWeakObjectPtr<APortalVR>& portal : portals)
+	{
+		if (portal.IsValid())
+		{
+			validPortals.Add(portal.Get());
+		}
+	}
+	if (validPortals.Num() == 0)
+	{
+		UE_LOG(LogPortalTraversal, Warning, TEXT("The level's portals are gone, no bodies spawned"));
+		return;
+	}
+
+	FActorSpawnParameters spawnParameters;
+	spawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 index = 0; index < count; ++index)
+	{
+		//Bodies are spread over the portals' surfaces in front of them and fly straight in, without gravity so they don't drop out of the traversal box
+		const FPortalRect portalRect{ validPortals[index % validPortals.Num()]->GetPortalRect() };
+		const FVector location{ portalRect.origin + portalRect.normal * random.FRandRange(20.0f, 90.0f)
+			+ portalRect.right * random.FRandRange(-0.8f, 0.8f) * portalRect.halfExtents.X
+			+ portalRect.up * random.FRandRange(-0.8f, 0.8f) * portalRect.halfExtents.Y };
+
+		AStaticMeshActor* body{ world->SpawnActor<AStaticMeshActor>(location, FRotator{ random.FRandRange(-180.0f, 180.0f), random.FRandRange(-180.0f, 180.0f), 0.0f }, spawnParameters) };
+		if (!body)
+		{
+			continue;
+		}
+
+		UStaticMeshComponent* bodyComponent{ body->GetStaticMeshComponent() };
+		body->SetMobility(EComponentMobility::Movable);
+		bodyComponent->SetStaticMesh(bodyMesh);
+		bodyComponent->SetWorldScale3D(FVector{ 0.1f });
+		bodyComponent->SetCollisionProfileName(TEXT("PhysicsActor"));
+		//The bodies only have to reach the portals' traversal boxes, collisions between hundreds of them would only measure the physics engine
+		bodyComponent->SetCollisionResponseToChannel(ECC_PhysicsBody, ECR_Ignore);
+		bodyComponent->SetCollisionResponseToChannel(ECC_PortalBox, ECR_Overlap);
+		bodyComponent->SetGenerateOverlapEvents(true);
+		bodyComponent->SetSimulatePhysics(true);
+		bodyComponent->SetEnableGravity(false);
+		bodyComponent->SetPhysicsLinearVelocity(-portalRect.normal * random.FRandRange(100.0f, 400.0f));
+		bodyComponent->SetPhysicsAngularVelocityInDegrees(random.GetUnitVector() * 180.0f);
+		bodies.Add(body);
+	}
+}
+
+void FPortalTraversalBenchmark::DestroyBodies()
+{
+	for (const TWeakObjectPtr<AStaticMeshActor>& body : bodies)
+	{
+		if (body.IsValid())
+		{
+			body->Destroy();
+		}
+	}
+	bodies.Reset();
+}
+
+static FPortalBenchmarkCommand PortalTraversalBenchmarkCommand(
+	TEXT("Portal.Bench.Traversal"),
+	TEXT("Spawns physics bodies flying into the level's portals and reports the cost of the traversal update for each body count. Usage: Portal.Bench.Traversal [bodies...]"),
+	[](const TArray<FString>& args, UWorld* world)
+	{
+		TArray<int32> bodyCounts;
+		for (const FString& arg : args)
+		{
+			bodyCounts.Add(FMath::Max(FCString::Atoi(*arg), 1));
+		}
+		if (bodyCounts.Num() == 0)
+		{
+			bodyCounts = { 50, 100, 200, 400, 800 };
+		}
+		return MakeUnique<FPortalTraversalBenchmark>(world, bodyCounts);
+	});
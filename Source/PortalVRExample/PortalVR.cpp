@@ -1,12 +1,15 @@
 #include "PortalVR.h"
 #include "PortalCharacter.h"
+#include "PortalManagerSubsystem.h"
+#include "PortalRenderTargetPool.h"
+#include "PortalStats.h"
 
 #include "Camera/CameraComponent.h"
 #include "Components/BoxComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/SceneCaptureComponent2D.h"
-#include "Engine/CanvasRenderTarget2D.h"
-#include "Engine/LocalPlayer.h"
+#include "HAL/IConsoleManager.h"
+#include "ConvexVolume.h"
 #include "GameFramework/Character.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "HelperMacros.h"
@@ -14,16 +17,64 @@
 #include "Kismet/KismetMathLibrary.h"
 #include "Kismet/KismetRenderingLibrary.h"
 #include "Materials/MaterialInstanceDynamic.h"
+#include "Misc/App.h"
+#include "RHI.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortal, Log, All);
+
+static TAutoConsoleVariable<int32> CVarPortalScissorHysteresis(
+	TEXT("r.Portal.ScissorHysteresisFrames"),
+	30,
+	TEXT("Number of consecutive frames a portal's scissor rect has to be smaller before its render targets shrink to match it."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPortalRecursionResolutionScale(
+	TEXT("r.Portal.RecursionResolutionScale"),
+	0.5f,
+	TEXT("Resolution of a nested portal capture relative to the pixels the portal covers in the capture it is seen through, applied again at every recursion level."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPortalLODMaxTier(
+	TEXT("r.Portal.LODMaxTier"),
+	2,
+	TEXT("Cheapest LOD tier portals may drop to.\n")
+	TEXT(" 0: every portal renders at full quality\n")
+	TEXT(" 1: distant portals render without dynamic shadows, translucency and expensive post processing\n")
+	TEXT(" 2: the most distant portals show a snapshot that is only refreshed every few seconds (default)"),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPortalLODDistanceScale(
+	TEXT("r.Portal.LODDistanceScale"),
+	1.0f,
+	TEXT("Scales the distances at which portals drop to their mid and far LOD tiers, lower values make portals cheaper sooner."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPortalLODHysteresis(
+	TEXT("r.Portal.LODHysteresis"),
+	0.1f,
+	TEXT("Fraction by which a portal has to cross an LOD tier's distance or screen coverage threshold before it changes tier."),
+	ECVF_Default);
+
+//Named parameters of M_PortalVR, set instead of the custom primitive data until the material reads that (see APortalVR::bMaterialUsesCustomPrimitiveData)
+static const FName ScaleOffsetParameter{ TEXT("ScaleOffset") };
+static const FName SharedStereoCaptureParameter{ TEXT("SharedStereoCapture") };
+static const FName LeftEyeUVScaleBiasParameter{ TEXT("LeftEyeUVScaleBias") };
+static const FName RightEyeUVScaleBiasParameter{ TEXT("RightEyeUVScaleBias") };
+static const FName LeftEyeReprojectionParameters[]{ TEXT("LeftEyeReprojectionU"), TEXT("LeftEyeReprojectionV"), TEXT("LeftEyeReprojectionW") };
+static const FName RightEyeReprojectionParameters[]{ TEXT("RightEyeReprojectionU"), TEXT("RightEyeReprojectionV"), TEXT("RightEyeReprojectionW") };
 
 APortalVR::APortalVR()
-	:prevCameraLocation{ 0 }, captureCameraClippingPlaneOffset{ -10.0f }
+	:netId{ 0 }, viewerIndex{ 0 }, viewerSource{ nullptr }, viewportSize{ ForceInit }, prevCameraLocation{ 0 }, bCameraCrossed{ false }, captureCameraClippingPlaneOffset{ -10.0f }, occlusionCullingTolerance{ 0.1f }, bWasInFrustumLastFrame{ false },
+	resolutionBucket{ 0 }, allocatedResolutionBucket{ 0 }, pendingResolutionFrames{ 0 }, budgetResolutionBucket{ 0 }, screenCoverage{ 0.0f }, cameraDistance{ 0.0f }, portalViewSeconds{ 0.0 }, portalSubmitSeconds{ 0.0 },
+	leftScissorRect{ ForceInit }, rightScissorRect{ ForceInit }, leftScissorShrinkFrames{ 0 }, rightScissorShrinkFrames{ 0 }, bScissorRectChanged{ false },
+	portalMeshHalfExtents{ ForceInitToZero }, portalThroughMatrix{ FMatrix::Identity }, bThroughMatrixDirty{ true },
+	captureLocation{ ForceInitToZero }, captureRotation{ ForceInitToZero }, captureClipPlaneBase{ ForceInitToZero }, captureClipPlaneNormal{ ForceInitToZero },
+	bCaptureObliqueNearPlane{ false }, bCapturePrepared{ false }, bCaptureScheduled{ false }, framesSinceCapture{ 0 }, refreshInterval{ 1 }, refreshPhase{ 0 },
+	capturedLocation{ ForceInitToZero }, capturedRotation{ ForceInit }, capturedTime{ 0.0f },
+	visibilityIndex{ INDEX_NONE }, displayedLeftTarget{ nullptr }, displayedRightTarget{ nullptr }, bMaterialHasUVScaleBias{ false }, bMaterialHasReprojection{ false }, lodTier{ EPortalLODTier::Near }, appliedLODTier{ EPortalLODTier::Near }, nearShowFlags{ ESFIM_Game }, nearLODDistanceFactor{ 3.0f }, nestedBufferIndices{ 0 }
 {
+	//Portals don't tick themselves, the portal manager ticks all of them at once
 	PrimaryActorTick.bCanEverTick = false;
-	PrimaryActorTick.TickGroup = ETickingGroup::TG_PostUpdateWork;
-
-	secondaryPostPhysicsTick.bCanEverTick = false;
-	secondaryPostPhysicsTick.refPortal = this;
-	secondaryPostPhysicsTick.TickGroup = TG_PostPhysics;
 
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("DefaultSceneComponent"));
 	RootComponent->Mobility = EComponentMobility::Static;
@@ -34,6 +85,13 @@ APortalVR::APortalVR()
 	portalMesh->CastShadow = false;
 	portalMesh->SetupAttachment(RootComponent);
 
+	//Placed around the portal mesh's surface on Init()
+	portalBox = CreateDefaultSubobject<UBoxComponent>(TEXT("PortalBox"));
+	portalBox->SetCollisionProfileName(TEXT("Portal"));
+	portalBox->SetGenerateOverlapEvents(true);
+	portalBox->SetCanEverAffectNavigation(false);
+	portalBox->SetupAttachment(RootComponent);
+
 	//Scene capture component for left eye
 	portalLeftCapture = CreateDefaultSubobject<USceneCaptureComponent2D>(TEXT("PortalLeftCapture"));
 	portalLeftCapture->bEnableClipPlane = true;
@@ -64,6 +122,26 @@ APortalVR::APortalVR()
 
 	//Default resolution for the portal texture is max resolution for most immersion
 	resolutionScale = 1.0f;
+
+	captureMode = EPortalCaptureMode::PerEye;
+
+	bUseLowPrecisionRenderTargets = false;
+
+	//Needs the per eye UV scale and bias in the material, which M_PortalVR doesn't apply yet
+	bScissorCapture = false;
+
+	bUseObliqueNearPlane = true;
+
+	bMaterialUsesCustomPrimitiveData = false;
+
+	traversalBoxDepth = 100.0f;
+
+	midTierDistance = 1500.0f;
+	farTierDistance = 5000.0f;
+	nearTierMinScreenCoverage = 0.1f;
+	farTierMaxScreenCoverage = 0.01f;
+	midTierLODDistanceFactor = 6.0f;
+	farTierRefreshSeconds = 2.0f;
 }
 
 void APortalVR::BeginPlay()
@@ -73,19 +151,85 @@ void APortalVR::BeginPlay()
 	Init();
 }
 
+void APortalVR::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (portalManager)
+	{
+		portalManager->UnregisterPortal(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void APortalVR::Init()
 {
-	portalPlayerController = GetWorld()->GetFirstPlayerController();
-	portalPlayerLocal = portalPlayerController->GetLocalPlayer();
-	portalPlayerCharacter = Cast<APortalCharacter>(portalPlayerController->GetCharacter());
+	/*
+	 * Registering starts ticking the portal through the portal manager, it is done before the connection check so that the EndPlay() of a destroyed portal unregisters it again.
+	 * The manager looks up the local viewer for all portals, which a client may not have yet and a dedicated server never has
+	 */
+	portalManager = GetWorld()->GetSubsystem<UPortalManagerSubsystem>();
+	portalManager->RegisterPortal(this);
+
+	//The near tier renders with the captures' settings as they were set up, the cheaper tiers start from these
+	nearShowFlags = portalLeftCapture->ShowFlags;
+	nearLODDistanceFactor = portalLeftCapture->LODDistanceFactor;
+
+	//A split screen player's copy starts out as its level portal is now, with the captures set up for that portal's tier and pointing at its render targets
+	if (viewerSource)
+	{
+		nearShowFlags = viewerSource->nearShowFlags;
+		nearLODDistanceFactor = viewerSource->nearLODDistanceFactor;
+		ApplyLODTier(EPortalLODTier::Near);
+		for (USceneCaptureComponent2D* capture : { portalLeftCapture, portalRightCapture })
+		{
+			if (capture)
+			{
+				capture->TextureTarget = nullptr;
+			}
+		}
 
-	portalLeftCapture->PostProcessSettings = portalPlayerCharacter->Camera->PostProcessSettings;
-	portalRightCapture->PostProcessSettings = portalPlayerCharacter->Camera->PostProcessSettings;
+		//Only the level portal is hit by traces and teleports, the copy follows it around
+		SetActorEnableCollision(false);
+		AttachToActor(viewerSource, FAttachmentTransformRules::KeepWorldTransform);
+	}
 
+	//The capture setup below depends on what the material supports
 	CreatePortalTexturesAndMaterial();
 
-	//Asserting these here as these should never be missing/null before starting tick
-	check(portalPlayerController && portalPlayerLocal && portalPlayerCharacter && renderLeftTarget && renderRightTarget && portalMaterial);
+	//Low precision render targets have no room for depth in alpha
+	if (bUseLowPrecisionRenderTargets)
+	{
+		portalLeftCapture->CaptureSource = ESceneCaptureSource::SCS_SceneColorHDRNoAlpha;
+		portalRightCapture->CaptureSource = ESceneCaptureSource::SCS_SceneColorHDRNoAlpha;
+	}
+
+	//The shared stereo capture renders both eyes through the left capture, so the right capture is not needed at all. A copy of a shared stereo portal may not have it anymore
+	if (captureMode == EPortalCaptureMode::SharedStereo && portalRightCapture)
+	{
+		portalRightCapture->DestroyComponent();
+		portalRightCapture = nullptr;
+	}
+
+	OnViewerChanged();
+
+	//The portal mesh's size never changes at runtime, so we only read it from the static mesh once
+	const FBox portalMeshBounds{ portalMesh->GetStaticMesh()->GetBoundingBox() };
+	portalMeshHalfExtents = FVector2D{ portalMeshBounds.Max.Y, portalMeshBounds.Max.Z };
+
+	//The traversal box covers the portal mesh's surface, its depth is in world units no matter how thin the mesh is scaled
+	const FVector portalMeshScale{ portalMesh->GetRelativeScale3D() };
+	portalBox->SetRelativeLocationAndRotation(portalMesh->GetRelativeLocation(), portalMesh->GetRelativeRotation());
+	portalBox->SetBoxExtent(FVector{ traversalBoxDepth, portalMeshHalfExtents.X * portalMeshScale.Y, portalMeshHalfExtents.Y * portalMeshScale.Z });
+
+	//Moving either portal invalidates the cached through matrix
+	GetRootComponent()->TransformUpdated.AddUObject(this, &APortalVR::OnPortalTransformUpdated);
+	if (portalTarget)
+	{
+		portalTarget->GetRootComponent()->TransformUpdated.AddUObject(this, &APortalVR::OnPortalTransformUpdated);
+	}
+
+	//Asserting these here as these should never be missing/null once the portal manager ticks the portal
+	check(portalManager && portalMaterial);
 
 	//Not the end of the world, but output a warning in logs when the portal is not connected to another portal and destroys the actor since we can't render anything to this portal without the other portal
 	if (ensureMsgf(!portalTarget, TEXT("Warning: Portal is not connected to another portal")))
@@ -93,81 +237,823 @@ void APortalVR::Init()
 		Destroy();
 	}
 
-	//Activate our primary tick and our secondary tick now that everything is ready
-	PrimaryActorTick.bCanEverTick = true;
-	secondaryPostPhysicsTick.bCanEverTick = true;
-	secondaryPostPhysicsTick.RegisterTickFunction(GetWorld()->PersistentLevel);
+	//Bodies can only go through connected portals. Bodies already inside the box when the game starts never send a begin overlap
+	if (portalTarget && !viewerSource)
+	{
+		portalBox->OnComponentBeginOverlap.AddDynamic(this, &APortalVR::OnPortalBoxBeginOverlap);
+		portalBox->OnComponentEndOverlap.AddDynamic(this, &APortalVR::OnPortalBoxEndOverlap);
+		TArray<UPrimitiveComponent*> overlappingComponents;
+		portalBox->GetOverlappingComponents(overlappingComponents);
+		for (UPrimitiveComponent* overlappingComponent : overlappingComponents)
+		{
+			if (IsTraversalCandidate(overlappingComponent->GetOwner(), overlappingComponent))
+			{
+				portalManager->AddTraversalCandidate(this, overlappingComponent);
+			}
+		}
+	}
 }
 
-//Remember that this is called because we overrided FActorTickFunction's tick. We can call APortalVR's private member function UpdateCharacterTracking() because FPostPhysicsTick is a friend of APortalVR
-void FPostPhysicsTick::ExecuteTick(float DeltaTime, enum ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+void APortalVR::PrepareCapture(const FPortalViewFrame& viewFrame, bool bForce)
 {
-	refPortal->UpdateCharacterTracking();
+	++framesSinceCapture;
+
+	//Forced captures skip the capture scheduler too, everything else is scheduled by the portal manager once all portals are prepared
+	bCaptureScheduled = bForce;
+
+	//Only render the portal when the player can actually see it, culled portals keep showing whatever their render targets last held
+	bCapturePrepared = bForce || ShouldCapturePortal(viewFrame);
+	if (!bCapturePrepared)
+	{
+		screenCoverage = 0.0f;
+		portalViewSeconds = 0.0;
+		return;
+	}
+
+	//Report how much of the screen we cover so the portal manager can pick our resolution for the next frames
+	screenCoverage = EstimateScreenCoverage(viewFrame);
+	cameraDistance = FVector::Distance(viewFrame.cameraLocation, portalMesh->GetComponentLocation());
+
+	lodTier = SelectLODTier(viewFrame);
+	switch (lodTier)
+	{
+	case EPortalLODTier::Near: INC_DWORD_STAT(STAT_PortalsLODNear); break;
+	case EPortalLODTier::Mid: INC_DWORD_STAT(STAT_PortalsLODMid); break;
+	default: INC_DWORD_STAT(STAT_PortalsLODFar); break;
+	}
+
+	//Projections and scissor rects decide how big the render targets have to be, so they are prepared before the capture is reserved
+	const double startTime{ FPlatformTime::Seconds() };
+	UpdateCaptureProjections(viewFrame);
+	UpdatePortalView(viewFrame);
+	portalViewSeconds = FPlatformTime::Seconds() - startTime;
 }
 
-//Note that the primary tick comes directly after the secondary tick in terms of order
-void APortalVR::Tick(float DeltaTime)
+void APortalVR::SubmitCapture(const FPortalViewFrame& viewFrame, bool bForce)
 {
-	Super::Tick(DeltaTime);
+	if (bCapturePrepared && !bCaptureScheduled)
+	{
+		//Keeps showing the previous capture, reprojected by the material. Far tier snapshots can go longer than the pool's idle time between refreshes, so the render targets are kept leased while they are shown
+		portalManager->GetRenderTargetPool()->TouchRenderTargets(this);
+		INC_DWORD_STAT_BY(STAT_PortalCapturesReused, GetCapturePassCount());
+	}
+	else if (bCapturePrepared && ApplyCaptureResolution(bForce))
+	{
+		INC_DWORD_STAT(STAT_PortalsCaptured);
+		framesSinceCapture = 0;
+		capturedLocation = captureLocation;
+		capturedRotation = captureRotation.Quaternion();
+		capturedTime = GetWorld()->GetTimeSeconds();
 
-	UpdatePortalView();
+		if (lodTier != appliedLODTier)
+		{
+			ApplyLODTier(lodTier);
+		}
+		if (lodTier == EPortalLODTier::Far)
+		{
+			INC_DWORD_STAT(STAT_PortalLODFarRefreshes);
+		}
 
-	//Don't apply offset to the portal material if the player is far from the portal. Note that the distance is determined by the width of the portal, factoring in scaling too
-	if (FVector::Distance(portalPlayerCharacter->Camera->GetComponentLocation(), portalMesh->GetComponentLocation()) < portalMesh->GetStaticMesh()->GetBoundingBox().Max.Y * portalMesh->GetComponentScale().Y)
-	{
-		portalMaterial->SetScalarParameterValue("ScaleOffset", 1.0f);
+		portalLeftCapture->bEnableClipPlane = !bCaptureObliqueNearPlane;
+		portalLeftCapture->ClipPlaneNormal = captureClipPlaneNormal;
+		portalLeftCapture->ClipPlaneBase = captureClipPlaneBase;
+		portalLeftCapture->SetWorldLocationAndRotation(captureLocation, captureRotation);
+
+		//we are overriding the camera capture projection with a custom one based on the player's viewport, see UpdateCaptureProjections()
+		portalLeftCapture->CustomProjectionMatrix = leftCaptureProjection;
+
+		//Shared stereo renders both eyes in a single pass through the left capture
+		if (captureMode == EPortalCaptureMode::SharedStereo)
+		{
+			PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalCaptureSceneLeft, CaptureSceneLeft);
+			portalLeftCapture->CaptureScene();
+		}
+		else
+		{
+			portalRightCapture->bEnableClipPlane = !bCaptureObliqueNearPlane;
+			portalRightCapture->ClipPlaneNormal = captureClipPlaneNormal;
+			portalRightCapture->ClipPlaneBase = captureClipPlaneBase;
+			portalRightCapture->SetWorldLocationAndRotation(captureLocation, captureRotation);
+			portalRightCapture->CustomProjectionMatrix = rightCaptureProjection;
+
+			{
+				PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalCaptureSceneLeft, CaptureSceneLeft);
+				portalLeftCapture->CaptureScene();
+			}
+			{
+				PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalCaptureSceneRight, CaptureSceneRight);
+				portalRightCapture->CaptureScene();
+			}
+		}
+
+		/*
+		 * The material switches to the new capture only after it was submitted, until then it may be shown in other captures or in this portal's own nested captures.
+		 * The material maps each eye's screen UV into the part of the render target that was captured for it.
+		 * The player's view of this portal maps onto the capture the same way the capture camera sees the exit portal, see UpdateCaptureProjections()
+		 */
+		capturedMaterialState.leftTarget = renderLeftTarget;
+		capturedMaterialState.rightTarget = captureMode == EPortalCaptureMode::SharedStereo ? renderLeftTarget : renderRightTarget;
+		capturedMaterialState.leftUVScaleBias = leftEyeUVScaleBias;
+		capturedMaterialState.rightUVScaleBias = rightEyeUVScaleBias;
+		const FMatrix cameraViewMatrix{ FTranslationMatrix{ -viewFrame.cameraLocation } * viewFrame.leftEye.ViewRotationMatrix };
+		ComputeReprojection(cameraViewMatrix * leftCaptureProjection, capturedMaterialState.leftReprojection);
+		ComputeReprojection(cameraViewMatrix * rightCaptureProjection, capturedMaterialState.rightReprojection);
+		ApplyMaterialState(capturedMaterialState);
 	}
 	else
 	{
-		portalMaterial->SetScalarParameterValue("ScaleOffset", 0.0f);
+		INC_DWORD_STAT_BY(STAT_PortalCapturesSkipped, GetCapturePassCount());
 	}
+
+	//Don't apply offset to the portal material if the player is far from the portal
+	SetMaterialScalar(ScaleOffsetParameter, CustomDataScaleOffset, IsLocationNearPortal(viewFrame.cameraLocation) ? 1.0f : 0.0f);
 }
 
 void APortalVR::CreatePortalTexturesAndMaterial()
 {
-	//we get the current viewport size here and multiply it by our scalar to determine our XY resolution for the portal texture
-	int viewportX, viewportY;
-	portalPlayerController->GetViewportSize(viewportX, viewportY);
-	viewportX *= resolutionScale;
-	viewportY *= resolutionScale;
-
-	renderLeftTarget = UCanvasRenderTarget2D::CreateCanvasRenderTarget2D(GetWorld(), UCanvasRenderTarget2D::StaticClass(), viewportX, viewportY);
-	renderRightTarget = UCanvasRenderTarget2D::CreateCanvasRenderTarget2D(GetWorld(), UCanvasRenderTarget2D::StaticClass(), viewportX, viewportY);
+	PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalCreateTexturesAndMaterial, CreatePortalTexturesAndMaterial);
 
-	//using a dynamic material instance so we can assign the instantiated render targets to the material's textures
+	//using a dynamic material instance so we can assign the leased render targets to the material's textures, everything else goes through the mesh's custom primitive data once the material reads it
 	portalMaterial = portalMesh->CreateDynamicMaterialInstance(0, portalMaterialInterface);
-	portalMaterial->SetTextureParameterValue("RT_LeftEye", renderLeftTarget);
-	portalMaterial->SetTextureParameterValue("RT_RightEye", renderRightTarget);
 
-	portalLeftCapture->TextureTarget = renderLeftTarget;
-	portalRightCapture->TextureTarget = renderRightTarget;
+	//Named parameters are looked up on the material, a material reading custom primitive data is expected to implement all of them
+	const UMaterialInterface* material{ portalMaterial };
+	float scalarValue;
+	FLinearColor vectorValue;
+	bMaterialHasUVScaleBias = bMaterialUsesCustomPrimitiveData
+		|| (material->GetScalarParameterValue(FMaterialParameterInfo{ SharedStereoCaptureParameter }, scalarValue)
+			&& material->GetVectorParameterValue(FMaterialParameterInfo{ LeftEyeUVScaleBiasParameter }, vectorValue)
+			&& material->GetVectorParameterValue(FMaterialParameterInfo{ RightEyeUVScaleBiasParameter }, vectorValue));
+	bMaterialHasReprojection = bMaterialUsesCustomPrimitiveData;
+	if (!bMaterialHasReprojection)
+	{
+		bMaterialHasReprojection = true;
+		for (int32 column = 0; column < UE_ARRAY_COUNT(LeftEyeReprojectionParameters); ++column)
+		{
+			bMaterialHasReprojection &= material->GetVectorParameterValue(FMaterialParameterInfo{ LeftEyeReprojectionParameters[column] }, vectorValue)
+				&& material->GetVectorParameterValue(FMaterialParameterInfo{ RightEyeReprojectionParameters[column] }, vectorValue);
+		}
+	}
+
+	//Without the UV scale and bias both eyes would sample the whole shared render target
+	if (captureMode == EPortalCaptureMode::SharedStereo && !bMaterialHasUVScaleBias)
+	{
+		UE_LOG(LogPortal, Warning, TEXT("%s captures per eye, its material %s doesn't implement SharedStereoCapture and the eyes' UV scale and bias"), *GetName(), *material->GetName());
+		captureMode = EPortalCaptureMode::PerEye;
+	}
+
+	//Same for the scissor rects, the eyes would sample the whole screen out of a render target holding only the portal's rect
+	if (bScissorCapture && !bMaterialHasUVScaleBias)
+	{
+		UE_LOG(LogPortal, Warning, TEXT("%s captures the whole view, its material %s doesn't implement the eyes' UV scale and bias the scissor capture needs"), *GetName(), *material->GetName());
+		bScissorCapture = false;
+	}
+
+	//In shared stereo both eyes sample the same texture, the per eye UV scale and bias set in UpdateCaptureProjections() selects each eye's region
+	SetMaterialScalar(SharedStereoCaptureParameter, CustomDataSharedStereoCapture, captureMode == EPortalCaptureMode::SharedStereo ? 1.0f : 0.0f);
 }
 
-void APortalVR::UpdatePortalView()
+void APortalVR::UpdatePortalView(const FPortalViewFrame& viewFrame)
 {
-	//we enabled and update a clip plane for our cameras so that objects/walls won't be rendered between the cameras and the portal
-	portalLeftCapture->ClipPlaneNormal = portalTarget->GetActorForwardVector();
-	portalLeftCapture->ClipPlaneBase = portalTarget->GetActorLocation() + portalLeftCapture->ClipPlaneNormal * captureCameraClippingPlaneOffset;
-	portalRightCapture->ClipPlaneNormal = portalTarget->GetActorForwardVector();
-	portalRightCapture->ClipPlaneBase = portalTarget->GetActorLocation() + portalRightCapture->ClipPlaneNormal * captureCameraClippingPlaneOffset;
-
-	//we are overriding the camera capture projection with a custom one based on the player's viewport
-	FMatrix projectionMatrix;
-	FSceneViewProjectionData projectionData;
-	portalPlayerLocal->GetProjectionData(portalPlayerLocal->ViewportClient->Viewport, EStereoscopicPass::eSSP_RIGHT_EYE, projectionData);
-	portalRightCapture->CustomProjectionMatrix = projectionData.ProjectionMatrix;
-	portalPlayerLocal->GetProjectionData(portalPlayerLocal->ViewportClient->Viewport, EStereoscopicPass::eSSP_LEFT_EYE, projectionData);
-	portalLeftCapture->CustomProjectionMatrix = projectionData.ProjectionMatrix;
+	PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalUpdateView, UpdatePortalView);
 
 	//Move and rotate the cameras so that they match the player's perspective through the exit/target portal
-	FVector newCameraLocation;
-	FRotator newCameraRotation;
-	ConvertLocationRotationToPortal(newCameraLocation, newCameraRotation, portalPlayerCharacter->Camera->GetComponentTransform());
-	portalLeftCapture->SetWorldLocationAndRotation(newCameraLocation, newCameraRotation);
-	portalRightCapture->SetWorldLocationAndRotation(newCameraLocation, newCameraRotation);
+	ConvertLocationRotationToPortal(captureLocation, captureRotation, viewFrame.cameraTransform);
+
+	//Objects/walls between the cameras and the exit portal must not be rendered, everything behind this plane is cut away
+	captureClipPlaneNormal = portalTarget->GetActorForwardVector();
+	captureClipPlaneBase = portalTarget->GetActorLocation() + captureClipPlaneNormal * captureCameraClippingPlaneOffset;
+
+	/*
+	 * Preferably the plane is baked into the projection as an oblique near plane, so geometry behind the exit portal is removed by the regular near plane clipping and culling.
+	 * At degenerate angles that isn't possible, so we fall back to the engine's global clip plane for that frame
+	 */
+	bCaptureObliqueNearPlane = false;
+	if (!bUseObliqueNearPlane)
+	{
+		return;
+	}
 
+	const FMatrix captureViewMatrix{ CaptureViewMatrix(captureLocation, captureRotation) };
+
+	FMatrix leftProjection;
+	FMatrix rightProjection;
+	bCaptureObliqueNearPlane = FPortalMath::MakeObliqueProjection(leftCaptureProjection, captureViewMatrix, captureClipPlaneBase, captureClipPlaneNormal, leftProjection);
+	if (captureMode == EPortalCaptureMode::SharedStereo)
+	{
+		rightProjection = leftProjection;
+	}
+	else if (bCaptureObliqueNearPlane)
+	{
+		bCaptureObliqueNearPlane = FPortalMath::MakeObliqueProjection(rightCaptureProjection, captureViewMatrix, captureClipPlaneBase, captureClipPlaneNormal, rightProjection);
+	}
+
+	if (bCaptureObliqueNearPlane)
+	{
+		leftCaptureProjection = leftProjection;
+		rightCaptureProjection = rightProjection;
+	}
+}
+
+FMatrix APortalVR::CaptureViewMatrix(const FVector& location, const FRotator& rotation)
+{
+	return FTranslationMatrix{ -location } * FPortalMath::MakeViewRotationMatrix(rotation);
+}
+
+void APortalVR::ComputeReprojection(const FMatrix& worldToCaptureClip, FLinearColor (&reprojection)[3])
+{
+	/*
+	 * With p = (worldPosition, 1) the clip position is p * M, so clip X, Y and W are dot products of p with the matrix' columns.
+	 * NDC to UV (V flipped) is folded into the columns, so the material computes "uv = float2(dot(p, U), dot(p, V)) / dot(p, W)".
+	 * The oblique near plane only changes the Z column, which isn't needed
+	 */
+	const FLinearColor columnX{ worldToCaptureClip.M[0][0], worldToCaptureClip.M[1][0], worldToCaptureClip.M[2][0], worldToCaptureClip.M[3][0] };
+	const FLinearColor columnY{ worldToCaptureClip.M[0][1], worldToCaptureClip.M[1][1], worldToCaptureClip.M[2][1], worldToCaptureClip.M[3][1] };
+	const FLinearColor columnW{ worldToCaptureClip.M[0][3], worldToCaptureClip.M[1][3], worldToCaptureClip.M[2][3], worldToCaptureClip.M[3][3] };
+	reprojection[0] = (columnX + columnW) * 0.5f;
+	reprojection[1] = (columnW - columnY) * 0.5f;
+	reprojection[2] = columnW;
+}
+
+void APortalVR::ApplyMaterialState(const FPortalMaterialState& materialState)
+{
+	//Texture parameters need the dynamic material instance, so they are only touched when the render targets actually change
+	if (materialState.leftTarget != displayedLeftTarget)
+	{
+		displayedLeftTarget = materialState.leftTarget;
+		portalMaterial->SetTextureParameterValue("RT_LeftEye", displayedLeftTarget);
+	}
+	if (materialState.rightTarget != displayedRightTarget)
+	{
+		displayedRightTarget = materialState.rightTarget;
+		portalMaterial->SetTextureParameterValue("RT_RightEye", displayedRightTarget);
+	}
+
+	SetMaterialVector(LeftEyeUVScaleBiasParameter, CustomDataLeftEyeUVScaleBias, materialState.leftUVScaleBias);
+	SetMaterialVector(RightEyeUVScaleBiasParameter, CustomDataRightEyeUVScaleBias, materialState.rightUVScaleBias);
+	for (int32 column = 0; column < 3; ++column)
+	{
+		SetMaterialVector(LeftEyeReprojectionParameters[column], CustomDataLeftEyeReprojection + column * 4, materialState.leftReprojection[column]);
+		SetMaterialVector(RightEyeReprojectionParameters[column], CustomDataRightEyeReprojection + column * 4, materialState.rightReprojection[column]);
+	}
+}
+
+void APortalVR::SetMaterialScalar(FName parameterName, int32 dataIndex, float value)
+{
+	//The dynamic material instance already skips values that didn't change
+	if (!bMaterialUsesCustomPrimitiveData)
+	{
+		portalMaterial->SetScalarParameterValue(parameterName, value);
+		return;
+	}
+
+	//Every change is sent to the render thread, unchanged values are skipped
+	const TArray<float>& customData{ portalMesh->GetCustomPrimitiveData().Data };
+	if (customData.IsValidIndex(dataIndex) && customData[dataIndex] == value)
+	{
+		return;
+	}
+
+	portalMesh->SetCustomPrimitiveDataFloat(dataIndex, value);
+}
+
+void APortalVR::SetMaterialVector(FName parameterName, int32 dataIndex, const FLinearColor& value)
+{
+	if (!bMaterialUsesCustomPrimitiveData)
+	{
+		portalMaterial->SetVectorParameterValue(parameterName, value);
+		return;
+	}
+
+	const TArray<float>& customData{ portalMesh->GetCustomPrimitiveData().Data };
+	if (customData.IsValidIndex(dataIndex + 3) && customData[dataIndex] == value.R && customData[dataIndex + 1] == value.G && customData[dataIndex + 2] == value.B && customData[dataIndex + 3] == value.A)
+	{
+		return;
+	}
+
+	portalMesh->SetCustomPrimitiveDataVector4(dataIndex, FVector4{ value.R, value.G, value.B, value.A });
+}
+
+void APortalVR::GetRecursionView(const FPortalViewFrame& viewFrame, FPortalRecursionView& view) const
+{
+	view.portal = this;
+	view.viewerTransform = FTransform{ captureRotation, captureLocation };
+	view.viewerLocation = captureLocation;
+	view.viewMatrix = CaptureViewMatrix(captureLocation, captureRotation);
+
+	//Nested portals are captured once for both eyes, with the eye projection's regular depth mapping instead of this capture's oblique near plane so their projections and frustums start from a plain frustum
+	view.projection = captureMode == EPortalCaptureMode::SharedStereo ? leftCaptureProjection : UnionProjection(leftCaptureProjection, rightCaptureProjection);
+	for (int32 row = 0; row < 4; ++row)
+	{
+		view.projection.M[row][2] = viewFrame.leftEye.ProjectionMatrix.M[row][2];
+	}
+	GetViewFrustumBounds(view.frustum, view.viewMatrix * view.projection, false);
+
+	const FIntPoint leftSize{ GetCaptureSize(budgetResolutionBucket, 0) };
+	view.size = captureMode == EPortalCaptureMode::SharedStereo ? leftSize : leftSize.ComponentMax(GetCaptureSize(budgetResolutionBucket, 1));
+}
+
+bool APortalVR::CaptureNested(const FPortalRecursionView& parentView, int32 level, int32 maxDepth)
+{
+	//The parent's capture shows this portal's nested capture through the reprojection, without it the portal keeps its own capture like before recursion
+	if (!bMaterialHasReprojection)
+	{
+		return false;
+	}
+
+	//Same culling as for the player's view: never visible through the parent portal, facing away from the viewer, outside its frustum or not covering any of its pixels
+	if (!portalTarget || !portalManager->IsPotentiallyVisibleThrough(parentView.portal, this))
+	{
+		INC_DWORD_STAT(STAT_PortalsCulledPVS);
+		return false;
+	}
+
+	if (!WasActorInFrontOfPortal(parentView.viewerLocation))
+	{
+		return false;
+	}
+
+	const FBoxSphereBounds& bounds{ portalMesh->Bounds };
+	if (!parentView.frustum.IntersectBox(bounds.Origin, bounds.BoxExtent))
+	{
+		return false;
+	}
+
+	FBox2D projectedRect;
+	ProjectPortalBounds(parentView.viewMatrix * parentView.projection, projectedRect);
+	if (projectedRect.Max.X <= projectedRect.Min.X || projectedRect.Max.Y <= projectedRect.Min.Y)
+	{
+		return false;
+	}
+
+	//Sized to the pixels the portal covers in the parent's render target, scaled down again and rounded up to multiples of 32 so the pool can reuse the render targets between frames
+	const FBox2D levelRect{ SnapToScissorGrid(projectedRect) };
+	const float resolutionFraction{ CVarPortalRecursionResolutionScale.GetValueOnGameThread() };
+	const FVector2D levelSize{ FVector2D{ parentView.size } * levelRect.GetSize() * 0.5f * resolutionFraction };
+	const FIntPoint levelTargetSize{ FMath::Max(FMath::DivideAndRoundUp(FMath::CeilToInt(levelSize.X), 32) * 32, 32), FMath::Max(FMath::DivideAndRoundUp(FMath::CeilToInt(levelSize.Y), 32) * 32, 32) };
+
+	/*
+	 * Past the maximum depth or out of budget (nested captures, capture passes or captured pixels) the portal shows the last texture it was captured into at this level
+	 * or the deepest one above it, reprojected like a skipped capture. That texture is from an earlier capture (usually the previous frame), so this also ends the recursion of a portal that sees itself
+	 */
+	if (!portalManager->ReserveRecursiveCapture(level, maxDepth, levelTargetSize))
+	{
+		INC_DWORD_STAT(STAT_PortalRecursionFallbacks);
+		for (int32 index = FMath::Min(level, maxDepth) - 1; index >= 0; --index)
+		{
+			if (nestedMaterialStates[index].leftTarget)
+			{
+				ApplyMaterialState(nestedMaterialStates[index]);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//Inclusive of the deeper levels, which are captured first
+	FScopeCycleCounter levelCycleCounter{ level == 1 ? GET_STATID(STAT_PortalRecursionLevel1) : level == 2 ? GET_STATID(STAT_PortalRecursionLevel2) : GET_STATID(STAT_PortalRecursionLevel3) };
+	switch (level)
+	{
+	case 1: INC_DWORD_STAT(STAT_PortalRecursiveCapturesLevel1); break;
+	case 2: INC_DWORD_STAT(STAT_PortalRecursiveCapturesLevel2); break;
+	default: INC_DWORD_STAT(STAT_PortalRecursiveCapturesLevel3); break;
+	}
+
+	//The parent's camera taken through this portal, rendering only the rect the portal covers in the parent's view
+	FVector levelLocation;
+	FRotator levelRotation;
+	ConvertLocationRotationToPortal(levelLocation, levelRotation, parentView.viewerTransform);
+
+	FPortalRecursionView levelView;
+	levelView.portal = this;
+	levelView.viewerTransform = FTransform{ levelRotation, levelLocation };
+	levelView.viewerLocation = levelLocation;
+	levelView.viewMatrix = CaptureViewMatrix(levelLocation, levelRotation);
+	levelView.projection = ScissorProjection(parentView.projection, levelRect);
+	GetViewFrustumBounds(levelView.frustum, levelView.viewMatrix * levelView.projection, false);
+	levelView.size = levelTargetSize;
+
+	const int32 levelIndex{ level - 1 };
+	const int32 bufferIndex{ 1 - nestedBufferIndices[levelIndex] };
+	UTextureRenderTarget2D* nestedTarget{ portalManager->GetRenderTargetPool()->AcquireRenderTarget(this, NestedCaptureSlot + levelIndex * 2 + bufferIndex, levelView.size, GetRenderTargetFormat()) };
+	if (!nestedTarget)
+	{
+		portalManager->ReleaseRecursiveCapture(levelView.size);
+		return false;
+	}
+
+	//Portals seen through this one are captured first and point their materials at their nested captures while this one renders
+	TArray<APortalVR*> nestedPortals;
+	portalManager->CaptureNestedPortals(levelView, level + 1, nestedPortals);
+
+	const FVector clipPlaneNormal{ portalTarget->GetActorForwardVector() };
+	const FVector clipPlaneBase{ portalTarget->GetActorLocation() + clipPlaneNormal * captureCameraClippingPlaneOffset };
+	FMatrix levelProjection{ levelView.projection };
+	const bool bObliqueNearPlane{ bUseObliqueNearPlane && FPortalMath::MakeObliqueProjection(levelView.projection, levelView.viewMatrix, clipPlaneBase, clipPlaneNormal, levelProjection) };
+
+	//The left capture is borrowed for the nested capture, SubmitCapture() sets everything again before the portal's own capture
+	portalLeftCapture->TextureTarget = nestedTarget;
+	portalLeftCapture->bEnableClipPlane = !bObliqueNearPlane;
+	portalLeftCapture->ClipPlaneNormal = clipPlaneNormal;
+	portalLeftCapture->ClipPlaneBase = clipPlaneBase;
+	portalLeftCapture->SetWorldLocationAndRotation(levelLocation, levelRotation);
+	portalLeftCapture->CustomProjectionMatrix = levelProjection;
 	portalLeftCapture->CaptureScene();
-	portalRightCapture->CaptureScene();
+	portalLeftCapture->TextureTarget = renderLeftTarget;
+
+	for (APortalVR* nestedPortal : nestedPortals)
+	{
+		nestedPortal->ApplyMaterialState(nestedPortal->capturedMaterialState);
+	}
+
+	//Both eyes of the parent's capture see this portal from the same camera, so they share the nested capture and its reprojection
+	FPortalMaterialState& nestedState{ nestedMaterialStates[levelIndex] };
+	nestedState.leftTarget = nestedTarget;
+	nestedState.rightTarget = nestedTarget;
+	nestedState.leftUVScaleBias = FLinearColor{ 1.0f, 1.0f, 0.0f, 0.0f };
+	nestedState.rightUVScaleBias = FLinearColor{ 1.0f, 1.0f, 0.0f, 0.0f };
+	ComputeReprojection(parentView.viewMatrix * levelProjection, nestedState.leftReprojection);
+	FMemory::Memcpy(nestedState.rightReprojection, nestedState.leftReprojection, sizeof(nestedState.rightReprojection));
+	nestedBufferIndices[levelIndex] = bufferIndex;
+
+	ApplyMaterialState(nestedState);
+	return true;
+}
+
+bool APortalVR::NeedsCapture() const
+{
+	/*
+	 * Render targets revoked by the pool, or render targets that no longer match the scissor rects.
+	 * A far tier snapshot is reprojected onto the portal's surface, which it covered when it was captured, so it stays valid until its next refresh even if the rects changed
+	 */
+	return !renderLeftTarget || (captureMode != EPortalCaptureMode::SharedStereo && !renderRightTarget) || (bScissorRectChanged && lodTier != EPortalLODTier::Far);
+}
+
+EPortalLODTier APortalVR::SelectLODTier(const FPortalViewFrame& viewFrame) const
+{
+	const int32 maxTier{ CVarPortalLODMaxTier.GetValueOnAnyThread() };
+	if (maxTier <= 0 || IsLocationNearPortal(viewFrame.cameraLocation))
+	{
+		return EPortalLODTier::Near;
+	}
+
+	//A value is past a threshold once it crossed it by the hysteresis margin, and stays past it until it crossed back by the same margin
+	const float hysteresis{ CVarPortalLODHysteresis.GetValueOnAnyThread() };
+	auto isBeyond = [hysteresis](float value, float threshold, bool bWasBeyond)
+	{
+		return value > threshold * (bWasBeyond ? 1.0f - hysteresis : 1.0f + hysteresis);
+	};
+
+	const float distanceScale{ CVarPortalLODDistanceScale.GetValueOnAnyThread() };
+	const bool bBeyondNear{ isBeyond(cameraDistance, midTierDistance * distanceScale, lodTier != EPortalLODTier::Near)
+		&& !isBeyond(screenCoverage, nearTierMinScreenCoverage, lodTier == EPortalLODTier::Near) };
+	if (!bBeyondNear)
+	{
+		return EPortalLODTier::Near;
+	}
+
+	//Far tier snapshots are reprojected onto the portal's surface between their refreshes, a material without the reprojection stays on the mid tier
+	const bool bBeyondMid{ maxTier >= 2 && bMaterialHasReprojection && isBeyond(cameraDistance, farTierDistance * distanceScale, lodTier == EPortalLODTier::Far)
+		&& !isBeyond(screenCoverage, farTierMaxScreenCoverage, lodTier != EPortalLODTier::Far) };
+	return bBeyondMid ? EPortalLODTier::Far : EPortalLODTier::Mid;
+}
+
+void APortalVR::ApplyLODTier(EPortalLODTier tier)
+{
+	//Far tier snapshots are captured with the mid tier's settings, they are small and only refreshed every few seconds anyway
+	FEngineShowFlags showFlags{ nearShowFlags };
+	const bool bNear{ tier == EPortalLODTier::Near };
+	if (!bNear)
+	{
+		showFlags.SetDynamicShadows(false);
+		showFlags.SetTranslucency(false);
+		showFlags.SetAmbientOcclusion(false);
+		showFlags.SetScreenSpaceReflections(false);
+		showFlags.SetBloom(false);
+		showFlags.SetLensFlares(false);
+		showFlags.SetMotionBlur(false);
+		showFlags.SetDepthOfField(false);
+	}
+
+	for (USceneCaptureComponent2D* capture : { portalLeftCapture, portalRightCapture })
+	{
+		if (capture)
+		{
+			capture->ShowFlags = showFlags;
+			capture->LODDistanceFactor = bNear ? nearLODDistanceFactor : midTierLODDistanceFactor;
+		}
+	}
+
+	appliedLODTier = tier;
+}
+
+void APortalVR::UpdateCaptureProjections(const FPortalViewFrame& viewFrame)
+{
+	const FMatrix& leftProjection{ viewFrame.leftEye.ProjectionMatrix };
+	const FMatrix& rightProjection{ viewFrame.rightEye.ProjectionMatrix };
+
+	//By default each eye samples its own full screen render target
+	leftCaptureProjection = leftProjection;
+	rightCaptureProjection = rightProjection;
+	leftEyeUVScaleBias = FLinearColor{ 1.0f, 1.0f, 0.0f, 0.0f };
+	rightEyeUVScaleBias = FLinearColor{ 1.0f, 1.0f, 0.0f, 0.0f };
+
+	if (captureMode == EPortalCaptureMode::SharedStereo)
+	{
+		/*
+		 * Both eye captures are placed at the same camera location with the same rotation and only differ by their (asymmetric) projections.
+		 * In view space a projection maps the tangent x/z to NDC as "ndc = M[0][0] * tangent + M[2][0]" (same for y with M[1][1] and M[2][1]).
+		 * So we can build a single projection whose tangent range is the union of both eyes and every eye's NDC maps linearly into it
+		 */
+		const FMatrix sharedProjection{ UnionProjection(leftProjection, rightProjection) };
+		leftCaptureProjection = sharedProjection;
+		rightCaptureProjection = sharedProjection;
+
+		/*
+		 * Per eye: sharedNDC = scale * eyeNDC + bias, where scale = shared M[0][0] / eye M[0][0] and bias = shared M[2][0] - scale * eye M[2][0].
+		 * Converted to texture UVs (V is flipped) the material can use "sharedUV = eyeUV * (ScaleX, ScaleY) + (BiasX, BiasY)"
+		 */
+		auto computeEyeUVScaleBias = [&sharedProjection](const FMatrix& eyeProjection)
+		{
+			const float scaleX{ sharedProjection.M[0][0] / eyeProjection.M[0][0] };
+			const float scaleY{ sharedProjection.M[1][1] / eyeProjection.M[1][1] };
+			const float biasX{ sharedProjection.M[2][0] - scaleX * eyeProjection.M[2][0] };
+			const float biasY{ sharedProjection.M[2][1] - scaleY * eyeProjection.M[2][1] };
+			return FLinearColor{ scaleX, scaleY, 0.5f * (1.0f - scaleX + biasX), 0.5f * (1.0f - scaleY - biasY) };
+		};
+		leftEyeUVScaleBias = computeEyeUVScaleBias(leftProjection);
+		rightEyeUVScaleBias = computeEyeUVScaleBias(rightProjection);
+	}
+
+	bScissorRectChanged = false;
+	if (!bScissorCapture)
+	{
+		leftScissorRect = FBox2D{ FVector2D{ -1.0f, -1.0f }, FVector2D{ 1.0f, 1.0f } };
+		rightScissorRect = leftScissorRect;
+		return;
+	}
+
+	/*
+	 * The capture cameras see the exit portal from the same place the player camera sees this portal, so projecting this portal's bounds from the player camera
+	 * with the capture's projection tells us which part of the capture is actually visible through the portal
+	 */
+	const FMatrix cameraViewMatrix{ FTranslationMatrix{ -viewFrame.cameraLocation } * viewFrame.leftEye.ViewRotationMatrix };
+
+	bScissorRectChanged |= UpdateScissorRect(leftScissorRect, leftScissorShrinkFrames, cameraViewMatrix * leftCaptureProjection);
+	leftCaptureProjection = ScissorProjection(leftCaptureProjection, leftScissorRect);
+	leftEyeUVScaleBias = ScissorUVScaleBias(leftEyeUVScaleBias, leftScissorRect);
+
+	if (captureMode == EPortalCaptureMode::SharedStereo)
+	{
+		//Both eyes sample the single shared render target so they share its scissor rect too
+		rightScissorRect = leftScissorRect;
+		rightCaptureProjection = leftCaptureProjection;
+		rightEyeUVScaleBias = ScissorUVScaleBias(rightEyeUVScaleBias, leftScissorRect);
+		return;
+	}
+
+	bScissorRectChanged |= UpdateScissorRect(rightScissorRect, rightScissorShrinkFrames, cameraViewMatrix * rightCaptureProjection);
+	rightCaptureProjection = ScissorProjection(rightCaptureProjection, rightScissorRect);
+	rightEyeUVScaleBias = ScissorUVScaleBias(rightEyeUVScaleBias, rightScissorRect);
+}
+
+FMatrix APortalVR::UnionProjection(const FMatrix& leftProjection, const FMatrix& rightProjection)
+{
+	const float minTangentX{ FMath::Min((-1.0f - leftProjection.M[2][0]) / leftProjection.M[0][0], (-1.0f - rightProjection.M[2][0]) / rightProjection.M[0][0]) };
+	const float maxTangentX{ FMath::Max((1.0f - leftProjection.M[2][0]) / leftProjection.M[0][0], (1.0f - rightProjection.M[2][0]) / rightProjection.M[0][0]) };
+	const float minTangentY{ FMath::Min((-1.0f - leftProjection.M[2][1]) / leftProjection.M[1][1], (-1.0f - rightProjection.M[2][1]) / rightProjection.M[1][1]) };
+	const float maxTangentY{ FMath::Max((1.0f - leftProjection.M[2][1]) / leftProjection.M[1][1], (1.0f - rightProjection.M[2][1]) / rightProjection.M[1][1]) };
+
+	//Keep the depth part (near plane, reversed Z) of the left projection and only replace the XY mapping
+	FMatrix unionProjection{ leftProjection };
+	unionProjection.M[0][0] = 2.0f / (maxTangentX - minTangentX);
+	unionProjection.M[2][0] = -(maxTangentX + minTangentX) / (maxTangentX - minTangentX);
+	unionProjection.M[1][1] = 2.0f / (maxTangentY - minTangentY);
+	unionProjection.M[2][1] = -(maxTangentY + minTangentY) / (maxTangentY - minTangentY);
+	return unionProjection;
+}
+
+bool APortalVR::ProjectPortalBounds(const FMatrix& viewProjectionMatrix, FBox2D& ndcRect) const
+{
+	FVector corners[8];
+	portalMesh->Bounds.GetBox().GetVertices(corners);
+
+	ndcRect.Init();
+	for (const FVector& corner : corners)
+	{
+		const FVector4 clipPosition{ viewProjectionMatrix.TransformFVector4(FVector4{ corner, 1.0f }) };
+
+		//A corner behind the eye means the portal wraps around the camera, so it can cover any part of the screen
+		if (clipPosition.W <= KINDA_SMALL_NUMBER)
+		{
+			ndcRect = FBox2D{ FVector2D{ -1.0f, -1.0f }, FVector2D{ 1.0f, 1.0f } };
+			return false;
+		}
+
+		ndcRect += FVector2D{ clipPosition.X / clipPosition.W, clipPosition.Y / clipPosition.W };
+	}
+
+	//Clamp to the screen, NDC spans 2 units on each axis
+	ndcRect.Min = FVector2D::Max(ndcRect.Min, FVector2D{ -1.0f, -1.0f });
+	ndcRect.Max = FVector2D::Min(ndcRect.Max, FVector2D{ 1.0f, 1.0f });
+	ndcRect.Max = FVector2D::Max(ndcRect.Max, ndcRect.Min);
+	return true;
+}
+
+FBox2D APortalVR::SnapToScissorGrid(const FBox2D& ndcRect)
+{
+	//Snap the rect outwards to a grid of 1/16th of the screen so the render target size only changes once the portal moved a noticeable amount
+	static constexpr float gridStep{ 2.0f / 16.0f };
+
+	FBox2D snappedRect{ ndcRect };
+	snappedRect.Min.X = FMath::Max(FMath::FloorToFloat((ndcRect.Min.X + 1.0f) / gridStep) * gridStep - 1.0f, -1.0f);
+	snappedRect.Min.Y = FMath::Max(FMath::FloorToFloat((ndcRect.Min.Y + 1.0f) / gridStep) * gridStep - 1.0f, -1.0f);
+	snappedRect.Max.X = FMath::Min(FMath::Max(FMath::CeilToFloat((ndcRect.Max.X + 1.0f) / gridStep) * gridStep - 1.0f, snappedRect.Min.X + gridStep), 1.0f);
+	snappedRect.Max.Y = FMath::Min(FMath::Max(FMath::CeilToFloat((ndcRect.Max.Y + 1.0f) / gridStep) * gridStep - 1.0f, snappedRect.Min.Y + gridStep), 1.0f);
+	return snappedRect;
+}
+
+bool APortalVR::UpdateScissorRect(FBox2D& scissorRect, int32& shrinkFrames, const FMatrix& viewProjectionMatrix)
+{
+	FBox2D projectedRect;
+	ProjectPortalBounds(viewProjectionMatrix, projectedRect);
+	const FBox2D requiredRect{ SnapToScissorGrid(projectedRect) };
+
+	//Growing has to happen right away or part of the portal would sample outside the render target, shrinking waits until the smaller rect was stable for a while
+	const bool bContainsRequiredRect{ scissorRect.bIsValid
+		&& scissorRect.Min.X <= requiredRect.Min.X && scissorRect.Min.Y <= requiredRect.Min.Y
+		&& scissorRect.Max.X >= requiredRect.Max.X && scissorRect.Max.Y >= requiredRect.Max.Y };
+	const bool bMatchesRequiredRect{ bContainsRequiredRect && scissorRect.Min == requiredRect.Min && scissorRect.Max == requiredRect.Max };
+
+	if (!bContainsRequiredRect || (!bMatchesRequiredRect && ++shrinkFrames >= CVarPortalScissorHysteresis.GetValueOnAnyThread()))
+	{
+		scissorRect = requiredRect;
+		shrinkFrames = 0;
+		return true;
+	}
+
+	if (bMatchesRequiredRect)
+	{
+		shrinkFrames = 0;
+	}
+	return false;
+}
+
+FMatrix APortalVR::ScissorProjection(const FMatrix& projectionMatrix, const FBox2D& scissorRect)
+{
+	//Scale and offset clip space so that the scissor rect becomes the whole [-1, 1] NDC range, this is an off-center version of the same projection
+	const FVector2D scale{ 2.0f / (scissorRect.Max.X - scissorRect.Min.X), 2.0f / (scissorRect.Max.Y - scissorRect.Min.Y) };
+	const FVector2D center{ scissorRect.GetCenter() };
+	const FMatrix scissorMatrix{
+		FPlane{ scale.X, 0.0f, 0.0f, 0.0f },
+		FPlane{ 0.0f, scale.Y, 0.0f, 0.0f },
+		FPlane{ 0.0f, 0.0f, 1.0f, 0.0f },
+		FPlane{ -center.X * scale.X, -center.Y * scale.Y, 0.0f, 1.0f } };
+	return projectionMatrix * scissorMatrix;
+}
+
+FLinearColor APortalVR::ScissorUVScaleBias(const FLinearColor& uvScaleBias, const FBox2D& scissorRect)
+{
+	//Scissor rect in texture UVs of the full capture, V is flipped compared to NDC
+	const FVector2D minUV{ 0.5f * scissorRect.Min.X + 0.5f, 0.5f - 0.5f * scissorRect.Max.Y };
+	const FVector2D maxUV{ 0.5f * scissorRect.Max.X + 0.5f, 0.5f - 0.5f * scissorRect.Min.Y };
+	const FVector2D scale{ 1.0f / (maxUV.X - minUV.X), 1.0f / (maxUV.Y - minUV.Y) };
+
+	//Apply the remap "(uv - minUV) * scale" after the existing scale and bias
+	return FLinearColor{ uvScaleBias.R * scale.X, uvScaleBias.G * scale.Y, (uvScaleBias.B - minUV.X) * scale.X, (uvScaleBias.A - minUV.Y) * scale.Y };
+}
+
+int32 APortalVR::GetCapturePassCount() const
+{
+	return captureMode == EPortalCaptureMode::SharedStereo ? 1 : 2;
+}
+
+float APortalVR::EstimateScreenCoverage(const FPortalViewFrame& viewFrame) const
+{
+	float maxCoverage{ 0.0f };
+	for (const FMatrix* eyeViewProjection : { &viewFrame.leftViewProjection, &viewFrame.rightViewProjection })
+	{
+		FBox2D ndcRect;
+		if (!ProjectPortalBounds(*eyeViewProjection, ndcRect))
+		{
+			return 1.0f;
+		}
+
+		maxCoverage = FMath::Max(maxCoverage, ndcRect.GetArea() * 0.25f);
+	}
+
+	return maxCoverage;
+}
+
+FIntPoint APortalVR::GetCaptureSize(int32 bucket, int32 slot) const
+{
+	//The render target only has to hold the scissor rect, which is a fraction of the full view on each axis
+	const FVector2D scissorFraction{ (slot == 0 ? leftScissorRect : rightScissorRect).GetSize() * 0.5f };
+	const float scale{ resolutionScale * UPortalManagerSubsystem::ResolutionBucketScales[bucket] };
+	return FIntPoint{ FMath::Max(FMath::RoundToInt(viewportSize.X * scale * scissorFraction.X), 16), FMath::Max(FMath::RoundToInt(viewportSize.Y * scale * scissorFraction.Y), 16) };
+}
+
+int64 APortalVR::GetCapturePixelCount(int32 bucket) const
+{
+	int64 pixelCount{ 0 };
+	for (int32 slot = 0; slot < GetCapturePassCount(); ++slot)
+	{
+		const FIntPoint captureSize{ GetCaptureSize(bucket, slot) };
+		pixelCount += static_cast<int64>(captureSize.X) * captureSize.Y;
+	}
+	return pixelCount;
+}
+
+bool APortalVR::ApplyCaptureResolution(bool bForce)
+{
+	const int32 bucket{ portalManager->ReserveCapturePixels(this, budgetResolutionBucket, bForce) };
+	if (bucket == INDEX_NONE)
+	{
+		return false;
+	}
+
+	//Without render targets nothing is rendered, the pixels are left to the portals after this one
+	if (!AcquireRenderTargets(bucket))
+	{
+		portalManager->ReleaseCapturePixels(this, bucket);
+		return false;
+	}
+
+	return true;
+}
+
+bool APortalVR::AcquireRenderTargets(int32 bucket)
+{
+	//Returns our current leases if the size and format still match, so this is cheap when nothing changed
+	UPortalRenderTargetPool* renderTargetPool{ portalManager->GetRenderTargetPool() };
+	const EPixelFormat format{ GetRenderTargetFormat() };
+
+	UTextureRenderTarget2D* leftTarget{ renderTargetPool->AcquireRenderTarget(this, 0, GetCaptureSize(bucket, 0), format) };
+	UTextureRenderTarget2D* rightTarget{ captureMode == EPortalCaptureMode::SharedStereo ? leftTarget : renderTargetPool->AcquireRenderTarget(this, 1, GetCaptureSize(bucket, 1), format) };
+	if (!leftTarget || !rightTarget)
+	{
+		return false;
+	}
+
+	resolutionBucket = bucket;
+
+	//The material keeps showing the previous capture until SubmitCapture() rendered into these
+	if (leftTarget != renderLeftTarget)
+	{
+		renderLeftTarget = leftTarget;
+		portalLeftCapture->TextureTarget = renderLeftTarget;
+	}
+
+	if (captureMode != EPortalCaptureMode::SharedStereo && rightTarget != renderRightTarget)
+	{
+		renderRightTarget = rightTarget;
+		portalRightCapture->TextureTarget = renderRightTarget;
+	}
+
+	return true;
+}
+
+EPixelFormat APortalVR::GetRenderTargetFormat() const
+{
+	//The captures write HDR scene color, a UNORM format like RGB10A2 would clamp it at 1.0. Platforms without R11G11B10 render targets stay at half float
+	return bUseLowPrecisionRenderTargets && GPixelFormats[PF_FloatR11G11B10].Supported ? PF_FloatR11G11B10 : PF_FloatRGBA;
+}
+
+void APortalVR::OnRenderTargetRevoked(int32 slot)
+{
+	//Nested captures are only displayed while the portal that sees this one renders, so only the fallback has to forget them
+	if (slot >= NestedCaptureSlot)
+	{
+		const int32 levelIndex{ (slot - NestedCaptureSlot) / 2 };
+		if (nestedBufferIndices[levelIndex] == (slot - NestedCaptureSlot) % 2)
+		{
+			nestedMaterialStates[levelIndex] = FPortalMaterialState{};
+		}
+		return;
+	}
+
+	//Drop every reference so the material never displays what another portal renders into the render target
+	UTextureRenderTarget2D* revokedTarget{ slot == 0 ? renderLeftTarget : renderRightTarget };
+	if (slot == 0)
+	{
+		renderLeftTarget = nullptr;
+		portalLeftCapture->TextureTarget = nullptr;
+	}
+	else
+	{
+		renderRightTarget = nullptr;
+		portalRightCapture->TextureTarget = nullptr;
+	}
+
+	if (capturedMaterialState.leftTarget == revokedTarget)
+	{
+		capturedMaterialState.leftTarget = nullptr;
+	}
+	if (capturedMaterialState.rightTarget == revokedTarget)
+	{
+		capturedMaterialState.rightTarget = nullptr;
+	}
+	ApplyMaterialState(capturedMaterialState);
 }
 
 bool APortalVR::WasActorInFrontOfPortal(const FVector& location) const
@@ -176,61 +1062,176 @@ bool APortalVR::WasActorInFrontOfPortal(const FVector& location) const
 	return FVector::DotProduct(directionPlayerMovement, GetActorForwardVector()) >= 0.0f;
 }
 
-void APortalVR::UpdateCharacterTracking()
+bool APortalVR::IsLocationNearPortal(const FVector& location) const
 {
-	//We first check whether the VR headset's current location this current frame makes it clip through the portal plane by comparing it to the VR headset's location in the previous frame
-	FPlane portalPlane{ portalMesh->GetComponentLocation(), portalMesh->GetForwardVector() };
-	FVector currentCameraLocation{ portalPlayerCharacter->Camera->GetComponentLocation() };
-	FVector pointInterscetion;
-	bool passedThroughPlane = FMath::SegmentPlaneIntersection(prevCameraLocation, currentCameraLocation, portalPlane, pointInterscetion);
+	//Note that the distance is determined by the width of the portal, factoring in scaling too
+	return FVector::Distance(location, portalMesh->GetComponentLocation()) < portalMeshHalfExtents.X * portalMesh->GetComponentScale().Y;
+}
+
+bool APortalVR::ShouldCapturePortal(const FPortalViewFrame& viewFrame)
+{
+	const FVector& cameraLocation{ viewFrame.cameraLocation };
+
+	//Never cull while the player is close enough to be stepping through the portal, the camera can be inside the portal's bounds where the tests below are unreliable
+	if (IsLocationNearPortal(cameraLocation))
+	{
+		bWasInFrustumLastFrame = true;
+		return true;
+	}
+
+	//Baked visibility is the cheapest test, a portal that can't be seen from anywhere in the camera's region is culled right away
+	if (!portalManager->IsPotentiallyVisible(this, viewFrame.visibilityCell))
+	{
+		INC_DWORD_STAT(STAT_PortalsCulledPVS);
+		bWasInFrustumLastFrame = false;
+		return false;
+	}
+
+	//The portal is only visible from its front side, there is nothing to capture if the player is standing behind it
+	if (!WasActorInFrontOfPortal(cameraLocation))
+	{
+		INC_DWORD_STAT(STAT_PortalsCulledBackFace);
+		bWasInFrustumLastFrame = false;
+		return false;
+	}
+
+	//Test the portal mesh's bounds against the stereo frustums of both eyes, the portal needs to be captured if either eye can see it
+	const bool bInFrustum{ viewFrame.leftFrustum.IntersectBox(portalMesh->Bounds.Origin, portalMesh->Bounds.BoxExtent)
+		|| viewFrame.rightFrustum.IntersectBox(portalMesh->Bounds.Origin, portalMesh->Bounds.BoxExtent) };
+
+	const bool bWasInFrustum{ bWasInFrustumLastFrame };
+	bWasInFrustumLastFrame = bInFrustum;
+	if (!bInFrustum)
+	{
+		INC_DWORD_STAT(STAT_PortalsCulledFrustum);
+		return false;
+	}
 
 	/*
-	 * Gets relative location of where the headset intersected with the portal plane relative to the portal mesh itself.
-	 * Then check whether the relative location exceeds the size of the portal mesh (with mesh scaling in mind if size was changed via scale by someone)
+	 * Occlusion uses the renderer's result from the previous frame, the portal mesh only gets a recent render time if it passed the occlusion queries of a view.
+	 * If the portal just entered the frustum there is no valid result yet, so we capture it rather than show a stale texture for a frame.
+	 * Without rendering (-nullrhi, see the "Portal.Bench.Scalability" benchmark) nothing is ever rendered, so occlusion is skipped
 	 */
-	FVector relativeIntersection = portalMesh->GetComponentTransform().InverseTransformPositionNoScale(pointInterscetion);
-	FVector portalSize { 0.0f, portalMesh->GetStaticMesh()->GetBoundingBox().Max.Y * portalMesh->GetComponentScale().Y, portalMesh->GetStaticMesh()->GetBoundingBox().Max.Z * portalMesh->GetComponentScale().Z };
-	bool passedWithinPortal{ FMath::Abs(relativeIntersection.Z) <= portalSize.Z && FMath::Abs(relativeIntersection.Y) <= portalSize.Y };
+	if (bWasInFrustum && FApp::CanEverRender() && !portalMesh->WasRecentlyRendered(occlusionCullingTolerance))
+	{
+		INC_DWORD_STAT(STAT_PortalsCulledOcclusion);
+		return false;
+	}
+
+	return true;
+}
 
-	//Along with the other two checks we did, also double check whether the actor was indeed in front of the portal and didn't enter from behind the portal
-	if (passedThroughPlane && passedWithinPortal && WasActorInFrontOfPortal(prevCameraLocation))
+void APortalVR::OnPortalBoxBeginOverlap(UPrimitiveComponent* overlappedComponent, AActor* otherActor, UPrimitiveComponent* otherComponent, int32 otherBodyIndex, bool bFromSweep, const FHitResult& sweepResult)
+{
+	if (IsTraversalCandidate(otherActor, otherComponent))
 	{
-		TeleportCharacter();
+		portalManager->AddTraversalCandidate(this, otherComponent);
 	}
+}
 
-	prevCameraLocation = portalPlayerCharacter->Camera->GetComponentLocation();
+void APortalVR::OnPortalBoxEndOverlap(UPrimitiveComponent* overlappedComponent, AActor* otherActor, UPrimitiveComponent* otherComponent, int32 otherBodyIndex)
+{
+	portalManager->RemoveTraversalCandidate(this, otherComponent);
 }
 
-void APortalVR::TeleportCharacter()
+bool APortalVR::IsTraversalCandidate(const AActor* actor, const UPrimitiveComponent* component) const
 {
+	//Only bodies that move their whole actor can be teleported by moving the component, whether it actually simulates physics is checked when it crosses the portal (held pickups stop simulating)
+	return actor && component && !actor->IsA<APortalCharacter>() && actor->GetRootComponent() == component && component->Mobility == EComponentMobility::Movable;
+}
+
+FPortalRect APortalVR::GetPortalRect() const
+{
+	//Editor tools run on portals that were never initialized, they read the extents from the static mesh
+	if (portalMeshHalfExtents.IsZero() && portalMesh->GetStaticMesh())
+	{
+		const FBox portalMeshBounds{ portalMesh->GetStaticMesh()->GetBoundingBox() };
+		return FPortalRect{ portalMesh->GetComponentTransform(), FVector2D{ portalMeshBounds.Max.Y, portalMeshBounds.Max.Z } };
+	}
+
+	return FPortalRect{ portalMesh->GetComponentTransform(), portalMeshHalfExtents };
+}
+
+void APortalVR::UpdateCharacterTracking(const FVector& cameraLocation)
+{
+	/*
+	 * We check whether the VR headset's current location this current frame makes it clip through the portal plane by comparing it to the VR headset's location in the previous frame.
+	 * The segment has to start in front of the portal (so the actor didn't enter from behind) and intersect the plane within the size of the portal mesh (with mesh scaling in mind)
+	 */
+	bCameraCrossed = FPortalMath::SegmentCrossesPortal(GetPortalRect(), prevCameraLocation, cameraLocation);
+}
+
+void APortalVR::TeleportCharacter(APortalCharacter* character, const FTransform& fromTransform)
+{
+	PORTAL_SCOPE_CYCLE_COUNTER(STAT_PortalTeleportCharacter, TeleportCharacter);
+
 	FVector newLocation;
 	FRotator newRotation;
-	ConvertLocationRotationToPortal(newLocation, newRotation, portalPlayerCharacter->GetActorTransform());
+	ConvertLocationRotationToPortal(newLocation, newRotation, fromTransform);
 
-	portalPlayerCharacter->GetRootComponent()->SetWorldLocationAndRotation(newLocation, newRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	character->GetRootComponent()->SetWorldLocationAndRotation(newLocation, newRotation, false, nullptr, ETeleportType::TeleportPhysics);
 
 	/* 
 	 * Translate the old velocity right before the character teleports to a new velocity that takes in account the new direction of the character after teleporting
 	 * If we don't do this, it will keep the old velocity/momentum after the character teleports and it will move with the old momentum very briefly after teleporting causing inconsistent movement
 	 */
-	FVector lastVelocity{ -portalPlayerCharacter->GetVelocity() };
-	FVector relativeVelocity{ UKismetMathLibrary::Dot_VectorVector(lastVelocity, GetActorForwardVector()), UKismetMathLibrary::Dot_VectorVector(lastVelocity, GetActorRightVector()), UKismetMathLibrary::Dot_VectorVector(lastVelocity, GetActorUpVector()) };
-	FVector newVelocity{ relativeVelocity.X * portalTarget->GetActorForwardVector() + relativeVelocity.Y * portalTarget->GetActorRightVector() + relativeVelocity.Z * portalTarget->GetActorUpVector() };
-	portalPlayerCharacter->GetCharacterMovement()->Velocity = newVelocity;
+	character->GetCharacterMovement()->Velocity = FPortalMath::TransformDirection(GetThroughMatrix(), character->GetVelocity());
+
+	//Remote players teleported by the server are not looking through the exit portal on this machine, other split screen players look through their own copy of it
+	const FPortalViewer& viewer{ portalManager->GetViewer(viewerIndex) };
+	if (character != viewer.character)
+	{
+		return;
+	}
+
+	//"Turn on" the exit portal so that it updates the portal the same frame you teleport, this bypasses the culling stage on purpose
+	portalManager->UpdateViewFrame(viewerIndex);
+	const FPortalViewFrame& viewFrame{ viewer.viewFrame };
+	portalTarget->PrepareCapture(viewFrame, true);
+	portalManager->SubmitPortalCapture(portalTarget, true);
+	portalTarget->SetMaterialScalar(ScaleOffsetParameter, CustomDataScaleOffset, 1.0f);
+}
+
+void APortalVR::OnViewerChanged()
+{
+	const FPortalViewer& viewer{ portalManager->GetViewer(viewerIndex) };
+	const APortalCharacter* character{ viewer.character };
+	if (!character || !viewer.controller)
+	{
+		return;
+	}
 
-	//"Turn on" the exit portal so that it updates the portal the same frame you teleport
-	portalTarget->portalMaterial->SetScalarParameterValue("ScaleOffset", 1.0f);
-	portalTarget->UpdatePortalView();
-	portalTarget->prevCameraLocation = portalPlayerCharacter->Camera->GetComponentLocation();
+	portalLeftCapture->PostProcessSettings = character->Camera->PostProcessSettings;
+	if (portalRightCapture)
+	{
+		portalRightCapture->PostProcessSettings = character->Camera->PostProcessSettings;
+	}
+
+	//The player's part of the viewport is multiplied by our scalar and the resolution bucket to determine our XY resolution for the portal texture
+	viewportSize = viewer.viewportSize;
+
+	//A new viewer (respawned pawn, late replicated client pawn) would otherwise cross from wherever the last one stood
+	prevCameraLocation = character->Camera->GetComponentLocation();
+	bCameraCrossed = false;
 }
 
 void APortalVR::ConvertLocationRotationToPortal(FVector& newLocation, FRotator& newRotator, const FTransform& actorTransform) const
 {
-	FMatrix actorRelativeMatrix{ actorTransform.ToMatrixWithScale() * GetActorTransform().ToMatrixWithScale().Inverse() };	//Get world to local position (matrix) of our actor/player/camera relative to this portal
-	actorRelativeMatrix *= FRotationMatrix{ FRotator{ 0.0f, 180.0f, 0.0f } };												//Flip the matrix on the Yaw axis because the position should be mirrored for the other portal
-	FMatrix actorWorldMatrix{ actorRelativeMatrix * portalTarget->GetActorTransform().ToMatrixWithScale() };				//Get local to world position (matrix) of our actor/player/camera relative to the target/exit portal
+	//World to local of this portal, mirrored on the Yaw axis, then local to world of the target/exit portal, all baked into the cached through matrix
+	FPortalMath::TransformLocationRotation(GetThroughMatrix(), actorTransform, newLocation, newRotator);
+}
 
-	//return output via reference
-	newLocation = actorWorldMatrix.GetOrigin();
-	newRotator = actorWorldMatrix.Rotator();
+const FMatrix& APortalVR::GetThroughMatrix() const
+{
+	if (bThroughMatrixDirty)
+	{
+		portalThroughMatrix = FPortalMath::ComputeThroughMatrix(GetActorTransform(), portalTarget->GetActorTransform());
+		bThroughMatrixDirty = false;
+	}
+	return portalThroughMatrix;
+}
+
+void APortalVR::OnPortalTransformUpdated(USceneComponent* updatedComponent, EUpdateTransformFlags updateTransformFlags, ETeleportType teleport)
+{
+	bThroughMatrixDirty = true;
 }
\ No newline at end of file
@@ -1,29 +1,49 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Engine/TextureRenderTarget2D.h"
 #include "GameFramework/Actor.h"
+#include "PortalMath.h"
+#include "ShowFlags.h"
 #include "PortalVR.generated.h"
 
-/* 
- * A struct inheriting from FActorTickFunction is needed because UE4 does not support two tick functions in a single object by default
- * This is a workaround so that we don't have to have a seperate object with the only purpose of having a PostPhysicsTick in it
- * We will use this to update the player/character's position after the physics update and after the portal's texture have been updated
- */
-USTRUCT()
-struct FPostPhysicsTick : public FActorTickFunction
+//How a portal renders the view through it for the two eyes
+UENUM(BlueprintType)
+enum class EPortalCaptureMode : uint8
 {
-	GENERATED_BODY()
-
-	class APortalVR* refPortal;
+	//One capture and one render target per eye, each eye does its own scene traversal
+	PerEye,
+	/*
+	 * One capture covering both eye frustums into a single shared render target, the material samples each eye's region of it.
+	 * Halves the capture passes, but the union of the eye frustums is wider than either eye's, so at the same render target size each eye gets fewer pixels than per eye
+	 */
+	SharedStereo
+};
 
-	virtual void ExecuteTick(float DeltaTime, enum ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+//Capture quality tier of a portal, picked every frame from its distance and screen coverage
+UENUM(BlueprintType)
+enum class EPortalLODTier : uint8
+{
+	//Full quality live capture
+	Near,
+	//Live capture without dynamic shadows, translucency and the expensive post processing, rendering lower mesh LODs
+	Mid,
+	//No live capture, the last capture is kept as a snapshot of the destination and only refreshed every few seconds
+	Far
 };
 
-//FActorTickFunctions are unsafe to copy and its copy assignment operator has been deleted, so we need to inform UE4 about our FPostPhysicsTick struct to not copy it via copy assignment operator
-template <>
-struct TStructOpsTypeTraits<FPostPhysicsTick> : public TStructOpsTypeTraitsBase2<FPostPhysicsTick>
+//Everything the portal's material displays, kept so the material can be switched back after it was temporarily pointed at a nested capture
+struct FPortalMaterialState
 {
-	enum { WithCopy = false };
+	//Render targets sampled by each eye, the same one in shared stereo mode and for nested captures
+	class UTextureRenderTarget2D* leftTarget{ nullptr };
+	class UTextureRenderTarget2D* rightTarget{ nullptr };
+	//See APortalVR::leftEyeUVScaleBias
+	FLinearColor leftUVScaleBias{ 1.0f, 1.0f, 0.0f, 0.0f };
+	FLinearColor rightUVScaleBias{ 1.0f, 1.0f, 0.0f, 0.0f };
+	//U, V and W rows of each eye's reprojection, see APortalVR::ComputeReprojection()
+	FLinearColor leftReprojection[3];
+	FLinearColor rightReprojection[3];
 };
 
 UCLASS()
@@ -31,8 +51,17 @@ class PORTALVREXAMPLE_API APortalVR : public AActor
 {
 	GENERATED_BODY()
 
-	//Declare FPostPhysicsTick as our friend so that it can access APortalVR's private member function
-	friend FPostPhysicsTick;
+	//The portal manager ticks every portal, reads their screen coverage and hands out their resolution buckets
+	friend class UPortalManagerSubsystem;
+	//The render target pool tells the portal when one of its render targets is taken away
+	friend class UPortalRenderTargetPool;
+	//The capture scheduler, LOD and recursion tests set up the portals' capture state directly, see PortalManagerTests.cpp
+	friend class FPortalCaptureTestAccess;
+
+public:
+
+	//Deepest level of portals seen through portals that can be captured, see "r.Portal.RecursionMaxDepth"
+	static constexpr int32 MaxRecursionDepth{ 3 };
 
 protected:
 
@@ -43,12 +72,19 @@ protected:
 	class USceneCaptureComponent2D* portalLeftCapture;
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal")
 	class USceneCaptureComponent2D* portalRightCapture;
+	//Trigger volume on the PortalBox channel around the portal, physics bodies overlapping it are tested for crossing the portal
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Portal|Traversal")
+	class UBoxComponent* portalBox;
 
 	//Reference to the other portal connected to this portal
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Portal")
 	APortalVR* portalTarget;
 
-	//Adjusts the resolution of portal texture for performance
+	//Whether this portal captures each eye separately or both eyes in a single shared capture pass, shared stereo trades per eye resolution for fewer passes. Falls back to per eye if the material has no shared stereo support
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal")
+	EPortalCaptureMode captureMode;
+
+	//Adjusts the resolution of portal texture for performance, this is the upper limit when the capture resolution adapts to screen coverage
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal", meta = (UIMin = "0.0", UIMax = "1.0", ClampMin = "0.0", ClampMax = "1.0"))
 	float resolutionScale;
 
@@ -56,62 +92,352 @@ protected:
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal")
 	float captureCameraClippingPlaneOffset;
 
+	//Bakes the exit portal's clipping plane into the capture projection as an oblique near plane instead of using the engine's global clip plane, so geometry behind the exit portal is culled instead of only clipped per pixel
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal")
+	bool bUseObliqueNearPlane;
+
+	//How long (in seconds) the portal mesh can go without being rendered in the player's view before its captures are skipped as occluded
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|Culling", meta = (ClampMin = "0.0"))
+	float occlusionCullingTolerance;
+
+	//Renders only the screen rectangle the portal covers into a matching smaller render target instead of the whole view, the material remaps its UVs with the per eye UV scale and bias. Turned off if the material doesn't implement those
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal")
+	bool bScissorCapture;
+
+	//Set when the portal's material doesn't read scene depth from the render target's alpha. The portal then captures into 32 bit R11G11B10 float instead of 64 bit half float render targets, halving their memory. Scene color keeps its HDR range at a lower precision
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal")
+	bool bUseLowPrecisionRenderTargets;
+
+	//How far (in world units) the traversal box reaches in front of and behind the portal, bodies moving faster than this per frame can pass through without being teleported
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|Traversal", meta = (ClampMin = "1.0"))
+	float traversalBoxDepth;
+
+	//Streaming levels seen through the portal and around its exit, the portal manager loads them before the player reaches the portal and unloads them once it is out of reach
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|Streaming")
+	TArray<TSoftObjectPtr<UWorld>> destinationLevels;
+
+	//Distance (in world units) from the player camera beyond which the portal drops to the mid tier, scaled by "r.Portal.LODDistanceScale"
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|LOD", meta = (ClampMin = "0.0"))
+	float midTierDistance;
+
+	//Distance (in world units) from the player camera beyond which the portal drops to the far tier, scaled by "r.Portal.LODDistanceScale". Needs a material implementing the reprojection
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|LOD", meta = (ClampMin = "0.0"))
+	float farTierDistance;
+
+	//Portals covering at least this fraction of the screen stay in the near tier no matter how far away they are
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|LOD", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float nearTierMinScreenCoverage;
+
+	//Portals only drop to the far tier while they cover less than this fraction of the screen
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|LOD", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float farTierMaxScreenCoverage;
+
+	//LOD distance factor of the captures in the mid and far tiers, higher values pick lower mesh LODs. The near tier uses the captures' own LODDistanceFactor
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|LOD", meta = (ClampMin = "0.0"))
+	float midTierLODDistanceFactor;
+
+	//How often (in seconds) the snapshot of a far tier portal is refreshed
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal|LOD", meta = (ClampMin = "0.0"))
+	float farTierRefreshSeconds;
+
 	//Set to portal's material so that it can dynamically create a new material at runtime to assign the render targets to the material's textures
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal")
 	class UMaterialInterface* portalMaterialInterface;
 
+	//Set when the portal's material reads its per portal values with "Custom Primitive Data" nodes (see CustomDataScaleOffset and following) instead of named parameters. M_PortalVR as shipped still reads the named parameters
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Portal")
+	bool bMaterialUsesCustomPrimitiveData;
+
 private:
 
-	//References (pointers) to relevant player/character objects so we don't have to keep calling "GetPlayerXXX()"
-	APlayerController* portalPlayerController;
-	class APortalCharacter* portalPlayerCharacter;
-	ULocalPlayer* portalPlayerLocal;
+	//Same on the server and every client, identifies the portal in replicated crossings (see UPortalManagerSubsystem::RegisterPortal())
+	uint16 netId;
 
-	//Render target texture for left eye, used in portal's material to display portal on mesh
-	class UCanvasRenderTarget2D* renderLeftTarget;
-	//Render target texture for right eye, used in portal's material to display portal on mesh
-	class UCanvasRenderTarget2D* renderRightTarget;
+	//Local player this portal renders for (see FPortalViewer), 0 for the level's portals. The other split screen players see copies the portal manager spawns of the level's portals
+	int32 viewerIndex;
+	//Level portal this is a split screen player's copy of, nullptr for the level's portals. Copies only render, they don't teleport anything themselves
+	APortalVR* viewerSource;
 
-	//Portal's material
-	UMaterialInstanceDynamic* portalMaterial;
+	//Render target texture for left eye, used in portal's material to display portal on mesh. In shared stereo mode this is the single target used by both eyes. Leased from the render target pool, nullptr until the portal is first captured
+	class UTextureRenderTarget2D* renderLeftTarget;
+	//Render target texture for right eye, used in portal's material to display portal on mesh. Not used in shared stereo mode
+	class UTextureRenderTarget2D* renderRightTarget;
 
-	//Our object that will run/act as our second tick that will tick on post physics
-	FPostPhysicsTick secondaryPostPhysicsTick;
+	//Portal's material, holds the render targets and, unless bMaterialUsesCustomPrimitiveData is set, the named parameters for everything else
+	UMaterialInstanceDynamic* portalMaterial;
+	//Render targets currently assigned to the material's textures
+	class UTextureRenderTarget2D* displayedLeftTarget;
+	class UTextureRenderTarget2D* displayedRightTarget;
+	//Whether the portal's material implements the per eye UV scale and bias and the shared stereo switch, detected when the material is created
+	bool bMaterialHasUVScaleBias;
+	//Whether the portal's material implements the eyes' reprojection, refresh intervals, far tier snapshots and nested captures all show a capture from another camera and need it
+	bool bMaterialHasReprojection;
+
+	//World level manager this portal is registered with
+	class UPortalManagerSubsystem* portalManager;
+
+	//Size of the player's part of the viewport, kept up to date by the portal manager
+	FIntPoint viewportSize;
+
+	//Resolution bucket of the currently leased render targets (see UPortalManagerSubsystem::ResolutionBucketScales)
+	int32 resolutionBucket;
+	//Resolution bucket the portal manager settled on from the portal's screen coverage, only follows the preferred bucket once that was stable for "r.Portal.ResolutionHysteresisFrames"
+	int32 allocatedResolutionBucket;
+	//Number of consecutive frames the portal preferred a bucket different from its allocated one
+	int32 pendingResolutionFrames;
+	//Allocated bucket stepped down to fit the current pixel budget, the bucket the next capture asks for. Picked again every frame, so the portal is back at its allocated bucket as soon as the budget allows
+	int32 budgetResolutionBucket;
+
+	//Fraction of the screen covered by the portal in the eye that sees the most of it, 0 when the portal was culled this frame
+	float screenCoverage;
+	//Distance between the player camera and the portal this frame
+	float cameraDistance;
+	//Game thread time of this frame's UpdateCaptureProjections() and UpdatePortalView(), summed up by the portal manager
+	double portalViewSeconds;
+	//Game thread time of this frame's capture submission including the nested captures, measured by the portal manager
+	double portalSubmitSeconds;
+
+	//Half extents (Y and Z) of the portal mesh's bounding box without scaling, read once on Init() instead of from the static mesh every frame
+	FVector2D portalMeshHalfExtents;
+
+	//Cached matrix taking transforms through this portal to the target portal (see FPortalMath::ComputeThroughMatrix), refreshed only when either portal moves
+	mutable FMatrix portalThroughMatrix;
+	mutable bool bThroughMatrixDirty;
 
 	//Keeps track of last world location of player camera (VR headset), used to calculate when to teleport the player by determining whether the camera clips through the portal mesh
 	FVector prevCameraLocation;
+	//Set by the crossing test when the camera went through the portal since the last frame, the portal manager then teleports the player on the game thread
+	bool bCameraCrossed;
+
+	//Projection matrices the captures render with this frame, after the shared stereo, scissor and oblique near plane adjustments
+	FMatrix leftCaptureProjection;
+	FMatrix rightCaptureProjection;
+	//Maps each eye's screen UV to the UV of the render target it samples as "uv * (R, G) + (B, A)", passed to the material when the portal is captured
+	FLinearColor leftEyeUVScaleBias;
+	FLinearColor rightEyeUVScaleBias;
+
+	//Part of each capture's NDC space [-1, 1] that is rendered into its render target
+	FBox2D leftScissorRect;
+	FBox2D rightScissorRect;
+	//Number of consecutive frames the scissor rects could have been smaller
+	int32 leftScissorShrinkFrames;
+	int32 rightScissorShrinkFrames;
+	//Whether either scissor rect changed this frame, the render targets then no longer match what the material expects and the portal has to be captured again
+	bool bScissorRectChanged;
+
+	//Whether the portal mesh was inside either eye's frustum last frame. Last frame's occlusion result is only meaningful if the mesh was actually in view
+	bool bWasInFrustumLastFrame;
+
+	//Capture camera placement and clip plane prepared for this frame's capture, applied to the capture components on the game thread
+	FVector captureLocation;
+	FRotator captureRotation;
+	FVector captureClipPlaneBase;
+	FVector captureClipPlaneNormal;
+	//False when the oblique near plane couldn't be used this frame and the captures fall back to the global clip plane
+	bool bCaptureObliqueNearPlane;
+	//Whether the portal passed culling this frame and its capture was prepared
+	bool bCapturePrepared;
+	//Whether the portal manager's capture scheduler picked the prepared capture to be submitted this frame, portals not picked keep their previous capture
+	bool bCaptureScheduled;
+
+	//Bit of this portal in the level's baked visibility data, INDEX_NONE if the level has none or the portal was added after the bake
+	int32 visibilityIndex;
+
+	//Frames since the portal was last captured and the number of frames the capture scheduler lets it go between captures
+	int32 framesSinceCapture;
+	int32 refreshInterval;
+	//Offset of the frames the portal is refreshed on, so portals with the same refresh interval take turns
+	int32 refreshPhase;
+	//Capture camera placement of the last capture, the scheduler refreshes the portal early once the camera moved too far from it
+	FVector capturedLocation;
+	FQuat capturedRotation;
+
+	//World time of the last capture, far tier portals are refreshed once it is farTierRefreshSeconds old
+	float capturedTime;
+
+	//Tier picked for this frame and the tier the capture components are currently set up for
+	EPortalLODTier lodTier;
+	EPortalLODTier appliedLODTier;
+	//Show flags and LOD distance factor the captures were set up with, used by the near tier
+	FEngineShowFlags nearShowFlags;
+	float nearLODDistanceFactor;
+
+	//What the material shows for the player's view, the last capture submitted by SubmitCapture()
+	FPortalMaterialState capturedMaterialState;
+	//What the material showed the last time the portal was captured at each recursion level, the deepest level and portals over the recursion budget fall back to these
+	FPortalMaterialState nestedMaterialStates[MaxRecursionDepth];
+	//Which of the level's two nested render targets was written last, the next nested capture goes into the other one so the fallback never samples a render target being rendered
+	int32 nestedBufferIndices[MaxRecursionDepth];
 
 public:
 
 	APortalVR();
 
-	//Our primary tick, will run on "post update work" which is after our "post physics" tick
-	virtual void Tick(float DeltaTime) override;
+	//World space rectangle of the portal mesh's surface
+	FPortalRect GetPortalRect() const;
+
+	class UStaticMeshComponent* GetPortalMesh() const { return portalMesh; }
+	APortalVR* GetPortalTarget() const { return portalTarget; }
+	//Whether this is a split screen player's copy of a level portal, copies only render and don't teleport anything themselves
+	bool IsViewerCopy() const { return viewerSource != nullptr; }
+	const TArray<TSoftObjectPtr<UWorld>>& GetDestinationLevels() const { return destinationLevels; }
+
+	//Connects the portal to another one, only before it begins play. Used by the benchmarks spawning portal pairs
+	void SetPortalTarget(APortalVR* target) { portalTarget = target; }
 
 protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 private:
 
-	//Setups the portal texture/render targets and doubles check whether everything needed to function is present before starting the tick functions
+	//Setups the portal texture/render targets and doubles check whether everything needed to function is present before registering with the portal manager
 	void Init();
 
-	//Create render target textures and material for portal
+	//Create the material for the portal and turn off the capture features it can't display, render targets are leased later from the pool on the first capture
 	void CreatePortalTexturesAndMaterial();
 
 	//Helper function used to check whether the player was in front of the portal
 	bool WasActorInFrontOfPortal(const FVector& location) const;
 
-	//Called in the secondary post physics tick, checks whether the player moved through a portal and calls TeleportActor() if they did
-	void UpdateCharacterTracking();
+	//Helper function used to check whether a location is close enough to the portal that it could be stepping through it
+	bool IsLocationNearPortal(const FVector& location) const;
+
+	/*
+	 * Culls the portal and prepares everything its capture needs for this frame: screen coverage, projections, scissor rects and the capture camera's placement.
+	 * Only reads the world and writes this portal's own state, so the portal manager runs it for all portals in parallel. Forced preparation skips culling
+	 */
+	void PrepareCapture(const struct FPortalViewFrame& viewFrame, bool bForce);
+
+	//Game thread half of the capture: reserves the capture budget, leases the render targets, applies the prepared view to the capture components and submits the captures
+	void SubmitCapture(const struct FPortalViewFrame& viewFrame, bool bForce);
 
-	//Teleports the player and updates the exit portal on the same frame
-	void TeleportCharacter();
+	//Culling stage in front of the capture, returns false when the portal is facing away, outside both eye frustums or was occluded last frame
+	bool ShouldCapturePortal(const struct FPortalViewFrame& viewFrame);
 
-	//Updates the clipping planes, projection matrices, and location/rotation of the portal capture cameras
-	void UpdatePortalView();
+	//Hands physics bodies entering and leaving the traversal box to the portal manager, which tests them for crossing the portal after physics
+	UFUNCTION()
+	void OnPortalBoxBeginOverlap(UPrimitiveComponent* overlappedComponent, AActor* otherActor, UPrimitiveComponent* otherComponent, int32 otherBodyIndex, bool bFromSweep, const FHitResult& sweepResult);
+	UFUNCTION()
+	void OnPortalBoxEndOverlap(UPrimitiveComponent* overlappedComponent, AActor* otherActor, UPrimitiveComponent* otherComponent, int32 otherBodyIndex);
+
+	//Whether a component overlapping the traversal box can go through the portal, players are handled by UpdateCharacterTracking() and the crossings their clients send instead
+	bool IsTraversalCandidate(const AActor* actor, const UPrimitiveComponent* component) const;
+
+	//Run after physics for all portals in parallel, checks whether the player's camera moved through the portal since the last frame
+	void UpdateCharacterTracking(const FVector& cameraLocation);
+
+	//Teleports a player from the given transform, and updates the exit portal on the same frame if it is the player this portal renders for
+	void TeleportCharacter(class APortalCharacter* character, const FTransform& fromTransform);
+
+	//Called by the portal manager when the local player this portal renders for changes, picks up its camera's post processing, viewport size and location
+	void OnViewerChanged();
+
+	//Computes the location/rotation of the portal capture cameras, their clipping plane and bakes it into the capture projections
+	void UpdatePortalView(const struct FPortalViewFrame& viewFrame);
+
+	//Computes this frame's capture projections and the UV remapping for the material, including the shared stereo projection covering both eye frustums and the scissor rects
+	void UpdateCaptureProjections(const struct FPortalViewFrame& viewFrame);
+
+	//Projects the portal mesh's bounds and returns the NDC rect they cover clamped to the screen, returns false (and the whole screen) if the bounds reach behind the camera
+	bool ProjectPortalBounds(const FMatrix& viewProjectionMatrix, FBox2D& ndcRect) const;
+
+	//Snaps an NDC rect outwards to a grid of 1/16th of the screen
+	static FBox2D SnapToScissorGrid(const FBox2D& ndcRect);
+
+	//Snaps the portal's projected rect to a coarse grid, grows the scissor rect right away and only shrinks it once the smaller rect has been stable for a while. Returns true if the rect changed
+	bool UpdateScissorRect(FBox2D& scissorRect, int32& shrinkFrames, const FMatrix& viewProjectionMatrix);
+
+	//Off-center version of a projection that renders only the scissor rect into the whole render target
+	static FMatrix ScissorProjection(const FMatrix& projectionMatrix, const FBox2D& scissorRect);
+
+	//World to view matrix of a capture camera at the location and rotation
+	static FMatrix CaptureViewMatrix(const FVector& location, const FRotator& rotation);
+
+	//Off-center projection covering both projections' frustums, keeping the first one's depth mapping
+	static FMatrix UnionProjection(const FMatrix& leftProjection, const FMatrix& rightProjection);
+
+	/*
+	 * Computes the rows the material uses to take world positions on this portal's surface to the UVs of the render target the eye samples, as it was when the portal was captured.
+	 * Portals the capture scheduler skips keep showing their previous capture, the material reprojects it with these instead of the current screen UV
+	 */
+	static void ComputeReprojection(const FMatrix& worldToCaptureClip, FLinearColor (&reprojection)[3]);
+
+	//Passes the render targets, UV remapping and reprojection to the portal's material
+	void ApplyMaterialState(const FPortalMaterialState& materialState);
+
+	//Sets a float or four floats of the portal's material if they changed, at the custom primitive data index or as the named parameter depending on bMaterialUsesCustomPrimitiveData
+	void SetMaterialScalar(FName parameterName, int32 dataIndex, float value);
+	void SetMaterialVector(FName parameterName, int32 dataIndex, const FLinearColor& value);
+
+	/*
+	 * Layout of the portal mesh's custom primitive data, read by a portal material with "Custom Primitive Data" nodes when bMaterialUsesCustomPrimitiveData is set.
+	 * The reprojection takes three consecutive vectors per eye (U, V and W)
+	 */
+	static constexpr int32 CustomDataScaleOffset{ 0 };
+	static constexpr int32 CustomDataSharedStereoCapture{ 1 };
+	static constexpr int32 CustomDataLeftEyeUVScaleBias{ 4 };
+	static constexpr int32 CustomDataRightEyeUVScaleBias{ 8 };
+	static constexpr int32 CustomDataLeftEyeReprojection{ 12 };
+	static constexpr int32 CustomDataRightEyeReprojection{ 24 };
+
+	//View of this frame's prepared capture for the portals seen through it, one view covering both eyes
+	void GetRecursionView(const struct FPortalViewFrame& viewFrame, struct FPortalRecursionView& view) const;
+
+	/*
+	 * Captures the portal as seen through another portal's capture (level 1) or through such a nested capture (level 2 and deeper), and points the material at it until the portal manager restores it.
+	 * The virtual camera is the parent view's camera taken through this portal, the portal's screen rect in the parent view becomes the capture's scissor rect and the resolution drops further each level.
+	 * Past "maxDepth" or out of the recursion budget the portal shows what it was last captured into at that level instead. Returns false if the material wasn't changed
+	 */
+	bool CaptureNested(const struct FPortalRecursionView& parentView, int32 level, int32 maxDepth);
+
+	//Whether the capture scheduler has to capture the portal this frame no matter its refresh interval, because it has nothing valid to show
+	bool NeedsCapture() const;
+
+	//Picks this frame's LOD tier from the camera distance and screen coverage, moving to another tier takes crossing its thresholds by the "r.Portal.LODHysteresis" margin
+	EPortalLODTier SelectLODTier(const struct FPortalViewFrame& viewFrame) const;
+
+	//Sets the captures' show flags and LOD distance factor up for the tier
+	void ApplyLODTier(EPortalLODTier tier);
+
+	//Appends the remapping from full view UVs into the scissor rect's render target to a UV scale and bias
+	static FLinearColor ScissorUVScaleBias(const FLinearColor& uvScaleBias, const FBox2D& scissorRect);
+
+	//Number of scene captures this portal submits each time its view is updated
+	int32 GetCapturePassCount() const;
+
+	//Estimates the fraction of the screen the portal mesh's bounds cover by projecting them with each eye's view projection
+	float EstimateScreenCoverage(const struct FPortalViewFrame& viewFrame) const;
+
+	//Render target size for the given resolution bucket and render target slot (0 = left/shared, 1 = right), sized to the slot's scissor rect
+	FIntPoint GetCaptureSize(int32 bucket, int32 slot) const;
+
+	//Total pixels rendered by one update of this portal's view at the given resolution bucket
+	int64 GetCapturePixelCount(int32 bucket) const;
+
+	//Reserves this frame's captured pixels with the portal manager and leases render targets for the resulting bucket, returns false (and keeps nothing reserved) if the capture doesn't fit in the budget or the pool
+	bool ApplyCaptureResolution(bool bForce);
+
+	//Leases render targets of the bucket's size from the pool and hands them to the captures and material, returns false if the pool is out of memory
+	bool AcquireRenderTargets(int32 bucket);
+
+	//Render target format the pool should lease for this portal
+	EPixelFormat GetRenderTargetFormat() const;
+
+	//Called by the render target pool when it takes a render target back, slot 0 is the left/shared target, slot 1 the right target and the nested captures' targets follow from NestedCaptureSlot
+	void OnRenderTargetRevoked(int32 slot);
+
+	//First render target pool slot of the nested captures, two per recursion level
+	static constexpr int32 NestedCaptureSlot{ 2 };
 
 	//Calculates a new location and rotation via matrices for the player/camera relative to the target/exit portal
 	void ConvertLocationRotationToPortal(FVector& newLocation, FRotator& newRotator, const FTransform& actorTransform) const;
+
+	//Returns the cached through matrix, recomputing it first if either portal moved since it was last computed
+	const FMatrix& GetThroughMatrix() const;
+
+	//Bound to the TransformUpdated event of this portal's and the target portal's root components
+	void OnPortalTransformUpdated(USceneComponent* updatedComponent, EUpdateTransformFlags updateTransformFlags, ETeleportType teleport);
 };
@@ -0,0 +1,302 @@
+#include "PortalVisibilityBakeCommandlet.h"
+#include "PortalVisibilityData.h"
+#include "PortalVR.h"
+
+#include "Async/ParallelFor.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Math/RandomStream.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalVisibility, Log, All);
+
+//Upper limit of grid regions per map, the cells grow when the portals are spread too far apart for the requested cell size
+static constexpr int32 MaxVisibilityCells{ 1 << 20 };
+
+//Distance (in world units) in front of a portal's surface its viewpoints are placed at, so the rays don't start inside the wall the portal is on
+static constexpr float SurfaceSampleOffset{ 2.0f };
+
+UPortalVisibilityBakeCommandlet::UPortalVisibilityBakeCommandlet()
+	:cellSize{ 400.0f }, viewDistance{ 5000.0f }, regionSamples{ 8 }, surfaceSamples{ 3 }
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UPortalVisibilityBakeCommandlet::Main(const FString& Params)
+{
+	FString maps;
+	if (!FParse::Value(*Params, TEXT("Map="), maps, false))
+	{
+		UE_LOG(LogPortalVisibility, Error, TEXT("Usage: -run=PortalVisibilityBake -Map=/Game/Maps/MapA[,/Game/Maps/MapB...] [-CellSize=400] [-ViewDistance=5000] [-RegionSamples=8] [-SurfaceSamples=3]"));
+		return 1;
+	}
+
+	FParse::Value(*Params, TEXT("CellSize="), cellSize);
+	FParse::Value(*Params, TEXT("ViewDistance="), viewDistance);
+	FParse::Value(*Params, TEXT("RegionSamples="), regionSamples);
+	FParse::Value(*Params, TEXT("SurfaceSamples="), surfaceSamples);
+	cellSize = FMath::Max(cellSize, 10.0f);
+	viewDistance = FMath::Max(viewDistance, 0.0f);
+	regionSamples = FMath::Max(regionSamples, 1);
+	surfaceSamples = FMath::Max(surfaceSamples, 1);
+
+	TArray<FString> mapPackageNames;
+	maps.ParseIntoArray(mapPackageNames, TEXT(","));
+
+	int32 failedMaps{ 0 };
+	for (const FString& mapPackageName : mapPackageNames)
+	{
+		if (!BakeMap(mapPackageName))
+		{
+			++failedMaps;
+		}
+	}
+
+	return failedMaps == 0 ? 0 : 1;
+}
+
+bool UPortalVisibilityBakeCommandlet::BakeMap(const FString& mapPackageName)
+{
+	UPackage* mapPackage{ LoadPackage(nullptr, *mapPackageName, LOAD_None) };
+	UWorld* world{ mapPackage ? UWorld::FindWorldInPackage(mapPackage) : nullptr };
+	if (!world)
+	{
+		UE_LOG(LogPortalVisibility, Error, TEXT("Couldn't load map %s"), *mapPackageName);
+		return false;
+	}
+
+	//Loaded maps aren't initialized, the traces need a physics scene holding the static geometry's collision
+	world->WorldType = EWorldType::Editor;
+	world->AddToRoot();
+	if (!world->bIsWorldInitialized)
+	{
+		UWorld::InitializationValues initializationValues;
+		initializationValues.RequiresHitProxies(false).ShouldSimulatePhysics(false).EnableTraceCollision(true).CreateNavigation(false).CreateAISystem(false).AllowAudioPlayback(false).CreatePhysicsScene(true);
+		world->InitWorld(initializationValues);
+	}
+	world->UpdateWorldComponents(true, false);
+
+	//Sorted by name so rebaking an unchanged map gives the same bit order
+	TArray<APortalVR*> portals;
+	for (TActorIterator<APortalVR> portalIterator{ world }; portalIterator; ++portalIterator)
+	{
+		portals.Add(*portalIterator);
+	}
+	portals.Sort([](const APortalVR& a, const APortalVR& b) { return a.GetFName().LexicalLess(b.GetFName()); });
+
+	TArray<FName> portalNames;
+	TArray<AActor*> ignoredActors;
+	TArray<FPortalRect> portalRects;
+	TArray<TArray<FVector>> portalSurfacePoints;
+	FBox gridBounds{ ForceInit };
+	for (APortalVR* portal : portals)
+	{
+		portalNames.Add(portal->GetFName());
+		ignoredActors.Add(portal);
+		gridBounds += portal->GetPortalMesh()->Bounds.GetBox();
+
+		//A grid of viewpoints over the surface including its edges and corners
+		const FPortalRect portalRect{ portal->GetPortalRect() };
+		TArray<FVector>& surfacePoints{ portalSurfacePoints.AddDefaulted_GetRef() };
+		for (int32 row = 0; row < surfaceSamples; ++row)
+		{
+			for (int32 column = 0; column < surfaceSamples; ++column)
+			{
+				const float u{ surfaceSamples > 1 ? column / static_cast<float>(surfaceSamples - 1) * 2.0f - 1.0f : 0.0f };
+				const float v{ surfaceSamples > 1 ? row / static_cast<float>(surfaceSamples - 1) * 2.0f - 1.0f : 0.0f };
+				surfacePoints.Add(portalRect.origin + portalRect.normal * SurfaceSampleOffset + portalRect.right * (u * portalRect.halfExtents.X) + portalRect.up * (v * portalRect.halfExtents.Y));
+			}
+		}
+		portalRects.Add(portalRect);
+	}
+
+	if (portals.Num() == 0)
+	{
+		UE_LOG(LogPortalVisibility, Warning, TEXT("%s has no portals, nothing to bake"), *mapPackageName);
+		world->RemoveFromRoot();
+		return true;
+	}
+
+	//Regions only cover the part of the level portals can be seen from
+	gridBounds = gridBounds.ExpandBy(viewDistance);
+	const FVector gridExtent{ gridBounds.GetSize() };
+	float gridCellSize{ cellSize };
+	while ((FMath::CeilToDouble(gridExtent.X / gridCellSize) * FMath::CeilToDouble(gridExtent.Y / gridCellSize) * FMath::CeilToDouble(gridExtent.Z / gridCellSize)) > MaxVisibilityCells)
+	{
+		gridCellSize *= 1.25f;
+	}
+	const FIntVector gridSize{ FMath::Max(FMath::CeilToInt(gridExtent.X / gridCellSize), 1), FMath::Max(FMath::CeilToInt(gridExtent.Y / gridCellSize), 1), FMath::Max(FMath::CeilToInt(gridExtent.Z / gridCellSize), 1) };
+	const int32 numCells{ gridSize.X * gridSize.Y * gridSize.Z };
+
+	const FString dataPackageName{ UPortalVisibilityData::GetPackageNameForMap(mapPackageName) };
+	UPackage* dataPackage{ CreatePackage(*dataPackageName) };
+	const FString dataAssetName{ FPackageName::GetLongPackageAssetName(dataPackageName) };
+	UPortalVisibilityData* visibilityData{ FindObject<UPortalVisibilityData>(dataPackage, *dataAssetName) };
+	if (!visibilityData)
+	{
+		visibilityData = NewObject<UPortalVisibilityData>(dataPackage, *dataAssetName, RF_Public | RF_Standalone);
+	}
+	visibilityData->Reset(portalNames, gridBounds.Min, gridCellSize, gridSize);
+	const int32 wordsPerRow{ visibilityData->GetWordsPerRow() };
+
+	UE_LOG(LogPortalVisibility, Display, TEXT("Baking %s: %d portals, %d x %d x %d regions of %.0f units"), *mapPackageName, portals.Num(), gridSize.X, gridSize.Y, gridSize.Z, gridCellSize);
+	const double startTime{ FPlatformTime::Seconds() };
+
+	//Only static geometry occludes, anything that moves could get out of the way at runtime
+	FCollisionQueryParams queryParams{ SCENE_QUERY_STAT(PortalVisibilityBake), false };
+	queryParams.AddIgnoredActors(ignoredActors);
+	const FCollisionObjectQueryParams staticGeometry{ ECC_WorldStatic };
+	auto isUnobstructed = [world, &queryParams, &staticGeometry](const FVector& start, const FVector& end)
+	{
+		return !world->LineTraceTestByObjectType(start, end, staticGeometry, queryParams);
+	};
+	auto isInFront = [](const FPortalRect& portalRect, const FVector& location)
+	{
+		return FVector::DotProduct(location - portalRect.origin, portalRect.normal) > 0.0f;
+	};
+
+	/*
+	 * Regions: a portal is visible from a region if any viewpoint in the region has a clear line to any viewpoint on the portal's front side.
+	 * The viewpoints are the region's center, its corners and random points inside it
+	 */
+	TArray<uint32> sampledRegionBits;
+	sampledRegionBits.SetNumZeroed(visibilityData->regionBits.Num());
+	ParallelFor(numCells, [&](int32 cellIndex)
+	{
+		const FIntVector cell{ cellIndex % gridSize.X, (cellIndex / gridSize.X) % gridSize.Y, cellIndex / (gridSize.X * gridSize.Y) };
+		const FVector cellMin{ gridBounds.Min + FVector{ cell } * gridCellSize };
+		const FBox cellBox{ cellMin, cellMin + FVector{ gridCellSize } };
+
+		FRandomStream random{ cellIndex };
+		TArray<FVector> cellPoints{ cellBox.GetCenter() };
+		for (int32 corner = 0; corner < 8; ++corner)
+		{
+			cellPoints.Add(FVector{ corner & 1 ? cellBox.Max.X : cellBox.Min.X, corner & 2 ? cellBox.Max.Y : cellBox.Min.Y, corner & 4 ? cellBox.Max.Z : cellBox.Min.Z });
+		}
+		for (int32 sample = 1; sample < regionSamples; ++sample)
+		{
+			cellPoints.Add(FVector{ random.FRandRange(cellBox.Min.X, cellBox.Max.X), random.FRandRange(cellBox.Min.Y, cellBox.Max.Y), random.FRandRange(cellBox.Min.Z, cellBox.Max.Z) });
+		}
+
+		for (int32 portalIndex = 0; portalIndex < portals.Num(); ++portalIndex)
+		{
+			const FPortalRect& portalRect{ portalRects[portalIndex] };
+			bool bVisible{ false };
+			for (int32 pointIndex = 0; pointIndex < cellPoints.Num() && !bVisible; ++pointIndex)
+			{
+				if (!isInFront(portalRect, cellPoints[pointIndex]))
+				{
+					continue;
+				}
+
+				for (const FVector& surfacePoint : portalSurfacePoints[portalIndex])
+				{
+					if (isUnobstructed(cellPoints[pointIndex], surfacePoint))
+					{
+						bVisible = true;
+						break;
+					}
+				}
+			}
+
+			if (bVisible)
+			{
+				UPortalVisibilityData::SetBit(sampledRegionBits, wordsPerRow, cellIndex, portalIndex);
+			}
+		}
+	});
+
+	/*
+	 * Any finite number of viewpoints can miss a narrow line of sight, and the runtime looks the camera's region up from a single point.
+	 * Each region also gets the bits of its 26 neighbours, so a portal seen from anywhere near the region's boundary stays visible on both sides of it
+	 */
+	ParallelFor(numCells, [&](int32 cellIndex)
+	{
+		const FIntVector cell{ cellIndex % gridSize.X, (cellIndex / gridSize.X) % gridSize.Y, cellIndex / (gridSize.X * gridSize.Y) };
+		uint32* row{ &visibilityData->regionBits[cellIndex * wordsPerRow] };
+		for (int32 z = FMath::Max(cell.Z - 1, 0); z <= FMath::Min(cell.Z + 1, gridSize.Z - 1); ++z)
+		{
+			for (int32 y = FMath::Max(cell.Y - 1, 0); y <= FMath::Min(cell.Y + 1, gridSize.Y - 1); ++y)
+			{
+				for (int32 x = FMath::Max(cell.X - 1, 0); x <= FMath::Min(cell.X + 1, gridSize.X - 1); ++x)
+				{
+					const uint32* neighbourRow{ &sampledRegionBits[((z * gridSize.Y + y) * gridSize.X + x) * wordsPerRow] };
+					for (int32 word = 0; word < wordsPerRow; ++word)
+					{
+						row[word] |= neighbourRow[word];
+					}
+				}
+			}
+		}
+	});
+
+	//Through a portal the capture looks out of its target's front side, so a portal is visible through it if it can be seen from the target's surface
+	ParallelFor(portals.Num(), [&](int32 throughIndex)
+	{
+		const int32 targetIndex{ portals.IndexOfByKey(portals[throughIndex]->GetPortalTarget()) };
+		if (targetIndex == INDEX_NONE)
+		{
+			return;
+		}
+
+		const FPortalRect& targetRect{ portalRects[targetIndex] };
+		for (int32 portalIndex = 0; portalIndex < portals.Num(); ++portalIndex)
+		{
+			const FPortalRect& portalRect{ portalRects[portalIndex] };
+			bool bVisible{ false };
+			for (const FVector& targetPoint : portalSurfacePoints[targetIndex])
+			{
+				if (bVisible || !isInFront(portalRect, targetPoint))
+				{
+					continue;
+				}
+
+				for (const FVector& surfacePoint : portalSurfacePoints[portalIndex])
+				{
+					if (isInFront(targetRect, surfacePoint) && isUnobstructed(targetPoint, surfacePoint))
+					{
+						bVisible = true;
+						break;
+					}
+				}
+			}
+
+			if (bVisible)
+			{
+				UPortalVisibilityData::SetBit(visibilityData->throughBits, wordsPerRow, throughIndex, portalIndex);
+			}
+		}
+	});
+
+	UE_LOG(LogPortalVisibility, Display, TEXT("Baked %s in %.1f s, %d KB of visibility bits"), *mapPackageName, FPlatformTime::Seconds() - startTime,
+		(visibilityData->regionBits.Num() + visibilityData->throughBits.Num()) * static_cast<int32>(sizeof(uint32)) / 1024);
+
+	const bool bSaved{ SaveVisibilityData(visibilityData) };
+	world->RemoveFromRoot();
+	return bSaved;
+}
+
+bool UPortalVisibilityBakeCommandlet::SaveVisibilityData(UPortalVisibilityData* visibilityData)
+{
+#if WITH_EDITOR
+	UPackage* dataPackage{ visibilityData->GetOutermost() };
+	dataPackage->MarkPackageDirty();
+	const FString fileName{ FPackageName::LongPackageNameToFilename(dataPackage->GetName(), FPackageName::GetAssetPackageExtension()) };
+	if (!UPackage::SavePackage(dataPackage, visibilityData, RF_Public | RF_Standalone, *fileName, GError, nullptr, false, true, SAVE_NoError))
+	{
+		UE_LOG(LogPortalVisibility, Error, TEXT("Couldn't save %s"), *fileName);
+		return false;
+	}
+
+	UE_LOG(LogPortalVisibility, Display, TEXT("Saved %s"), *fileName);
+	return true;
+#else
+	UE_LOG(LogPortalVisibility, Error, TEXT("Portal visibility can only be saved by an editor build"));
+	return false;
+#endif
+}
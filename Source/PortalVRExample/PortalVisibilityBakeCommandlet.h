@@ -0,0 +1,36 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PortalVisibilityBakeCommandlet.generated.h"
+
+/*
+ * Bakes the portal potentially visible set of maps into their UPortalVisibilityData assets. Needs no rendering, so it runs headless on a build machine:
+ * UE4Editor-Cmd PortalVRExample.uproject -run=PortalVisibilityBake -Map=/Game/Maps/MapA,/Game/Maps/MapB [-CellSize=400] [-ViewDistance=5000] [-RegionSamples=8] [-SurfaceSamples=3] -nullrhi -unattended
+ */
+UCLASS()
+class UPortalVisibilityBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UPortalVisibilityBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+
+	//Size (in world units) of a grid region and how far (in world units) around the portals the grid reaches
+	float cellSize;
+	float viewDistance;
+	//Viewpoints per region (its center and random points, its eight corners are added on top) and viewpoints along each axis of a portal's surface
+	int32 regionSamples;
+	int32 surfaceSamples;
+
+	//Loads the map, traces the visibility between its regions and portals and saves the result next to it
+	bool BakeMap(const FString& mapPackageName);
+
+	//Saves the visibility data's package to disk
+	bool SaveVisibilityData(class UPortalVisibilityData* visibilityData);
+};
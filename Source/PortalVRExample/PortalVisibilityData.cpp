@@ -0,0 +1,50 @@
+#include "PortalVisibilityData.h"
+
+#include "Engine/World.h"
+
+UPortalVisibilityData::UPortalVisibilityData()
+	:gridOrigin{ ForceInitToZero }, cellSize{ 0.0f }, gridSize{ ForceInitToZero }
+{
+}
+
+FString UPortalVisibilityData::GetPackageNameForMap(const FString& mapPackageName)
+{
+	//PIE worlds live in a renamed copy of the map's package
+	return UWorld::RemovePIEPrefix(mapPackageName) + TEXT("_PortalVisibility");
+}
+
+int32 UPortalVisibilityData::GetCellIndex(const FVector& location) const
+{
+	if (cellSize <= 0.0f)
+	{
+		return INDEX_NONE;
+	}
+
+	const FVector cell{ (location - gridOrigin) / cellSize };
+	const int32 x{ FMath::FloorToInt(cell.X) };
+	const int32 y{ FMath::FloorToInt(cell.Y) };
+	const int32 z{ FMath::FloorToInt(cell.Z) };
+	if (x < 0 || y < 0 || z < 0 || x >= gridSize.X || y >= gridSize.Y || z >= gridSize.Z)
+	{
+		return INDEX_NONE;
+	}
+
+	return x + gridSize.X * (y + gridSize.Y * z);
+}
+
+void UPortalVisibilityData::Reset(const TArray<FName>& inPortalNames, const FVector& inGridOrigin, float inCellSize, const FIntVector& inGridSize)
+{
+	portalNames = inPortalNames;
+	gridOrigin = inGridOrigin;
+	cellSize = inCellSize;
+	gridSize = inGridSize;
+
+	const int32 wordsPerRow{ GetWordsPerRow() };
+	regionBits.Init(0, gridSize.X * gridSize.Y * gridSize.Z * wordsPerRow);
+	throughBits.Init(0, portalNames.Num() * wordsPerRow);
+}
+
+void UPortalVisibilityData::SetBit(TArray<uint32>& bits, int32 wordsPerRow, int32 row, int32 portalIndex)
+{
+	bits[row * wordsPerRow + (portalIndex >> 5)] |= 1u << (portalIndex & 31);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "PortalVisibilityData.generated.h"
+
+/*
+ * Potentially visible set of a level's portals, baked offline by the "PortalVisibilityBake" commandlet and stored next to the map as "<Map>_PortalVisibility".
+ * The level is split into a grid of regions, each region has a row of bits telling which portals can be seen from anywhere inside it,
+ * and each portal has a row of bits telling which portals can be seen through it. A portal's bit is its index in portalNames.
+ * Only static geometry occludes, so a cleared bit means the portal can never be seen and the portal manager culls it without any further test
+ */
+UCLASS()
+class PORTALVREXAMPLE_API UPortalVisibilityData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	//Names of the level's portal actors in bit order
+	UPROPERTY(VisibleAnywhere, Category = "Portal Visibility")
+	TArray<FName> portalNames;
+
+	//Minimum corner of the region grid, the size of its cubic cells and the number of cells along each axis
+	UPROPERTY(VisibleAnywhere, Category = "Portal Visibility")
+	FVector gridOrigin;
+	UPROPERTY(VisibleAnywhere, Category = "Portal Visibility")
+	float cellSize;
+	UPROPERTY(VisibleAnywhere, Category = "Portal Visibility")
+	FIntVector gridSize;
+
+	//One row of GetWordsPerRow() words per grid cell, X fastest, then Y, then Z
+	UPROPERTY()
+	TArray<uint32> regionBits;
+
+	//One row of GetWordsPerRow() words per portal, the portals seen through the portal's target
+	UPROPERTY()
+	TArray<uint32> throughBits;
+
+	UPortalVisibilityData();
+
+	//Package the visibility data of the map is saved to and loaded from
+	static FString GetPackageNameForMap(const FString& mapPackageName);
+
+	int32 GetWordsPerRow() const { return FMath::DivideAndRoundUp(portalNames.Num(), 32); }
+
+	//Index of the grid cell containing the location, INDEX_NONE outside the grid
+	int32 GetCellIndex(const FVector& location) const;
+
+	//Whether the portal can be seen from somewhere in the grid cell
+	bool IsVisibleFromCell(int32 cellIndex, int32 portalIndex) const { return TestBit(regionBits, cellIndex, portalIndex); }
+
+	//Whether the portal can be seen through the other portal
+	bool IsVisibleThrough(int32 throughPortalIndex, int32 portalIndex) const { return TestBit(throughBits, throughPortalIndex, portalIndex); }
+
+	//Sizes the grid and clears every bit, used by the bake
+	void Reset(const TArray<FName>& inPortalNames, const FVector& inGridOrigin, float inCellSize, const FIntVector& inGridSize);
+
+	static void SetBit(TArray<uint32>& bits, int32 wordsPerRow, int32 row, int32 portalIndex);
+
+private:
+
+	bool TestBit(const TArray<uint32>& bits, int32 row, int32 portalIndex) const
+	{
+		return (bits[row * GetWordsPerRow() + (portalIndex >> 5)] & (1u << (portalIndex & 31))) != 0;
+	}
+};
@@ -0,0 +1,116 @@
+#include "PortalVisibilityData.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "UObject/Package.h"
+
+/*
+ * Automation tests of the baked portal visibility ("Automation RunTests PortalVR.Visibility"), they only need the engine.
+ * The test data has 40 portals, so every row takes two words and the bits 31 and 32 are in different words
+ */
+
+static constexpr int32 TestPortalCount{ 40 };
+
+static UPortalVisibilityData* MakeTestVisibilityData()
+{
+	TArray<FName> portalNames;
+	for (int32 index = 0; index < TestPortalCount; ++index)
+	{
+		portalNames.Add(*FString::Printf(TEXT("Portal%d"), index));
+	}
+
+	//3 x 2 x 2 cells of 100 units, the grid's minimum corner off the world origin
+	UPortalVisibilityData* visibilityData{ NewObject<UPortalVisibilityData>(GetTransientPackage()) };
+	visibilityData->Reset(portalNames, FVector{ -100.0f, -200.0f, 50.0f }, 100.0f, FIntVector{ 3, 2, 2 });
+	return visibilityData;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalVisibilityCellIndexTest, "PortalVR.Visibility.CellIndex", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalVisibilityCellIndexTest::RunTest(const FString& Parameters)
+{
+	UPortalVisibilityData* visibilityData{ MakeTestVisibilityData() };
+	const FVector& origin{ visibilityData->gridOrigin };
+	const FIntVector& gridSize{ visibilityData->gridSize };
+
+	//The center of every cell gives back its index, X fastest, then Y, then Z
+	for (int32 z = 0; z < gridSize.Z; ++z)
+	{
+		for (int32 y = 0; y < gridSize.Y; ++y)
+		{
+			for (int32 x = 0; x < gridSize.X; ++x)
+			{
+				const FVector center{ origin + (FVector{ static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) } + 0.5f) * visibilityData->cellSize };
+				TestEqual(FString::Printf(TEXT("The center of cell (%d, %d, %d) is in it"), x, y, z), visibilityData->GetCellIndex(center), x + gridSize.X * (y + gridSize.Y * z));
+			}
+		}
+	}
+
+	//A location on the boundary between two cells belongs to the upper one, the grid's minimum corner to the first cell
+	TestEqual(TEXT("The grid's minimum corner is in the first cell"), visibilityData->GetCellIndex(origin), 0);
+	TestEqual(TEXT("The boundary along X is in the upper cell"), visibilityData->GetCellIndex(origin + FVector{ 100.0f, 0.0f, 0.0f }), 1);
+	TestEqual(TEXT("The boundary along Y is in the upper cell"), visibilityData->GetCellIndex(origin + FVector{ 0.0f, 100.0f, 0.0f }), 3);
+	TestEqual(TEXT("The boundary along Z is in the upper cell"), visibilityData->GetCellIndex(origin + FVector{ 0.0f, 0.0f, 100.0f }), 6);
+	TestEqual(TEXT("Right below the grid's maximum corner is in the last cell"), visibilityData->GetCellIndex(origin + FVector{ 299.9f, 199.9f, 199.9f }), 11);
+
+	//The grid's maximum faces and anything below its minimum are outside
+	TestEqual(TEXT("The maximum X face is outside"), visibilityData->GetCellIndex(origin + FVector{ 300.0f, 50.0f, 50.0f }), INDEX_NONE);
+	TestEqual(TEXT("The maximum Y face is outside"), visibilityData->GetCellIndex(origin + FVector{ 50.0f, 200.0f, 50.0f }), INDEX_NONE);
+	TestEqual(TEXT("The maximum Z face is outside"), visibilityData->GetCellIndex(origin + FVector{ 50.0f, 50.0f, 200.0f }), INDEX_NONE);
+	TestEqual(TEXT("Right below the minimum X face is outside"), visibilityData->GetCellIndex(origin + FVector{ -0.1f, 50.0f, 50.0f }), INDEX_NONE);
+	TestEqual(TEXT("Right below the minimum Y face is outside"), visibilityData->GetCellIndex(origin + FVector{ 50.0f, -0.1f, 50.0f }), INDEX_NONE);
+	TestEqual(TEXT("Right below the minimum Z face is outside"), visibilityData->GetCellIndex(origin + FVector{ 50.0f, 50.0f, -0.1f }), INDEX_NONE);
+
+	//Data that was never baked has no grid
+	UPortalVisibilityData* emptyData{ NewObject<UPortalVisibilityData>(GetTransientPackage()) };
+	TestEqual(TEXT("Without a grid every location is outside"), emptyData->GetCellIndex(FVector::ZeroVector), INDEX_NONE);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalVisibilityBitsTest, "PortalVR.Visibility.Bits", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalVisibilityBitsTest::RunTest(const FString& Parameters)
+{
+	UPortalVisibilityData* visibilityData{ MakeTestVisibilityData() };
+	const int32 wordsPerRow{ visibilityData->GetWordsPerRow() };
+	TestEqual(TEXT("40 portals take two words per row"), wordsPerRow, 2);
+	TestEqual(TEXT("Every cell has a row"), visibilityData->regionBits.Num(), 12 * wordsPerRow);
+	TestEqual(TEXT("Every portal has a row"), visibilityData->throughBits.Num(), TestPortalCount * wordsPerRow);
+
+	//Every bit set on its own is read back for its row and portal only
+	const int32 cellIndex{ 4 };
+	const int32 throughPortalIndex{ 33 };
+	for (int32 portalIndex = 0; portalIndex < TestPortalCount; ++portalIndex)
+	{
+		visibilityData->regionBits.Init(0, visibilityData->regionBits.Num());
+		visibilityData->throughBits.Init(0, visibilityData->throughBits.Num());
+		UPortalVisibilityData::SetBit(visibilityData->regionBits, wordsPerRow, cellIndex, portalIndex);
+		UPortalVisibilityData::SetBit(visibilityData->throughBits, wordsPerRow, throughPortalIndex, portalIndex);
+
+		bool bOnlyFromCell{ true };
+		bool bOnlyThrough{ true };
+		for (int32 otherIndex = 0; otherIndex < TestPortalCount; ++otherIndex)
+		{
+			bOnlyFromCell &= visibilityData->IsVisibleFromCell(cellIndex, otherIndex) == (otherIndex == portalIndex);
+			bOnlyFromCell &= !visibilityData->IsVisibleFromCell(cellIndex + 1, otherIndex) && !visibilityData->IsVisibleFromCell(cellIndex - 1, otherIndex);
+			bOnlyThrough &= visibilityData->IsVisibleThrough(throughPortalIndex, otherIndex) == (otherIndex == portalIndex);
+			bOnlyThrough &= !visibilityData->IsVisibleThrough(throughPortalIndex + 1, otherIndex) && !visibilityData->IsVisibleThrough(throughPortalIndex - 1, otherIndex);
+		}
+		TestTrue(FString::Printf(TEXT("Portal %d is only visible from its cell"), portalIndex), bOnlyFromCell);
+		TestTrue(FString::Printf(TEXT("Portal %d is only visible through its portal"), portalIndex), bOnlyThrough);
+	}
+
+	//The bits on both sides of the word boundary are the last bit of the row's first word and the first bit of its second word
+	visibilityData->regionBits.Init(0, visibilityData->regionBits.Num());
+	UPortalVisibilityData::SetBit(visibilityData->regionBits, wordsPerRow, cellIndex, 31);
+	UPortalVisibilityData::SetBit(visibilityData->regionBits, wordsPerRow, cellIndex, 32);
+	TestTrue(TEXT("Portal 31 is the first word's last bit"), visibilityData->regionBits[cellIndex * wordsPerRow] == 1u << 31);
+	TestTrue(TEXT("Portal 32 is the second word's first bit"), visibilityData->regionBits[cellIndex * wordsPerRow + 1] == 1u);
+	TestTrue(TEXT("Portals 31 and 32 are visible from the cell"), visibilityData->IsVisibleFromCell(cellIndex, 31) && visibilityData->IsVisibleFromCell(cellIndex, 32));
+	TestTrue(TEXT("Portals 30 and 33 are not"), !visibilityData->IsVisibleFromCell(cellIndex, 30) && !visibilityData->IsVisibleFromCell(cellIndex, 33));
+	return true;
+}
+
+#endif
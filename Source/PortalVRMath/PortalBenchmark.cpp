@@ -0,0 +1,73 @@
+#include "PortalBenchmark.h"
+
+#include "Containers/Ticker.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/App.h"
+
+static TUniquePtr<FPortalBenchmark> ActiveBenchmark;
+
+FPortalBenchmark::~FPortalBenchmark()
+{
+	if (tickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(tickerHandle);
+	}
+}
+
+void FPortalBenchmark::Start(TUniquePtr<FPortalBenchmark> benchmark)
+{
+	if (!benchmark.IsValid())
+	{
+		return;
+	}
+
+	//The running benchmark is destroyed before the new one exists, the benchmarks have the world to themselves while they run
+	ActiveBenchmark.Reset();
+	ActiveBenchmark = MoveTemp(benchmark);
+
+	//Benchmarks that can't run in the world complete in their constructor
+	ActiveBenchmark->bQuitWhenComplete = true;
+	if (ActiveBenchmark->bCompleted)
+	{
+		ActiveBenchmark->QuitIfUnattended();
+	}
+}
+
+void FPortalBenchmark::Stop()
+{
+	ActiveBenchmark.Reset();
+}
+
+void FPortalBenchmark::StartTicking()
+{
+	tickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FPortalBenchmark::TickBenchmark));
+}
+
+bool FPortalBenchmark::TickBenchmark(float deltaTime)
+{
+	//The ticker removes the delegate once it returns false, the handle mustn't be removed again
+	if (!Tick(deltaTime))
+	{
+		tickerHandle.Reset();
+		return false;
+	}
+	return true;
+}
+
+void FPortalBenchmark::Complete(bool bInSucceeded)
+{
+	bCompleted = true;
+	bCompletedSuccessfully = bInSucceeded;
+	if (bQuitWhenComplete)
+	{
+		QuitIfUnattended();
+	}
+}
+
+void FPortalBenchmark::QuitIfUnattended() const
+{
+	if (FApp::IsUnattended())
+	{
+		FPlatformMisc::RequestExitWithStatus(false, bCompletedSuccessfully ? 0 : 1);
+	}
+}
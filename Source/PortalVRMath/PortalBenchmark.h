@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+
+/*
+ * Base of the portal benchmarks run from the console. One benchmark runs at a time, starting one stops the one still running, which cleans up after itself in its destructor.
+ * A benchmark calls StartTicking() once it's set up and is then ticked once per engine frame on the core ticker, after the world ticked, until its Tick() returns false.
+ * When done it calls Complete(). A benchmark started from the console then quits headless CI runs (-unattended), with an error code if it failed so the CI job fails.
+ * Automation tests create the benchmark themselves and read its result instead
+ */
+class PORTALVRMATH_API FPortalBenchmark
+{
+public:
+
+	virtual ~FPortalBenchmark();
+
+	//Stops the running benchmark and starts the new one, a null benchmark (e.g. a usage error) leaves the running one alone
+	static void Start(TUniquePtr<FPortalBenchmark> benchmark);
+	static void Stop();
+
+	//Whether the benchmark called Complete(), and whether it succeeded
+	bool IsComplete() const { return bCompleted; }
+	bool HasSucceeded() const { return bCompletedSuccessfully; }
+
+protected:
+
+	FPortalBenchmark() = default;
+
+	void StartTicking();
+
+	//Called once per engine frame, returns false once the benchmark is done
+	virtual bool Tick(float deltaTime) = 0;
+
+	//Records the result, and ends a headless run with the benchmark if it was started from the console
+	void Complete(bool bInSucceeded);
+
+private:
+
+	FDelegateHandle tickerHandle;
+	bool bCompleted{ false };
+	bool bCompletedSuccessfully{ false };
+	bool bQuitWhenComplete{ false };
+
+	void QuitIfUnattended() const;
+
+	bool TickBenchmark(float deltaTime);
+};
+
+/*
+ * Console command starting a benchmark, the factory builds it from the command's arguments and world (null when run without one)
+ */
+class FPortalBenchmarkCommand : public FAutoConsoleCommandWithWorldAndArgs
+{
+public:
+
+	using FFactory = TFunction<TUniquePtr<FPortalBenchmark>(const TArray<FString>&, UWorld*)>;
+
+	FPortalBenchmarkCommand(const TCHAR* name, const TCHAR* help, FFactory factory)
+		:FAutoConsoleCommandWithWorldAndArgs{ name, help, FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([factory](const TArray<FString>& args, UWorld* world)
+		{
+			FPortalBenchmark::Start(factory(args, world));
+		}) }
+	{
+	}
+};
@@ -0,0 +1,323 @@
+#include "PortalMath.h"
+
+FPortalRect::FPortalRect()
+	:origin{ ForceInitToZero }, normal{ FVector::ForwardVector }, right{ FVector::RightVector }, up{ FVector::UpVector }, halfExtents{ ForceInitToZero }
+{
+}
+
+FPortalRect::FPortalRect(const FTransform& transform, const FVector2D& localHalfExtents)
+	:origin{ transform.GetLocation() }, normal{ transform.GetUnitAxis(EAxis::X) }, right{ transform.GetUnitAxis(EAxis::Y) }, up{ transform.GetUnitAxis(EAxis::Z) },
+	halfExtents{ localHalfExtents.X * transform.GetScale3D().Y, localHalfExtents.Y * transform.GetScale3D().Z }
+{
+}
+
+void FPortalVectorArray::SetNum(int32 num)
+{
+	X.SetNumUninitialized(num);
+	Y.SetNumUninitialized(num);
+	Z.SetNumUninitialized(num);
+}
+
+void FPortalVectorArray::Set(int32 index, const FVector& vector)
+{
+	X[index] = vector.X;
+	Y[index] = vector.Y;
+	Z[index] = vector.Z;
+}
+
+FVector FPortalVectorArray::Get(int32 index) const
+{
+	return FVector{ X[index], Y[index], Z[index] };
+}
+
+void FPortalVectorArray::Add(const FVector& vector)
+{
+	X.Add(vector.X);
+	Y.Add(vector.Y);
+	Z.Add(vector.Z);
+}
+
+void FPortalVectorArray::RemoveAtSwap(int32 index)
+{
+	X.RemoveAtSwap(index, 1, false);
+	Y.RemoveAtSwap(index, 1, false);
+	Z.RemoveAtSwap(index, 1, false);
+}
+
+void FPortalQuatArray::SetNum(int32 num)
+{
+	X.SetNumUninitialized(num);
+	Y.SetNumUninitialized(num);
+	Z.SetNumUninitialized(num);
+	W.SetNumUninitialized(num);
+}
+
+void FPortalQuatArray::Set(int32 index, const FQuat& quat)
+{
+	X[index] = quat.X;
+	Y[index] = quat.Y;
+	Z[index] = quat.Z;
+	W[index] = quat.W;
+}
+
+FQuat FPortalQuatArray::Get(int32 index) const
+{
+	return FQuat{ X[index], Y[index], Z[index], W[index] };
+}
+
+FMatrix FPortalMath::ComputeThroughMatrix(const FTransform& portalTransform, const FTransform& targetTransform)
+{
+	//World to local of this portal, flipped on the Yaw axis because the position should be mirrored for the other portal, then local to world of the target portal
+	return portalTransform.ToMatrixWithScale().Inverse() * FRotationMatrix{ FRotator{ 0.0f, 180.0f, 0.0f } } * targetTransform.ToMatrixWithScale();
+}
+
+void FPortalMath::TransformLocationRotation(const FMatrix& throughMatrix, const FTransform& transform, FVector& newLocation, FRotator& newRotation)
+{
+	const FMatrix worldMatrix{ transform.ToMatrixWithScale() * throughMatrix };
+	newLocation = worldMatrix.GetOrigin();
+	newRotation = worldMatrix.Rotator();
+}
+
+FVector FPortalMath::TransformDirection(const FMatrix& throughMatrix, const FVector& direction)
+{
+	return throughMatrix.GetMatrixWithoutScale().TransformVector(direction);
+}
+
+bool FPortalMath::SegmentCrossesPortal(const FPortalRect& portalRect, const FVector& start, const FVector& end)
+{
+	//Signed distances to the portal plane, the segment has to start in front of the portal (or on it) and end behind it
+	const float startDistance{ FVector::DotProduct(start - portalRect.origin, portalRect.normal) };
+	const float endDistance{ FVector::DotProduct(end - portalRect.origin, portalRect.normal) };
+	if (startDistance < 0.0f || endDistance >= 0.0f)
+	{
+		return false;
+	}
+
+	//Where the segment intersects the plane, relative to the portal's center, has to be within the portal's extents
+	const FVector intersection{ FMath::Lerp(start, end, startDistance / (startDistance - endDistance)) - portalRect.origin };
+	return FMath::Abs(FVector::DotProduct(intersection, portalRect.right)) <= portalRect.halfExtents.X && FMath::Abs(FVector::DotProduct(intersection, portalRect.up)) <= portalRect.halfExtents.Y;
+}
+
+bool FPortalMath::MakeObliqueProjection(const FMatrix& projectionMatrix, const FMatrix& viewMatrix, const FVector& planeBase, const FVector& planeNormal, FMatrix& outObliqueProjection)
+{
+	/*
+	 * Lengyel's oblique near plane adapted to UE4's row vector, reversed Z projections. With clip = v * M, column 2 is clip Z and column 3 is clip W,
+	 * and the near plane is the "W - Z >= 0" half space. Replacing column 2 with "column 3 - scale * plane" turns the near plane into our clip plane.
+	 * The far plane "Z >= 0" then becomes "scale * (plane . v) <= W", the scale is picked so that it stays outside every frustum corner direction
+	 */
+	const FVector viewNormal{ viewMatrix.TransformVector(planeNormal).GetSafeNormal() };
+	const FVector viewBase{ viewMatrix.TransformPosition(planeBase) };
+	const FPlane viewPlane{ viewNormal.X, viewNormal.Y, viewNormal.Z, -FVector::DotProduct(viewNormal, viewBase) };
+
+	//The camera has to be on the clipped side of the plane, otherwise the near plane would end up behind the camera
+	if (viewPlane.W > -KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	/*
+	 * View space frustum corner directions at depth 1 are (tangentX, tangentY, 1), with "ndc = M[0][0] * tangent + M[2][0]".
+	 * The corner furthest along the plane normal gives the largest "plane . direction", it has to be positive or the whole frustum lies behind the plane (grazing angles)
+	 */
+	if (FMath::IsNearlyZero(projectionMatrix.M[0][0]) || FMath::IsNearlyZero(projectionMatrix.M[1][1]))
+	{
+		return false;
+	}
+	const float cornerTangentX{ (FMath::Sign(viewPlane.X) - projectionMatrix.M[2][0]) / projectionMatrix.M[0][0] };
+	const float cornerTangentY{ (FMath::Sign(viewPlane.Y) - projectionMatrix.M[2][1]) / projectionMatrix.M[1][1] };
+	const float maxPlaneDistance{ viewPlane.X * cornerTangentX + viewPlane.Y * cornerTangentY + viewPlane.Z };
+	if (maxPlaneDistance <= KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const float scale{ 1.0f / maxPlaneDistance };
+	outObliqueProjection = projectionMatrix;
+	outObliqueProjection.M[0][2] = projectionMatrix.M[0][3] - scale * viewPlane.X;
+	outObliqueProjection.M[1][2] = projectionMatrix.M[1][3] - scale * viewPlane.Y;
+	outObliqueProjection.M[2][2] = projectionMatrix.M[2][3] - scale * viewPlane.Z;
+	outObliqueProjection.M[3][2] = projectionMatrix.M[3][3] - scale * viewPlane.W;
+	return true;
+}
+
+FMatrix FPortalMath::MakeViewRotationMatrix(const FRotator& rotation)
+{
+	return FInverseRotationMatrix{ rotation } * FMatrix{
+		FPlane{ 0.0f, 0.0f, 1.0f, 0.0f },
+		FPlane{ 1.0f, 0.0f, 0.0f, 0.0f },
+		FPlane{ 0.0f, 1.0f, 0.0f, 0.0f },
+		FPlane{ 0.0f, 0.0f, 0.0f, 1.0f } };
+}
+
+void FPortalMath::GetPoseDelta(const FTransform& pose, const FTransform& otherPose, float& outDistance, float& outAngleDegrees)
+{
+	outDistance = FVector::Distance(pose.GetLocation(), otherPose.GetLocation());
+	outAngleDegrees = FMath::RadiansToDegrees(pose.GetRotation().AngularDistance(otherPose.GetRotation()));
+}
+
+void FPortalMath::LateLatchThroughPortal(const FMatrix& throughMatrix, const FTransform& parentTransform, const FTransform& pose, const FTransform& latePose,
+	const FVector& location, const FRotator& rotation, FVector& outLocation, FRotator& outRotation)
+{
+	//The head's move in world space, taken to the exit side by going back through the portal, moving and coming through again
+	const FMatrix headMove{ (pose * parentTransform).ToMatrixNoScale().Inverse() * (latePose * parentTransform).ToMatrixNoScale() };
+	const FMatrix captureMatrix{ FRotationTranslationMatrix{ rotation, location } * throughMatrix.Inverse() * headMove * throughMatrix };
+	outLocation = captureMatrix.GetOrigin();
+	outRotation = captureMatrix.Rotator();
+}
+
+void FPortalMath::TransformPositions(const FMatrix& throughMatrix, const FPortalVectorArray& positions, FPortalVectorArray& outPositions)
+{
+	const int32 num{ positions.Num() };
+	outPositions.SetNum(num);
+
+	//Row vector convention: out = x * row0 + y * row1 + z * row2 + row3
+	VectorRegister m[4][3];
+	for (int32 row = 0; row < 4; ++row)
+	{
+		for (int32 column = 0; column < 3; ++column)
+		{
+			m[row][column] = VectorSetFloat1(throughMatrix.M[row][column]);
+		}
+	}
+
+	int32 index{ 0 };
+	for (; index + 4 <= num; index += 4)
+	{
+		const VectorRegister x{ VectorLoad(&positions.X[index]) };
+		const VectorRegister y{ VectorLoad(&positions.Y[index]) };
+		const VectorRegister z{ VectorLoad(&positions.Z[index]) };
+		VectorStore(VectorMultiplyAdd(x, m[0][0], VectorMultiplyAdd(y, m[1][0], VectorMultiplyAdd(z, m[2][0], m[3][0]))), &outPositions.X[index]);
+		VectorStore(VectorMultiplyAdd(x, m[0][1], VectorMultiplyAdd(y, m[1][1], VectorMultiplyAdd(z, m[2][1], m[3][1]))), &outPositions.Y[index]);
+		VectorStore(VectorMultiplyAdd(x, m[0][2], VectorMultiplyAdd(y, m[1][2], VectorMultiplyAdd(z, m[2][2], m[3][2]))), &outPositions.Z[index]);
+	}
+
+	for (; index < num; ++index)
+	{
+		outPositions.Set(index, throughMatrix.TransformPosition(positions.Get(index)));
+	}
+}
+
+void FPortalMath::TransformDirections(const FMatrix& throughMatrix, const FPortalVectorArray& directions, FPortalVectorArray& outDirections)
+{
+	const int32 num{ directions.Num() };
+	outDirections.SetNum(num);
+
+	//Same as positions without the translation row, and without the portals' scale
+	const FMatrix rotationMatrix{ throughMatrix.GetMatrixWithoutScale() };
+	VectorRegister m[3][3];
+	for (int32 row = 0; row < 3; ++row)
+	{
+		for (int32 column = 0; column < 3; ++column)
+		{
+			m[row][column] = VectorSetFloat1(rotationMatrix.M[row][column]);
+		}
+	}
+
+	int32 index{ 0 };
+	for (; index + 4 <= num; index += 4)
+	{
+		const VectorRegister x{ VectorLoad(&directions.X[index]) };
+		const VectorRegister y{ VectorLoad(&directions.Y[index]) };
+		const VectorRegister z{ VectorLoad(&directions.Z[index]) };
+		VectorStore(VectorMultiplyAdd(x, m[0][0], VectorMultiplyAdd(y, m[1][0], VectorMultiply(z, m[2][0]))), &outDirections.X[index]);
+		VectorStore(VectorMultiplyAdd(x, m[0][1], VectorMultiplyAdd(y, m[1][1], VectorMultiply(z, m[2][1]))), &outDirections.Y[index]);
+		VectorStore(VectorMultiplyAdd(x, m[0][2], VectorMultiplyAdd(y, m[1][2], VectorMultiply(z, m[2][2]))), &outDirections.Z[index]);
+	}
+
+	for (; index < num; ++index)
+	{
+		outDirections.Set(index, rotationMatrix.TransformVector(directions.Get(index)));
+	}
+}
+
+void FPortalMath::TransformRotations(const FMatrix& throughMatrix, const FPortalQuatArray& rotations, FPortalQuatArray& outRotations)
+{
+	const int32 num{ rotations.Num() };
+	outRotations.SetNum(num);
+
+	//Rotation matrices are applied left to right, so the portal rotation comes after the input rotation: out = portal * in
+	const FQuat portalQuat{ throughMatrix.GetMatrixWithoutScale().ToQuat() };
+	const VectorRegister ax{ VectorSetFloat1(portalQuat.X) };
+	const VectorRegister ay{ VectorSetFloat1(portalQuat.Y) };
+	const VectorRegister az{ VectorSetFloat1(portalQuat.Z) };
+	const VectorRegister aw{ VectorSetFloat1(portalQuat.W) };
+
+	int32 index{ 0 };
+	for (; index + 4 <= num; index += 4)
+	{
+		const VectorRegister bx{ VectorLoad(&rotations.X[index]) };
+		const VectorRegister by{ VectorLoad(&rotations.Y[index]) };
+		const VectorRegister bz{ VectorLoad(&rotations.Z[index]) };
+		const VectorRegister bw{ VectorLoad(&rotations.W[index]) };
+
+		//Hamilton product, four quaternions at a time
+		VectorStore(VectorSubtract(VectorMultiplyAdd(aw, bx, VectorMultiplyAdd(ax, bw, VectorMultiply(ay, bz))), VectorMultiply(az, by)), &outRotations.X[index]);
+		VectorStore(VectorSubtract(VectorMultiplyAdd(aw, by, VectorMultiplyAdd(ay, bw, VectorMultiply(az, bx))), VectorMultiply(ax, bz)), &outRotations.Y[index]);
+		VectorStore(VectorSubtract(VectorMultiplyAdd(aw, bz, VectorMultiplyAdd(az, bw, VectorMultiply(ax, by))), VectorMultiply(ay, bx)), &outRotations.Z[index]);
+		VectorStore(VectorSubtract(VectorMultiply(aw, bw), VectorMultiplyAdd(ax, bx, VectorMultiplyAdd(ay, by, VectorMultiply(az, bz)))), &outRotations.W[index]);
+	}
+
+	for (; index < num; ++index)
+	{
+		outRotations.Set(index, portalQuat * rotations.Get(index));
+	}
+}
+
+void FPortalMath::SegmentsCrossPortal(const FPortalRect& portalRect, const FPortalVectorArray& starts, const FPortalVectorArray& ends, TArray<bool>& outCrossed)
+{
+	check(starts.Num() == ends.Num());
+	const int32 num{ starts.Num() };
+	outCrossed.SetNumUninitialized(num);
+
+	const VectorRegister nx{ VectorSetFloat1(portalRect.normal.X) }, ny{ VectorSetFloat1(portalRect.normal.Y) }, nz{ VectorSetFloat1(portalRect.normal.Z) };
+	const VectorRegister rx{ VectorSetFloat1(portalRect.right.X) }, ry{ VectorSetFloat1(portalRect.right.Y) }, rz{ VectorSetFloat1(portalRect.right.Z) };
+	const VectorRegister ux{ VectorSetFloat1(portalRect.up.X) }, uy{ VectorSetFloat1(portalRect.up.Y) }, uz{ VectorSetFloat1(portalRect.up.Z) };
+	const VectorRegister originDistance{ VectorSetFloat1(FVector::DotProduct(portalRect.origin, portalRect.normal)) };
+	const VectorRegister originRight{ VectorSetFloat1(FVector::DotProduct(portalRect.origin, portalRect.right)) };
+	const VectorRegister originUp{ VectorSetFloat1(FVector::DotProduct(portalRect.origin, portalRect.up)) };
+	const VectorRegister halfExtentX{ VectorSetFloat1(portalRect.halfExtents.X) };
+	const VectorRegister halfExtentY{ VectorSetFloat1(portalRect.halfExtents.Y) };
+	const VectorRegister zero{ VectorZero() };
+
+	auto dot = [](const VectorRegister& x, const VectorRegister& y, const VectorRegister& z, const VectorRegister& ax, const VectorRegister& ay, const VectorRegister& az, const VectorRegister& offset)
+	{
+		return VectorSubtract(VectorMultiplyAdd(x, ax, VectorMultiplyAdd(y, ay, VectorMultiply(z, az))), offset);
+	};
+
+	int32 index{ 0 };
+	for (; index + 4 <= num; index += 4)
+	{
+		const VectorRegister sx{ VectorLoad(&starts.X[index]) }, sy{ VectorLoad(&starts.Y[index]) }, sz{ VectorLoad(&starts.Z[index]) };
+		const VectorRegister ex{ VectorLoad(&ends.X[index]) }, ey{ VectorLoad(&ends.Y[index]) }, ez{ VectorLoad(&ends.Z[index]) };
+
+		const VectorRegister startDistance{ dot(sx, sy, sz, nx, ny, nz, originDistance) };
+		const VectorRegister endDistance{ dot(ex, ey, ez, nx, ny, nz, originDistance) };
+		const VectorRegister startRight{ dot(sx, sy, sz, rx, ry, rz, originRight) };
+		const VectorRegister endRight{ dot(ex, ey, ez, rx, ry, rz, originRight) };
+		const VectorRegister startUp{ dot(sx, sy, sz, ux, uy, uz, originUp) };
+		const VectorRegister endUp{ dot(ex, ey, ez, ux, uy, uz, originUp) };
+
+		/*
+		 * With t = startDistance / denominator the intersection is "start + t * (end - start)". Multiplying the extent tests by the (positive) denominator
+		 * avoids the division: |startRight * denominator + startDistance * (endRight - startRight)| <= halfExtentX * denominator
+		 */
+		const VectorRegister denominator{ VectorSubtract(startDistance, endDistance) };
+		const VectorRegister intersectionRight{ VectorMultiplyAdd(startRight, denominator, VectorMultiply(startDistance, VectorSubtract(endRight, startRight))) };
+		const VectorRegister intersectionUp{ VectorMultiplyAdd(startUp, denominator, VectorMultiply(startDistance, VectorSubtract(endUp, startUp))) };
+
+		VectorRegister crossed{ VectorBitwiseAnd(VectorCompareGE(startDistance, zero), VectorCompareGT(zero, endDistance)) };
+		crossed = VectorBitwiseAnd(crossed, VectorCompareGE(VectorMultiply(halfExtentX, denominator), VectorAbs(intersectionRight)));
+		crossed = VectorBitwiseAnd(crossed, VectorCompareGE(VectorMultiply(halfExtentY, denominator), VectorAbs(intersectionUp)));
+
+		const int32 mask{ VectorMaskBits(crossed) };
+		outCrossed[index] = (mask & 1) != 0;
+		outCrossed[index + 1] = (mask & 2) != 0;
+		outCrossed[index + 2] = (mask & 4) != 0;
+		outCrossed[index + 3] = (mask & 8) != 0;
+	}
+
+	for (; index < num; ++index)
+	{
+		outCrossed[index] = SegmentCrossesPortal(portalRect, starts.Get(index), ends.Get(index));
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * UObject free portal math. Everything here only depends on Core so it can run without a world, and the batch functions work on struct of arrays input
+ * so four elements are processed per SIMD register (VectorRegister)
+ */
+
+//World space rectangle of a portal's surface. The portal faces along its normal and the half extents are along the right and up axes
+struct PORTALVRMATH_API FPortalRect
+{
+	FVector origin;
+	FVector normal;
+	FVector right;
+	FVector up;
+	FVector2D halfExtents;
+
+	FPortalRect();
+
+	//Axes come from the transform's rotation, the local half extents (Y and Z of the portal mesh's bounding box) are scaled by the transform's scale
+	FPortalRect(const FTransform& transform, const FVector2D& localHalfExtents);
+};
+
+//Struct of arrays of vectors, each component is contiguous in memory
+struct PORTALVRMATH_API FPortalVectorArray
+{
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+
+	int32 Num() const { return X.Num(); }
+	void SetNum(int32 num);
+	void Set(int32 index, const FVector& vector);
+	FVector Get(int32 index) const;
+	void Add(const FVector& vector);
+	void RemoveAtSwap(int32 index);
+};
+
+//Struct of arrays of quaternions, each component is contiguous in memory
+struct PORTALVRMATH_API FPortalQuatArray
+{
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+	TArray<float> W;
+
+	int32 Num() const { return X.Num(); }
+	void SetNum(int32 num);
+	void Set(int32 index, const FQuat& quat);
+	FQuat Get(int32 index) const;
+};
+
+struct PORTALVRMATH_API FPortalMath
+{
+	/*
+	 * Matrix taking a world transform relative to the portal to the mirrored transform relative to the target/exit portal.
+	 * Only changes when either portal moves, so it should be computed once and cached instead of per conversion
+	 */
+	static FMatrix ComputeThroughMatrix(const FTransform& portalTransform, const FTransform& targetTransform);
+
+	//Location and rotation of a world transform once it went through the portal
+	static void TransformLocationRotation(const FMatrix& throughMatrix, const FTransform& transform, FVector& newLocation, FRotator& newRotation);
+
+	//Direction (velocity) through the portal, scale of the portals is ignored
+	static FVector TransformDirection(const FMatrix& throughMatrix, const FVector& direction);
+
+	//Whether the segment goes through the portal rectangle from its front side to its back side
+	static bool SegmentCrossesPortal(const FPortalRect& portalRect, const FVector& start, const FVector& end);
+
+	/*
+	 * Replaces a reversed Z projection's near plane with the given world space plane (as seen through the view matrix), everything behind the plane is clipped.
+	 * Returns false at degenerate angles where that isn't possible: the camera not in front of the plane's clipped side, the whole frustum behind the plane (grazing angles) or a degenerate projection
+	 */
+	static bool MakeObliqueProjection(const FMatrix& projectionMatrix, const FMatrix& viewMatrix, const FVector& planeBase, const FVector& planeNormal, FMatrix& outObliqueProjection);
+
+	//World to view rotation of a camera with the rotation, including UE4's swap from X forward to Z forward view space (X right, Y up, Z forward). This is a scene view's ViewRotationMatrix
+	static FMatrix MakeViewRotationMatrix(const FRotator& rotation);
+
+	//Distance and angle (in degrees) between two poses, scale is ignored
+	static void GetPoseDelta(const FTransform& pose, const FTransform& otherPose, float& outDistance, float& outAngleDegrees);
+
+	/*
+	 * Moves a capture camera placed through the portal from a head pose along with the head's move to a newer pose, as the camera would be if it was placed from the newer pose.
+	 * The poses are relative to the parent transform (tracking space under the VR origin)
+	 */
+	static void LateLatchThroughPortal(const FMatrix& throughMatrix, const FTransform& parentTransform, const FTransform& pose, const FTransform& latePose,
+		const FVector& location, const FRotator& rotation, FVector& outLocation, FRotator& outRotation);
+
+	//Batch versions, output arrays are resized to match the input and can be the input arrays themselves
+	static void TransformPositions(const FMatrix& throughMatrix, const FPortalVectorArray& positions, FPortalVectorArray& outPositions);
+	static void TransformDirections(const FMatrix& throughMatrix, const FPortalVectorArray& directions, FPortalVectorArray& outDirections);
+	static void TransformRotations(const FMatrix& throughMatrix, const FPortalQuatArray& rotations, FPortalQuatArray& outRotations);
+	static void SegmentsCrossPortal(const FPortalRect& portalRect, const FPortalVectorArray& starts, const FPortalVectorArray& ends, TArray<bool>& outCrossed);
+};
@@ -0,0 +1,143 @@
+#include "PortalBenchmark.h"
+#include "PortalMath.h"
+
+#include "Math/RandomStream.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPortalMath, Log, All);
+
+/*
+ * Microbenchmark of the portal math, doesn't need a world so it can run from any console ("Portal.Bench.Math [count]").
+ * Compares the per call matrix building the portals used to do against the cached through matrix and the batch functions, and reports the largest difference between them.
+ * It fails if the batch results don't match the scalar ones
+ */
+class FPortalMathBenchmark : public FPortalBenchmark
+{
+public:
+
+	explicit FPortalMathBenchmark(int32 inCount);
+
+private:
+
+	int32 count;
+
+	virtual bool Tick(float deltaTime) override;
+};
+
+FPortalMathBenchmark::FPortalMathBenchmark(int32 inCount)
+	:count{ inCount }
+{
+	StartTicking();
+}
+
+bool FPortalMathBenchmark::Tick(float deltaTime)
+{
+	FRandomStream random{ 0x504f5254 };
+
+	const FTransform portalTransform{ FRotator{ 0.0f, 30.0f, 0.0f }, FVector{ 100.0f, 200.0f, 0.0f } };
+	const FTransform targetTransform{ FRotator{ 0.0f, -75.0f, 0.0f }, FVector{ -400.0f, 50.0f, 100.0f } };
+	const FPortalRect portalRect{ portalTransform, FVector2D{ 100.0f, 150.0f } };
+
+	TArray<FTransform> transforms;
+	FPortalVectorArray positions, velocities, segmentEnds;
+	FPortalQuatArray rotations;
+	transforms.SetNum(count);
+	positions.SetNum(count);
+	velocities.SetNum(count);
+	segmentEnds.SetNum(count);
+	rotations.SetNum(count);
+	for (int32 index = 0; index < count; ++index)
+	{
+		const FVector location{ portalTransform.GetLocation() + random.GetUnitVector() * random.FRandRange(0.0f, 300.0f) };
+		const FQuat rotation{ FRotator{ random.FRandRange(-90.0f, 90.0f), random.FRandRange(-180.0f, 180.0f), random.FRandRange(-180.0f, 180.0f) } };
+		transforms[index] = FTransform{ rotation, location };
+		positions.Set(index, location);
+		rotations.Set(index, rotation);
+		velocities.Set(index, random.GetUnitVector() * 300.0f);
+		segmentEnds.Set(index, location + random.GetUnitVector() * 50.0f);
+	}
+
+	TArray<FVector> legacyLocations;
+	TArray<FQuat> legacyRotations;
+	legacyLocations.SetNum(count);
+	legacyRotations.SetNum(count);
+
+	//What ConvertLocationRotationToPortal() used to do on every call
+	double startTime{ FPlatformTime::Seconds() };
+	for (int32 index = 0; index < count; ++index)
+	{
+		FMatrix matrix{ transforms[index].ToMatrixWithScale() * portalTransform.ToMatrixWithScale().Inverse() };
+		matrix *= FRotationMatrix{ FRotator{ 0.0f, 180.0f, 0.0f } };
+		matrix = matrix * targetTransform.ToMatrixWithScale();
+		legacyLocations[index] = matrix.GetOrigin();
+		legacyRotations[index] = matrix.ToQuat();
+	}
+	const double legacyTime{ FPlatformTime::Seconds() - startTime };
+
+	const FMatrix throughMatrix{ FPortalMath::ComputeThroughMatrix(portalTransform, targetTransform) };
+	startTime = FPlatformTime::Seconds();
+	for (int32 index = 0; index < count; ++index)
+	{
+		FVector newLocation;
+		FRotator newRotation;
+		FPortalMath::TransformLocationRotation(throughMatrix, transforms[index], newLocation, newRotation);
+	}
+	const double cachedTime{ FPlatformTime::Seconds() - startTime };
+
+	FPortalVectorArray outPositions, outVelocities;
+	FPortalQuatArray outRotations;
+	startTime = FPlatformTime::Seconds();
+	FPortalMath::TransformPositions(throughMatrix, positions, outPositions);
+	FPortalMath::TransformRotations(throughMatrix, rotations, outRotations);
+	FPortalMath::TransformDirections(throughMatrix, velocities, outVelocities);
+	const double batchTime{ FPlatformTime::Seconds() - startTime };
+
+	TArray<bool> scalarCrossed, batchCrossed;
+	scalarCrossed.SetNum(count);
+	startTime = FPlatformTime::Seconds();
+	for (int32 index = 0; index < count; ++index)
+	{
+		scalarCrossed[index] = FPortalMath::SegmentCrossesPortal(portalRect, positions.Get(index), segmentEnds.Get(index));
+	}
+	const double scalarCrossingTime{ FPlatformTime::Seconds() - startTime };
+
+	startTime = FPlatformTime::Seconds();
+	FPortalMath::SegmentsCrossPortal(portalRect, positions, segmentEnds, batchCrossed);
+	const double batchCrossingTime{ FPlatformTime::Seconds() - startTime };
+
+	//Batch results have to match the scalar ones (quaternions q and -q are the same rotation)
+	float maxLocationError{ 0.0f };
+	float maxRotationError{ 0.0f };
+	int32 crossingMismatches{ 0 };
+	int32 crossings{ 0 };
+	for (int32 index = 0; index < count; ++index)
+	{
+		maxLocationError = FMath::Max(maxLocationError, FVector::Dist(legacyLocations[index], outPositions.Get(index)));
+		maxRotationError = FMath::Max(maxRotationError, 1.0f - FMath::Abs(legacyRotations[index] | outRotations.Get(index)));
+		crossingMismatches += scalarCrossed[index] != batchCrossed[index] ? 1 : 0;
+		crossings += batchCrossed[index] ? 1 : 0;
+	}
+
+	UE_LOG(LogPortalMath, Display, TEXT("Portal math benchmark, %d elements"), count);
+	UE_LOG(LogPortalMath, Display, TEXT("  Legacy per call matrices : %8.3f ms"), legacyTime * 1000.0);
+	UE_LOG(LogPortalMath, Display, TEXT("  Cached through matrix    : %8.3f ms"), cachedTime * 1000.0);
+	UE_LOG(LogPortalMath, Display, TEXT("  Batch pos/rot/velocity   : %8.3f ms"), batchTime * 1000.0);
+	UE_LOG(LogPortalMath, Display, TEXT("  Scalar crossing tests    : %8.3f ms"), scalarCrossingTime * 1000.0);
+	UE_LOG(LogPortalMath, Display, TEXT("  Batch crossing tests     : %8.3f ms (%d crossings)"), batchCrossingTime * 1000.0, crossings);
+	UE_LOG(LogPortalMath, Display, TEXT("  Max location error %f, max rotation error %f, crossing mismatches %d"), maxLocationError, maxRotationError, crossingMismatches);
+
+	const bool bSucceeded{ maxLocationError < 0.01f && maxRotationError < 1.e-4f && crossingMismatches == 0 };
+	if (!bSucceeded)
+	{
+		UE_LOG(LogPortalMath, Error, TEXT("The batch portal math doesn't match the scalar version"));
+	}
+	Complete(bSucceeded);
+	return false;
+}
+
+static FPortalBenchmarkCommand PortalMathBenchmarkCommand(
+	TEXT("Portal.Bench.Math"),
+	TEXT("Benchmarks the portal transform and crossing math against the legacy per call version. Usage: Portal.Bench.Math [count]"),
+	[](const TArray<FString>& args, UWorld* world)
+	{
+		return MakeUnique<FPortalMathBenchmark>(args.Num() > 0 ? FMath::Max(FCString::Atoi(*args[0]), 4) : 100000);
+	});
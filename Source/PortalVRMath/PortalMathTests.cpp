@@ -0,0 +1,570 @@
+#include "PortalMath.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/*
+ * Automation tests of the portal math ("Automation RunTests PortalVR.Math"), they only need Core so they run in any build with the developer automation tests.
+ * The oblique projection tests use an identity view matrix, so world space is view space (X right, Y up, Z forward)
+ */
+
+//Symmetric 90 degree reversed Z projection with the near plane at 10 units, like the eye projections without their off-center part
+static FMatrix MakeTestProjection()
+{
+	return FReversedZPerspectiveMatrix{ HALF_PI * 0.5f, 1.0f, 1.0f, 10.0f };
+}
+
+static float GetNDCDepth(const FMatrix& projectionMatrix, const FVector& position)
+{
+	const FVector4 clipPosition{ projectionMatrix.TransformFVector4(FVector4{ position, 1.0f }) };
+	return clipPosition.Z / clipPosition.W;
+}
+
+//Where the ray from the camera (view space origin) along the direction hits the plane
+static FVector IntersectViewRay(const FVector& direction, const FVector& planeBase, const FVector& planeNormal)
+{
+	return direction * (FVector::DotProduct(planeBase, planeNormal) / FVector::DotProduct(direction, planeNormal));
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalObliqueProjectionPointOnPlaneTest, "PortalVR.Math.ObliqueProjection.PointOnPlane", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalObliqueProjectionPointOnPlaneTest::RunTest(const FString& Parameters)
+{
+	//Eye projections are off-center, very wide ones have a small but valid M[0][0]
+	FMatrix offCenterProjection{ MakeTestProjection() };
+	offCenterProjection.M[2][0] = 0.2f;
+	offCenterProjection.M[2][1] = -0.1f;
+	FMatrix wideProjection{ MakeTestProjection() };
+	wideProjection.M[0][0] = 0.001f;
+	const FMatrix projections[]{ MakeTestProjection(), offCenterProjection, wideProjection };
+
+	//A plane facing the camera head on and a tilted one, the camera is on their clipped side
+	const FVector planeBases[]{ FVector{ 0.0f, 0.0f, 100.0f }, FVector{ 5.0f, -5.0f, 120.0f } };
+	const FVector planeNormals[]{ FVector{ 0.0f, 0.0f, 1.0f }, FVector{ 0.3f, 0.2f, 1.0f }.GetSafeNormal() };
+	const FVector rayDirections[]{ FVector{ 0.0f, 0.0f, 1.0f }, FVector{ 0.5f, 0.3f, 1.0f }, FVector{ -0.7f, 0.6f, 1.0f }, FVector{ 0.9f, -0.9f, 1.0f } };
+
+	for (const FMatrix& projection : projections)
+	{
+		for (int32 planeIndex = 0; planeIndex < UE_ARRAY_COUNT(planeBases); ++planeIndex)
+		{
+			const FVector& planeBase{ planeBases[planeIndex] };
+			const FVector& planeNormal{ planeNormals[planeIndex] };
+			FMatrix obliqueProjection;
+			if (!TestTrue(TEXT("The oblique projection can be built"), FPortalMath::MakeObliqueProjection(projection, FMatrix::Identity, planeBase, planeNormal, obliqueProjection)))
+			{
+				continue;
+			}
+
+			//Reversed Z: the near plane is at NDC depth 1, visible depths go down to 0 at the far plane
+			for (const FVector& rayDirection : rayDirections)
+			{
+				const FVector onPlane{ IntersectViewRay(rayDirection, planeBase, planeNormal) };
+				TestEqual(TEXT("A point on the plane maps to NDC depth 1"), GetNDCDepth(obliqueProjection, onPlane), 1.0f, KINDA_SMALL_NUMBER);
+
+				const float frontDepth{ GetNDCDepth(obliqueProjection, onPlane * 2.0f) };
+				TestTrue(TEXT("A point in front of the plane is inside the depth range"), frontDepth > 0.0f && frontDepth < 1.0f);
+				TestTrue(TEXT("A point behind the plane is clipped"), GetNDCDepth(obliqueProjection, onPlane * 0.5f) > 1.0f);
+				TestTrue(TEXT("A far away point in the frustum stays in front of the far plane"), GetNDCDepth(obliqueProjection, rayDirection * 100000.0f) >= 0.0f);
+			}
+
+			//Only the depth mapping changes, the screen position and W of every point stay the same
+			for (int32 row = 0; row < 4; ++row)
+			{
+				TestEqual(TEXT("Clip X is unchanged"), obliqueProjection.M[row][0], projection.M[row][0]);
+				TestEqual(TEXT("Clip Y is unchanged"), obliqueProjection.M[row][1], projection.M[row][1]);
+				TestEqual(TEXT("Clip W is unchanged"), obliqueProjection.M[row][3], projection.M[row][3]);
+			}
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalObliqueProjectionWrongSideTest, "PortalVR.Math.ObliqueProjection.CameraOnWrongSide", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalObliqueProjectionWrongSideTest::RunTest(const FString& Parameters)
+{
+	const FMatrix projection{ MakeTestProjection() };
+	FMatrix obliqueProjection;
+
+	//The plane keeps what is on its normal's side, the camera there would have its near plane behind it
+	TestFalse(TEXT("Camera on the kept side of the plane"), FPortalMath::MakeObliqueProjection(projection, FMatrix::Identity, FVector{ 0.0f, 0.0f, 100.0f }, FVector{ 0.0f, 0.0f, -1.0f }, obliqueProjection));
+	TestFalse(TEXT("Camera on the plane"), FPortalMath::MakeObliqueProjection(projection, FMatrix::Identity, FVector::ZeroVector, FVector{ 0.0f, 0.0f, 1.0f }, obliqueProjection));
+
+	//The plane is given in world space and moved into view space, a camera that walked past the plane is on its kept side
+	const FMatrix viewMatrix{ FTranslationMatrix{ FVector{ 0.0f, 0.0f, -150.0f } } };
+	TestFalse(TEXT("Camera past the plane"), FPortalMath::MakeObliqueProjection(projection, viewMatrix, FVector{ 0.0f, 0.0f, 100.0f }, FVector{ 0.0f, 0.0f, 1.0f }, obliqueProjection));
+	TestTrue(TEXT("Camera still in front of the plane"), FPortalMath::MakeObliqueProjection(projection, viewMatrix, FVector{ 0.0f, 0.0f, 200.0f }, FVector{ 0.0f, 0.0f, 1.0f }, obliqueProjection));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalObliqueProjectionGrazingTest, "PortalVR.Math.ObliqueProjection.GrazingAngles", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalObliqueProjectionGrazingTest::RunTest(const FString& Parameters)
+{
+	//The 90 degree frustum's edges are at 45 degrees, a plane turned that far away from the view direction only grazes the frustum's edge
+	const FMatrix projection{ MakeTestProjection() };
+	const FVector grazingNormal{ FVector{ 1.0f, 0.0f, -1.0f }.GetSafeNormal() };
+	const FVector behindNormal{ FVector{ 1.0f, 0.0f, -1.2f }.GetSafeNormal() };
+	const FVector steepNormal{ FVector{ 1.0f, 0.0f, -0.8f }.GetSafeNormal() };
+	FMatrix obliqueProjection;
+
+	TestFalse(TEXT("Plane along the frustum's edge"), FPortalMath::MakeObliqueProjection(projection, FMatrix::Identity, grazingNormal * 10.0f, grazingNormal, obliqueProjection));
+	TestFalse(TEXT("Whole frustum behind the plane"), FPortalMath::MakeObliqueProjection(projection, FMatrix::Identity, behindNormal * 10.0f, behindNormal, obliqueProjection));
+
+	//Slightly less steep the plane cuts through the frustum's edge and still works
+	if (TestTrue(TEXT("Steep plane cutting the frustum"), FPortalMath::MakeObliqueProjection(projection, FMatrix::Identity, steepNormal * 10.0f, steepNormal, obliqueProjection)))
+	{
+		const FVector rayDirection{ 0.9f, 0.0f, 1.0f };
+		TestEqual(TEXT("A point on the steep plane maps to NDC depth 1"), GetNDCDepth(obliqueProjection, IntersectViewRay(rayDirection, steepNormal * 10.0f, steepNormal)), 1.0f, KINDA_SMALL_NUMBER);
+		TestTrue(TEXT("A far away point in the frustum stays in front of the far plane"), GetNDCDepth(obliqueProjection, rayDirection * 100000.0f) >= 0.0f);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalObliqueProjectionDegenerateTest, "PortalVR.Math.ObliqueProjection.DegenerateProjection", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalObliqueProjectionDegenerateTest::RunTest(const FString& Parameters)
+{
+	const FVector planeBase{ 0.0f, 0.0f, 100.0f };
+	const FVector planeNormal{ 0.0f, 0.0f, 1.0f };
+	FMatrix obliqueProjection;
+
+	//The frustum's corner tangents divide by M[0][0] and M[1][1]
+	FMatrix zeroWidthProjection{ MakeTestProjection() };
+	zeroWidthProjection.M[0][0] = 1.0e-9f;
+	TestFalse(TEXT("Near zero M[0][0]"), FPortalMath::MakeObliqueProjection(zeroWidthProjection, FMatrix::Identity, planeBase, planeNormal, obliqueProjection));
+
+	FMatrix zeroHeightProjection{ MakeTestProjection() };
+	zeroHeightProjection.M[1][1] = 0.0f;
+	TestFalse(TEXT("Zero M[1][1]"), FPortalMath::MakeObliqueProjection(zeroHeightProjection, FMatrix::Identity, planeBase, planeNormal, obliqueProjection));
+	return true;
+}
+
+/*
+ * The batch functions only run their SIMD path on groups of four, the remainder goes through the scalar path.
+ * Counts that aren't a multiple of four cover both, and every batch result is compared with the scalar functions gameplay uses
+ */
+static const int32 BatchTestCounts[]{ 0, 1, 3, 4, 5, 7, 8, 13, 67 };
+
+//Rotated portals with the same non uniform scale, like a linked pair of the example's portal meshes
+static FMatrix MakeTestThroughMatrix()
+{
+	const FTransform portalTransform{ FRotator{ 0.0f, 30.0f, 0.0f }, FVector{ 100.0f, 200.0f, 50.0f }, FVector{ 1.0f, 1.5f, 2.0f } };
+	const FTransform targetTransform{ FRotator{ 10.0f, -120.0f, 5.0f }, FVector{ -300.0f, 400.0f, 80.0f }, FVector{ 1.0f, 1.5f, 2.0f } };
+	return FPortalMath::ComputeThroughMatrix(portalTransform, targetTransform);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalBatchTransformPositionsTest, "PortalVR.Math.Batch.TransformPositions", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalBatchTransformPositionsTest::RunTest(const FString& Parameters)
+{
+	const FMatrix throughMatrix{ MakeTestThroughMatrix() };
+	FRandomStream randomStream{ 1 };
+	for (const int32 count : BatchTestCounts)
+	{
+		FPortalVectorArray positions;
+		for (int32 index = 0; index < count; ++index)
+		{
+			positions.Add(randomStream.VRand() * randomStream.FRandRange(0.0f, 1000.0f));
+		}
+
+		FPortalVectorArray outPositions;
+		FPortalMath::TransformPositions(throughMatrix, positions, outPositions);
+		if (!TestEqual(TEXT("Output count"), outPositions.Num(), count))
+		{
+			continue;
+		}
+
+		for (int32 index = 0; index < count; ++index)
+		{
+			FVector location;
+			FRotator rotation;
+			FPortalMath::TransformLocationRotation(throughMatrix, FTransform{ positions.Get(index) }, location, rotation);
+			TestEqual(*FString::Printf(TEXT("Position %d of %d"), index, count), outPositions.Get(index), location, 0.01f);
+		}
+	}
+
+	//The output can be the input
+	FPortalVectorArray positions;
+	positions.Add(FVector{ 10.0f, 20.0f, 30.0f });
+	FPortalMath::TransformPositions(throughMatrix, positions, positions);
+	TestEqual(TEXT("In place position"), positions.Get(0), throughMatrix.TransformPosition(FVector{ 10.0f, 20.0f, 30.0f }), 0.01f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalBatchTransformDirectionsTest, "PortalVR.Math.Batch.TransformDirections", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalBatchTransformDirectionsTest::RunTest(const FString& Parameters)
+{
+	const FMatrix throughMatrix{ MakeTestThroughMatrix() };
+	FRandomStream randomStream{ 2 };
+	for (const int32 count : BatchTestCounts)
+	{
+		FPortalVectorArray directions;
+		for (int32 index = 0; index < count; ++index)
+		{
+			directions.Add(randomStream.VRand() * randomStream.FRandRange(0.0f, 1000.0f));
+		}
+
+		FPortalVectorArray outDirections;
+		FPortalMath::TransformDirections(throughMatrix, directions, outDirections);
+		if (!TestEqual(TEXT("Output count"), outDirections.Num(), count))
+		{
+			continue;
+		}
+
+		for (int32 index = 0; index < count; ++index)
+		{
+			const FVector expected{ FPortalMath::TransformDirection(throughMatrix, directions.Get(index)) };
+			TestEqual(*FString::Printf(TEXT("Direction %d of %d"), index, count), outDirections.Get(index), expected, 0.01f);
+			TestEqual(*FString::Printf(TEXT("Direction %d of %d keeps its length"), index, count), outDirections.Get(index).Size(), directions.Get(index).Size(), 0.01f);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalBatchTransformRotationsTest, "PortalVR.Math.Batch.TransformRotations", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalBatchTransformRotationsTest::RunTest(const FString& Parameters)
+{
+	const FMatrix throughMatrix{ MakeTestThroughMatrix() };
+	FRandomStream randomStream{ 3 };
+	for (const int32 count : BatchTestCounts)
+	{
+		FPortalQuatArray rotations;
+		rotations.SetNum(count);
+		for (int32 index = 0; index < count; ++index)
+		{
+			const FRotator rotation{ randomStream.FRandRange(-89.0f, 89.0f), randomStream.FRandRange(-180.0f, 180.0f), randomStream.FRandRange(-180.0f, 180.0f) };
+			rotations.Set(index, rotation.Quaternion());
+		}
+
+		FPortalQuatArray outRotations;
+		FPortalMath::TransformRotations(throughMatrix, rotations, outRotations);
+		if (!TestEqual(TEXT("Output count"), outRotations.Num(), count))
+		{
+			continue;
+		}
+
+		//Compared as rotations, a quaternion and its negation are the same rotation
+		for (int32 index = 0; index < count; ++index)
+		{
+			FVector location;
+			FRotator expected;
+			FPortalMath::TransformLocationRotation(throughMatrix, FTransform{ rotations.Get(index) }, location, expected);
+			TestTrue(*FString::Printf(TEXT("Rotation %d of %d"), index, count), outRotations.Get(index).AngularDistance(expected.Quaternion()) <= 0.001f);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalBatchSegmentsCrossPortalTest, "PortalVR.Math.Batch.SegmentsCrossPortal", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalBatchSegmentsCrossPortalTest::RunTest(const FString& Parameters)
+{
+	/*
+	 * Axis aligned portal facing +X, so segments along X hit the plane at exactly representable points and both paths agree on the rectangle's edges.
+	 * Start, end and whether the segment crosses
+	 */
+	FPortalRect portalRect;
+	portalRect.halfExtents = FVector2D{ 50.0f, 100.0f };
+	struct FSegmentCase
+	{
+		FVector start;
+		FVector end;
+		bool bCrosses;
+	};
+	const FSegmentCase edgeCases[]{
+		{ FVector{ 10.0f, 0.0f, 0.0f }, FVector{ -10.0f, 0.0f, 0.0f }, true },
+		{ FVector{ 10.0f, 50.0f, 0.0f }, FVector{ -10.0f, 50.0f, 0.0f }, true },
+		{ FVector{ 10.0f, -50.0f, 0.0f }, FVector{ -10.0f, -50.0f, 0.0f }, true },
+		{ FVector{ 10.0f, 0.0f, 100.0f }, FVector{ -10.0f, 0.0f, 100.0f }, true },
+		{ FVector{ 10.0f, 0.0f, -100.0f }, FVector{ -10.0f, 0.0f, -100.0f }, true },
+		{ FVector{ 10.0f, 50.0f, 100.0f }, FVector{ -10.0f, 50.0f, 100.0f }, true },
+		{ FVector{ 10.0f, -50.0f, -100.0f }, FVector{ -10.0f, -50.0f, -100.0f }, true },
+		{ FVector{ 10.0f, 50.5f, 0.0f }, FVector{ -10.0f, 50.5f, 0.0f }, false },
+		{ FVector{ 10.0f, -50.5f, 0.0f }, FVector{ -10.0f, -50.5f, 0.0f }, false },
+		{ FVector{ 10.0f, 0.0f, 100.5f }, FVector{ -10.0f, 0.0f, 100.5f }, false },
+		{ FVector{ 10.0f, 50.5f, -100.5f }, FVector{ -10.0f, 50.5f, -100.5f }, false },
+		//Starting on the plane counts, ending on it doesn't, and crossing from behind doesn't
+		{ FVector{ 0.0f, 10.0f, 10.0f }, FVector{ -10.0f, 10.0f, 10.0f }, true },
+		{ FVector{ 10.0f, 10.0f, 10.0f }, FVector{ 0.0f, 10.0f, 10.0f }, false },
+		{ FVector{ -10.0f, 0.0f, 0.0f }, FVector{ 10.0f, 0.0f, 0.0f }, false },
+		//Diagonal segments hitting the plane exactly on the edge, and just outside of it at (0, 51, 0)
+		{ FVector{ 10.0f, 48.0f, 0.0f }, FVector{ -10.0f, 52.0f, 0.0f }, true },
+		{ FVector{ 10.0f, 52.0f, 0.0f }, FVector{ -10.0f, 48.0f, 0.0f }, true },
+		{ FVector{ 10.0f, 46.0f, 0.0f }, FVector{ -10.0f, 56.0f, 0.0f }, false },
+	};
+
+	//Padded to a multiple of four so every case goes through the SIMD path, the scalar path is checked on its own
+	FPortalVectorArray starts;
+	FPortalVectorArray ends;
+	for (const FSegmentCase& segmentCase : edgeCases)
+	{
+		starts.Add(segmentCase.start);
+		ends.Add(segmentCase.end);
+	}
+	while (starts.Num() % 4 != 0)
+	{
+		starts.Add(FVector{ 10.0f, 0.0f, 0.0f });
+		ends.Add(FVector{ 10.0f, 0.0f, 0.0f });
+	}
+	TArray<bool> crossed;
+	FPortalMath::SegmentsCrossPortal(portalRect, starts, ends, crossed);
+	for (int32 index = 0; index < UE_ARRAY_COUNT(edgeCases); ++index)
+	{
+		const FSegmentCase& segmentCase{ edgeCases[index] };
+		TestEqual(*FString::Printf(TEXT("Edge case %d scalar"), index), FPortalMath::SegmentCrossesPortal(portalRect, segmentCase.start, segmentCase.end), segmentCase.bCrosses);
+		TestEqual(*FString::Printf(TEXT("Edge case %d batch"), index), crossed[index], segmentCase.bCrosses);
+	}
+
+	//Random segments around a rotated and scaled portal, many of them within reach of the rectangle's edges
+	const FPortalRect rotatedRect{ FTransform{ FRotator{ 15.0f, 40.0f, -10.0f }, FVector{ 100.0f, -50.0f, 30.0f }, FVector{ 1.0f, 1.5f, 2.0f } }, FVector2D{ 50.0f, 100.0f } };
+	FRandomStream randomStream{ 4 };
+	for (const int32 count : BatchTestCounts)
+	{
+		FPortalVectorArray randomStarts;
+		FPortalVectorArray randomEnds;
+		for (int32 index = 0; index < count; ++index)
+		{
+			const FVector onPlane{ rotatedRect.origin + rotatedRect.right * randomStream.FRandRange(-100.0f, 100.0f) + rotatedRect.up * randomStream.FRandRange(-250.0f, 250.0f) };
+			const FVector offset{ randomStream.VRand() * 20.0f };
+			randomStarts.Add(onPlane + offset + rotatedRect.normal * randomStream.FRandRange(-5.0f, 20.0f));
+			randomEnds.Add(onPlane - offset - rotatedRect.normal * randomStream.FRandRange(-5.0f, 20.0f));
+		}
+
+		TArray<bool> randomCrossed;
+		FPortalMath::SegmentsCrossPortal(rotatedRect, randomStarts, randomEnds, randomCrossed);
+		if (!TestEqual(TEXT("Output count"), randomCrossed.Num(), count))
+		{
+			continue;
+		}
+
+		for (int32 index = 0; index < count; ++index)
+		{
+			TestEqual(*FString::Printf(TEXT("Segment %d of %d"), index, count), randomCrossed[index], FPortalMath::SegmentCrossesPortal(rotatedRect, randomStarts.Get(index), randomEnds.Get(index)));
+		}
+	}
+	return true;
+}
+
+/*
+ * What APortalVR::ConvertLocationRotationToPortal() computed for every call before the through matrix was cached, the reference the cached and batch paths have to reproduce.
+ * World to local of the portal, mirrored on the yaw axis, local to world of the target portal
+ */
+static FMatrix MakeLegacyThroughPortalMatrix(const FTransform& transform, const FTransform& portalTransform, const FTransform& targetTransform)
+{
+	FMatrix relativeMatrix{ transform.ToMatrixWithScale() * portalTransform.ToMatrixWithScale().Inverse() };
+	relativeMatrix *= FRotationMatrix{ FRotator{ 0.0f, 180.0f, 0.0f } };
+	return relativeMatrix * targetTransform.ToMatrixWithScale();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalLegacyThroughPortalTest, "PortalVR.Math.Legacy.ThroughPortal", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalLegacyThroughPortalTest::RunTest(const FString& Parameters)
+{
+	/*
+	 * Linked portals share their mesh scale, non uniform like the example's portals, and are rotated on every axis. A pair with different uniform scales too.
+	 * Portals with different non uniform scales would shear what goes through them, the legacy rotation of such a matrix was already ill defined
+	 */
+	struct FPortalPair
+	{
+		FTransform portalTransform;
+		FTransform targetTransform;
+	};
+	const FPortalPair portalPairs[]{
+		{ FTransform{ FRotator{ 0.0f, 30.0f, 0.0f }, FVector{ 100.0f, 200.0f, 50.0f }, FVector{ 1.0f, 1.5f, 2.0f } }, FTransform{ FRotator{ 10.0f, -120.0f, 5.0f }, FVector{ -300.0f, 400.0f, 80.0f }, FVector{ 1.0f, 1.5f, 2.0f } } },
+		{ FTransform{ FRotator{ -20.0f, 75.0f, 30.0f }, FVector{ 1000.0f, -50.0f, 0.0f }, FVector{ 0.5f, 2.0f, 3.0f } }, FTransform{ FRotator{ 45.0f, 170.0f, -15.0f }, FVector{ -20.0f, -800.0f, 300.0f }, FVector{ 0.5f, 2.0f, 3.0f } } },
+		{ FTransform{ FRotator{ 0.0f, -90.0f, 0.0f }, FVector{ 0.0f, 0.0f, 100.0f }, FVector{ 1.0f } }, FTransform{ FRotator{ 0.0f, 45.0f, 0.0f }, FVector{ 500.0f, 500.0f, 100.0f }, FVector{ 2.0f } } },
+	};
+
+	FRandomStream randomStream{ 5 };
+	for (int32 pairIndex = 0; pairIndex < UE_ARRAY_COUNT(portalPairs); ++pairIndex)
+	{
+		const FPortalPair& pair{ portalPairs[pairIndex] };
+		const FMatrix throughMatrix{ FPortalMath::ComputeThroughMatrix(pair.portalTransform, pair.targetTransform) };
+
+		//Characters and bodies near the portal, with a scaled one
+		const int32 count{ 13 };
+		TArray<FTransform> transforms;
+		FPortalVectorArray positions;
+		FPortalQuatArray rotations;
+		rotations.SetNum(count);
+		for (int32 index = 0; index < count; ++index)
+		{
+			const FRotator rotation{ randomStream.FRandRange(-89.0f, 89.0f), randomStream.FRandRange(-180.0f, 180.0f), randomStream.FRandRange(-180.0f, 180.0f) };
+			const FVector location{ pair.portalTransform.GetLocation() + randomStream.VRand() * randomStream.FRandRange(0.0f, 300.0f) };
+			transforms.Add(FTransform{ rotation, location, FVector{ index == 0 ? 1.2f : 1.0f } });
+			positions.Add(location);
+			rotations.Set(index, rotation.Quaternion());
+		}
+
+		FPortalVectorArray outPositions;
+		FPortalQuatArray outRotations;
+		FPortalMath::TransformPositions(throughMatrix, positions, outPositions);
+		FPortalMath::TransformRotations(throughMatrix, rotations, outRotations);
+
+		for (int32 index = 0; index < count; ++index)
+		{
+			const FTransform& transform{ transforms[index] };
+			const FMatrix legacyMatrix{ MakeLegacyThroughPortalMatrix(transform, pair.portalTransform, pair.targetTransform) };
+			const FVector legacyLocation{ legacyMatrix.GetOrigin() };
+			const FQuat legacyRotation{ legacyMatrix.Rotator().Quaternion() };
+
+			//The cached matrix is the legacy chain with the actor's matrix taken out of it
+			TestTrue(*FString::Printf(TEXT("Pair %d, through matrix of transform %d"), pairIndex, index), (transform.ToMatrixWithScale() * throughMatrix).Equals(legacyMatrix, 0.01f));
+
+			FVector location;
+			FRotator rotation;
+			FPortalMath::TransformLocationRotation(throughMatrix, transform, location, rotation);
+			TestEqual(*FString::Printf(TEXT("Pair %d, location %d"), pairIndex, index), location, legacyLocation, 0.01f);
+			TestTrue(*FString::Printf(TEXT("Pair %d, rotation %d"), pairIndex, index), rotation.Quaternion().AngularDistance(legacyRotation) <= 0.001f);
+
+			//The batch kernels go from the location and rotation alone, the actor's scale doesn't change where it ends up or how it's turned
+			TestEqual(*FString::Printf(TEXT("Pair %d, batch position %d"), pairIndex, index), outPositions.Get(index), legacyLocation, 0.01f);
+			TestTrue(*FString::Printf(TEXT("Pair %d, batch rotation %d"), pairIndex, index), outRotations.Get(index).AngularDistance(legacyRotation) <= 0.001f);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalVelocityThroughPortalTest, "PortalVR.Math.Legacy.VelocityThroughPortal", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalVelocityThroughPortalTest::RunTest(const FString& Parameters)
+{
+	//Upright portals turned against each other, scaled like the example's portals
+	const FTransform portalTransform{ FRotator{ 0.0f, 30.0f, 0.0f }, FVector{ 100.0f, 200.0f, 50.0f }, FVector{ 1.0f, 1.5f, 2.0f } };
+	const FTransform targetTransform{ FRotator{ 0.0f, -120.0f, 0.0f }, FVector{ -300.0f, 400.0f, 80.0f }, FVector{ 1.0f, 1.5f, 2.0f } };
+	const FMatrix throughMatrix{ FPortalMath::ComputeThroughMatrix(portalTransform, targetTransform) };
+	const FVector portalForward{ portalTransform.GetUnitAxis(EAxis::X) };
+	const FVector portalRight{ portalTransform.GetUnitAxis(EAxis::Y) };
+	const FVector targetForward{ targetTransform.GetUnitAxis(EAxis::X) };
+	const FVector targetRight{ targetTransform.GetUnitAxis(EAxis::Y) };
+	const FVector targetUp{ targetTransform.GetUnitAxis(EAxis::Z) };
+
+	//What APortalVR::TeleportCharacter() did before: the negated velocity in the portal's axes, put back together on the target's axes
+	auto legacyVelocity = [&](const FVector& velocity)
+	{
+		const FVector lastVelocity{ -velocity };
+		return FVector::DotProduct(lastVelocity, portalForward) * targetForward + FVector::DotProduct(lastVelocity, portalRight) * targetRight
+			+ FVector::DotProduct(lastVelocity, portalTransform.GetUnitAxis(EAxis::Z)) * targetUp;
+	};
+
+	//Walking into the portal comes out walking away from the target, sideways motion is mirrored, both as before
+	const FVector walkingIn{ -portalForward * 300.0f };
+	TestEqual(TEXT("Walking in"), FPortalMath::TransformDirection(throughMatrix, walkingIn), targetForward * 300.0f, 0.01f);
+	TestEqual(TEXT("Walking in, as before"), FPortalMath::TransformDirection(throughMatrix, walkingIn), legacyVelocity(walkingIn), 0.01f);
+	const FVector sideways{ portalRight * 150.0f - portalForward * 100.0f };
+	TestEqual(TEXT("Walking in sideways, as before"), FPortalMath::TransformDirection(throughMatrix, sideways), legacyVelocity(sideways), 0.01f);
+
+	//The vertical component keeps its sign now: falling into a portal comes out falling, it used to come out going up
+	const FVector falling{ -portalForward * 200.0f + FVector{ 0.0f, 0.0f, -500.0f } };
+	const FVector fallingOut{ FPortalMath::TransformDirection(throughMatrix, falling) };
+	TestEqual(TEXT("Falling keeps falling"), fallingOut.Z, -500.0f, 0.01f);
+	TestEqual(TEXT("Falling comes out moving away from the target"), FVector::DotProduct(fallingOut, targetForward), 200.0f, 0.01f);
+	TestEqual(TEXT("Falling used to come out going up"), legacyVelocity(falling).Z, 500.0f, 0.01f);
+	TestEqual(TEXT("Jumping keeps going up"), FPortalMath::TransformDirection(throughMatrix, FVector{ 0.0f, 0.0f, 400.0f } - portalForward * 10.0f).Z, 400.0f, 0.01f);
+
+	//The portals' scale doesn't change the speed
+	TestEqual(TEXT("Speed is kept"), fallingOut.Size(), falling.Size(), 0.01f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalViewRotationMatrixTest, "PortalVR.Math.View.ViewRotationMatrix", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalViewRotationMatrixTest::RunTest(const FString& Parameters)
+{
+	//The camera's forward, right and up axes become view space Z, X and Y
+	const FRotator rotations[]{ FRotator::ZeroRotator, FRotator{ 0.0f, 90.0f, 0.0f }, FRotator{ -30.0f, 135.0f, 10.0f }, FRotator{ 80.0f, -45.0f, -170.0f } };
+	for (const FRotator& rotation : rotations)
+	{
+		const FMatrix viewRotationMatrix{ FPortalMath::MakeViewRotationMatrix(rotation) };
+		const FRotationMatrix rotationMatrix{ rotation };
+		TestEqual(*FString::Printf(TEXT("Forward of %s"), *rotation.ToString()), viewRotationMatrix.TransformVector(rotationMatrix.GetUnitAxis(EAxis::X)), FVector{ 0.0f, 0.0f, 1.0f }, KINDA_SMALL_NUMBER);
+		TestEqual(*FString::Printf(TEXT("Right of %s"), *rotation.ToString()), viewRotationMatrix.TransformVector(rotationMatrix.GetUnitAxis(EAxis::Y)), FVector{ 1.0f, 0.0f, 0.0f }, KINDA_SMALL_NUMBER);
+		TestEqual(*FString::Printf(TEXT("Up of %s"), *rotation.ToString()), viewRotationMatrix.TransformVector(rotationMatrix.GetUnitAxis(EAxis::Z)), FVector{ 0.0f, 1.0f, 0.0f }, KINDA_SMALL_NUMBER);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalEyeViewTest, "PortalVR.Math.View.EyeViewOrigin", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalEyeViewTest::RunTest(const FString& Parameters)
+{
+	/*
+	 * A replayed eye's ViewOrigin is its camera space offset moved by the camera's transform, and both eyes share the camera's ViewRotationMatrix.
+	 * Seen from the camera's view the eyes then sit at their offsets in view space (forward Z, right X, up Y), whatever the camera's pose
+	 */
+	const FTransform cameraTransforms[]{ FTransform::Identity, FTransform{ FRotator{ 0.0f, 90.0f, 0.0f }, FVector{ 100.0f, -50.0f, 170.0f } }, FTransform{ FRotator{ -20.0f, -160.0f, 15.0f }, FVector{ -400.0f, 250.0f, 120.0f } } };
+	const FVector eyeOffsets[]{ FVector{ 0.0f, -3.2f, 0.0f }, FVector{ 0.0f, 3.2f, 0.0f }, FVector{ 1.0f, -3.0f, 0.5f } };
+	for (const FTransform& cameraTransform : cameraTransforms)
+	{
+		const FMatrix cameraViewMatrix{ FTranslationMatrix{ -cameraTransform.GetLocation() } * FPortalMath::MakeViewRotationMatrix(cameraTransform.Rotator()) };
+		for (const FVector& eyeOffset : eyeOffsets)
+		{
+			const FVector viewOrigin{ cameraTransform.TransformPosition(eyeOffset) };
+			TestEqual(TEXT("Eye in the camera's view space"), cameraViewMatrix.TransformPosition(viewOrigin), FVector{ eyeOffset.Y, eyeOffset.Z, eyeOffset.X }, 0.01f);
+
+			//A point straight ahead of the eye is on the eye's view axis
+			const FMatrix eyeViewMatrix{ FTranslationMatrix{ -viewOrigin } * FPortalMath::MakeViewRotationMatrix(cameraTransform.Rotator()) };
+			TestEqual(TEXT("Point ahead of the eye"), eyeViewMatrix.TransformPosition(viewOrigin + cameraTransform.GetUnitAxis(EAxis::X) * 100.0f), FVector{ 0.0f, 0.0f, 100.0f }, 0.01f);
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalPoseDeltaTest, "PortalVR.Math.View.PoseDelta", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalPoseDeltaTest::RunTest(const FString& Parameters)
+{
+	float distance;
+	float angle;
+
+	FPortalMath::GetPoseDelta(FTransform{ FVector{ 10.0f, 20.0f, 30.0f } }, FTransform{ FVector{ 13.0f, 24.0f, 30.0f } }, distance, angle);
+	TestEqual(TEXT("Distance of a translated pose"), distance, 5.0f, KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("Angle of a translated pose"), angle, 0.0f, 0.01f);
+
+	FPortalMath::GetPoseDelta(FTransform{ FRotator{ 0.0f, 30.0f, 0.0f } }, FTransform{ FRotator{ 0.0f, 120.0f, 0.0f } }, distance, angle);
+	TestEqual(TEXT("Distance of a rotated pose"), distance, 0.0f, KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("Angle of a rotated pose"), angle, 90.0f, 0.01f);
+
+	//A quaternion and its negation are the same orientation, and scale isn't part of a pose
+	const FQuat rotation{ FRotator{ 10.0f, 20.0f, 30.0f }.Quaternion() };
+	FPortalMath::GetPoseDelta(FTransform{ rotation }, FTransform{ FQuat{ -rotation.X, -rotation.Y, -rotation.Z, -rotation.W }, FVector::ZeroVector, FVector{ 2.0f } }, distance, angle);
+	TestEqual(TEXT("Distance of the same pose"), distance, 0.0f, KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("Angle of a negated quaternion"), angle, 0.0f, 0.1f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalLateLatchTest, "PortalVR.Math.View.LateLatchThroughPortal", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPortalLateLatchTest::RunTest(const FString& Parameters)
+{
+	//A turned portal pair and a VR origin somewhere in the level, the head moves a few millimeters and turns by a degree between the poses
+	const FMatrix throughMatrix{ FPortalMath::ComputeThroughMatrix(FTransform{ FRotator{ 0.0f, 35.0f, 0.0f }, FVector{ 100.0f, -200.0f, 50.0f } }, FTransform{ FRotator{ 0.0f, -70.0f, 0.0f }, FVector{ -900.0f, 400.0f, 120.0f } }) };
+	const FTransform parentTransform{ FRotator{ 0.0f, 15.0f, 0.0f }, FVector{ 20.0f, 30.0f, 0.0f } };
+	const FTransform pose{ FRotator{ -5.0f, 40.0f, 2.0f }, FVector{ 10.0f, -4.0f, 170.0f } };
+	const FTransform latePoses[]{ pose, FTransform{ FRotator{ -4.0f, 41.0f, 2.0f }, FVector{ 10.3f, -3.8f, 170.1f } }, FTransform{ FRotator{ -5.0f, 40.0f, 2.0f }, FVector{ 12.0f, -4.0f, 170.0f } } };
+
+	FVector location;
+	FRotator rotation;
+	FPortalMath::TransformLocationRotation(throughMatrix, pose * parentTransform, location, rotation);
+	for (const FTransform& latePose : latePoses)
+	{
+		//Latching the capture placed from the old pose puts it where the new pose would have placed it
+		FVector expectedLocation;
+		FRotator expectedRotation;
+		FPortalMath::TransformLocationRotation(throughMatrix, latePose * parentTransform, expectedLocation, expectedRotation);
+
+		FVector latchedLocation;
+		FRotator latchedRotation;
+		FPortalMath::LateLatchThroughPortal(throughMatrix, parentTransform, pose, latePose, location, rotation, latchedLocation, latchedRotation);
+		TestEqual(TEXT("Latched capture location"), latchedLocation, expectedLocation, 0.01f);
+		TestTrue(TEXT("Latched capture rotation"), latchedRotation.Quaternion().Equals(expectedRotation.Quaternion(), 0.0001f));
+	}
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
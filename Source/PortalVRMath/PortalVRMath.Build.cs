@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class PortalVRMath : ModuleRules
+{
+	public PortalVRMath(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		//Flat module layout like the game module, expose the module directory so the game module can include PortalMath.h
+		PublicIncludePaths.Add(ModuleDirectory);
+
+		//Only Core on purpose, portal math must stay usable without UObjects or a world
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}